@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright (c) 2014, Emil Briggs
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include "const.h"
+#include "TradeImages.h"
+#include "RmgException.h"
+#include "Lattice.h"
+#include "FiniteDiff.h"
+#include "RmgParallelFft.h"
+#include "transition.h"
+
+// Applies the divergence operator to the vector field (ax, ay, az) and returns the
+// result in div. This replaces three gradient calls when only the diagonal components
+// are needed, e.g. for the second term of the GGA potential.
+//
+// IN:    Input arrays ax, ay, az defined on coarse or fine grid
+// OUT:   Output array div defined on coarse or fine grid
+// IN:    grid = "Coarse" or "Fine" for grid type
+
+
+template void ApplyDivergence<double>(double *, double *, double *, double *, int, const char *grid);
+template void ApplyDivergence<std::complex<double> >(std::complex<double> *, std::complex<double> *, std::complex<double> *, std::complex<double> *, int, const char *grid);
+
+template void ApplyDivergence<double>(double *, double *, double *, double *, int, const char *grid, BaseGrid *G, TradeImages *T);
+template void ApplyDivergence<std::complex<double> >(std::complex<double> *, std::complex<double> *, std::complex<double> *, std::complex<double> *, int, const char *grid, BaseGrid *G, TradeImages *T);
+
+
+template <typename DataType>
+void ApplyDivergence (DataType *ax, DataType *ay, DataType *az, DataType *div, int order, const char *grid)
+{
+    ApplyDivergence (ax, ay, az, div, order, grid, Rmg_G, Rmg_T);
+}
+
+template <typename DataType>
+void ApplyDivergence (DataType *ax, DataType *ay, DataType *az, DataType *div, int order, const char *grid, BaseGrid *G, TradeImages *T)
+{
+    int density;
+    const char *coarse = "Coarse";
+    const char *fine = "Fine";
+    Pw *pwaves;
+
+    if(!strcmp(grid, coarse)) {
+        density = 1;
+        pwaves = coarse_pwaves;
+    }
+    else if(!strcmp(grid, fine)) {
+        density = G->default_FG_RATIO;
+        pwaves = fine_pwaves;
+    }
+    else {
+        throw RmgFatalException() << "Error! Grid type " << grid << " not defined in "
+                                 << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+
+    int dimx = G->get_PX0_GRID(density);
+    int dimy = G->get_PY0_GRID(density);
+    int dimz = G->get_PZ0_GRID(density);
+
+    double gridhx = G->get_hxgrid(density);
+    double gridhy = G->get_hygrid(density);
+    double gridhz = G->get_hzgrid(density);
+
+    if(order == APP_CI_FFT)
+    {
+        FftDivergence(ax, ay, az, div, *pwaves);
+    }
+    else
+    {
+        CPP_app_div_driver (&Rmg_L, T, ax, ay, az, div, dimx, dimy, dimz,
+                            gridhx, gridhy, gridhz, order, ct.alt_laplacian && density==1);
+    }
+}
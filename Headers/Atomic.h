@@ -38,6 +38,7 @@
 void InitLocalObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject);
 void InitDelocalizedObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject);
 void InitLocalObject(double *sumobject, int object_type);
+void UpdateLocalObject (double *sumobject, int object_type, std::vector<int> &moved, bool rebuild);
 void LcaoGetAtomicRho(double *arho);
 
 class Atomic {
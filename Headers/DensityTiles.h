@@ -0,0 +1,43 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+
+#ifndef RMG_DensityTiles_H
+#define RMG_DensityTiles_H 1
+
+#include <vector>
+#include <cstddef>
+
+// Maximum number of grid points in a density accumulation tile. Sized so that a tile
+// of the density plus the matching orbital segments stays resident in L2 cache.
+#define DENSITY_TILE_SIZE 2048
+
+// Tile size for n grid points. Smaller than DENSITY_TILE_SIZE when that would leave
+// fewer tiles than threads, which happens for the small subdomains of strong scaling.
+size_t DensityTileSize(size_t n);
+
+// Sums the per-thread partial densities in bufs into out. Threads split the grid
+// into tiles instead of serializing on the whole array so the cost of the
+// reduction does not grow with the number of threads.
+void ReduceThreadBuffers(std::vector<double *> &bufs, double *out, size_t n);
+
+#endif
@@ -28,6 +28,8 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <array>
 #include <complex>
 #include <mutex>
 #include "BaseGrid.h"
@@ -133,6 +135,9 @@ private:
     void fftpair(T *psi_i, T*psi_j, std::complex<double> *p, double *);
     void fftpair(T *psi_i, T*psi_j, std::complex<double> *p, std::complex<float> *workbuf, double *);
     void setup_gfac(double *kq);
+    void setup_gfac_cached(double *kq, size_t max_bytes);
+    void pack_gfac(void);
+    std::map<std::array<long long, 3>, std::vector<double>> gfac_cache;
     void setup_exxdiv();
 
     std::vector< std::pair <int,int> > wf_pairs;
@@ -145,6 +150,10 @@ private:
 
     double eps_qdiv = 1.0e-8;
 
+    // True when vexx holds the ACE projection vectors instead of V_x|psi>
+    bool ace_built = false;
+    void AceExpand(T *xi, T *out);
+
     int VxxIntChol(std::vector<T> &Exxint, std::vector<T> &ExxCholVec, int cmax, int nstates_occ);
     void waves_pair_and_fft(int k1, int k2, std::complex<double> *Xaolj_one, std::complex<double> *Xaoik_one);
     int Vexx_int_oneQ(int iq, int_2d_array QKtoK2, std::complex<double> *Cholvec,
@@ -163,6 +172,23 @@ private:
     void UnpadR2C_Accumulate(double *in, double *psi_j, double *vg, double scale);
     void UnpadR2C_Accumulate(float *in, double *psi_j, double *vg, double scale);
 
+    // In memory transport of global orbitals used instead of the serial wavefunction file
+    void Unmap(T *rbuf, T *outbuf);
+    void RedistributeOrbitals(std::vector<int> &bounds, T *out);
+    void StartOrbitalGather(int first, int count, T *rbuf, std::vector<MPI_Request> &reqs);
+    void FinishOrbitalGather(T *rbuf, T *out, std::vector<MPI_Request> &reqs);
+
+    // Interpolative separable density fitting of orbital pair products, see ExxIsdf.cpp
+    void IsdfPoints(T *psi_a, int na, T *psi_b, int nb, int nmu, std::vector<int> &points);
+    int IsdfFit(T *psi_a, int na, T *psi_b, int nb, std::vector<T> &theta, std::vector<T> &ca, std::vector<T> &cb);
+    void IsdfCoulomb(std::vector<T> &theta, int nmu, std::vector<T> &wtheta);
+    void VexxIsdf(T *vexx, int nstates_occ);
+    void Vexx_integrals_isdf(std::string &vfile);
+
+    // Localized (SCDM) occupied orbitals and the overlap mask of their pairs, see ExxLocalized.cpp
+    bool LocalizeOccupied(int nocc, std::vector<T> &lpsi, std::vector<T> &umat, std::vector<char> &pair_mask);
+    double MixVexx(T *vexx, T *vnew, int first, int count, int nstates_occ);
+
 
 public:
     // BaseGrid class (distributed) and half grid
@@ -182,6 +208,7 @@ public:
     std::vector<T> Hcore, Hcore_kin;
     void Vexx(T *vexx, bool use_float_fft);
     double Exxenergy(T *vexx);
+    void BuildAce(T *vexx);
     void SetHcore(T *Hij, T *Hij_kin, int lda);
     void Vexx_integrals(std::string &ifile);
     void Vexx_integrals_block(FILE *fp, int ij_start, int ij_end, int kl_start, int kl_end);
@@ -205,6 +232,17 @@ public:
     double Coulomb_energy, Ex_energy;
 };
 
+// Defined in ExxIsdf.cpp
+template <> void Exxbase<double>::VexxIsdf(double *vexx, int nstates_occ);
+template <> void Exxbase<std::complex<double>>::VexxIsdf(std::complex<double> *vexx, int nstates_occ);
+template <> void Exxbase<double>::Vexx_integrals_isdf(std::string &vfile);
+template <> void Exxbase<std::complex<double>>::Vexx_integrals_isdf(std::string &vfile);
+
+// Defined in ExxLocalized.cpp
+template <> bool Exxbase<double>::LocalizeOccupied(int nocc, std::vector<double> &lpsi, std::vector<double> &umat, std::vector<char> &pair_mask);
+template <> bool Exxbase<std::complex<double>>::LocalizeOccupied(int nocc, std::vector<std::complex<double>> &lpsi,
+        std::vector<std::complex<double>> &umat, std::vector<char> &pair_mask);
+
 #endif
 
 
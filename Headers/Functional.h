@@ -62,6 +62,7 @@ private:
 
     void gradcorr(double *rho, double *rho_core, double &etxc, double &vtxc, double *v);
     void gradcorr_spin(double *rho_up, double *rho_down, double *rho_core, double &etxc, double &vtxc, double *v_up, double *v_down);
+    bool use_batched_xc(void);
 
 public:
     Functional (BaseGrid &G, 
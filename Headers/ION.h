@@ -114,6 +114,10 @@ public:
     /* Crystal coordinates  at the previous time step */
     double oxtal[3];
 
+    /* Crystal coordinates used when the local potential and projector weights */
+    /* for this ion were last generated (incremental reinit)                    */
+    double reinit_xtal[3];
+
     /*Position of ion relative to the middle of non-local box around the ion 
      *          * determined in get_nlop, AIget_cindex sets this up*/
     double nlcrds[3];
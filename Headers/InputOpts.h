@@ -60,6 +60,19 @@ static std::unordered_map<std::string, int> charge_mixing_type = {
         {"Pulay", 1},
         {"Broyden", 2}};
 
+static std::unordered_map<std::string, int> drho_precond_type = {
+        {"Kerker", DRHO_PRECOND_KERKER},
+        {"Thomas-Fermi", DRHO_PRECOND_TF}};
+
+static std::unordered_map<std::string, int> volumetric_output_format = {
+        {"cube", VOLUMETRIC_CUBE},
+        {"npy", VOLUMETRIC_NPY}};
+
+static std::unordered_map<std::string, int> mixing_history_storage = {
+        {"Double", 0},
+        {"Float", 1},
+        {"Zfp", 2}};
+
 static std::unordered_map<std::string, int> charge_analysis = {
         {"None", 0},
         {"Voronoi", 1}};
@@ -75,6 +75,8 @@ struct rmg_user_allocator
 };
 
 
+class OrbitalPager;
+
 template <typename KpointType> class Kpoint {
 
 public:
@@ -100,7 +102,7 @@ public:
     void ComputeHcore (double *vtot_eig, double *vxc_psi, KpointType *Hcore, KpointType *Hcore_kin, KpointType *Hij_localpp);
     void MgridSubspace (double *vtot_psi, double *vxc_psi);
     void Davidson(double *vtot, double *vxc_psi, int &notconv);
-    void GetLocalizedWeight (void);
+    void GetLocalizedWeight (std::vector<bool> *skip = NULL);
     void GetDelocalizedWeight (void);
     void GetDelocalizedOrbital (void);
     void LcaoGetPsi (void);
@@ -145,6 +147,9 @@ public:
     // Block of contiguous storage for the orbitals
     KpointType *orbital_storage;
 
+    // Read ahead and write behind for orbitals mapped to disk, NULL if not used
+    OrbitalPager *orbital_pager;
+
     // Block of contiguous storage for the orbitals from the previous step which is needed in some cases
     KpointType *prev_orbitals;
 
@@ -164,6 +169,9 @@ public:
     // since we apply the non-local operators in blocks for efficiency and to save memory
     KpointType *nv;
     KpointType *ns;
+    // Staging buffer for the stacked nv/ns gemm in AppNls with ultrasoft pseudopotentials,
+    // dimensioned (2, NL_BLOCK_SIZE, P0_BASIS). NULL for norm conserving.
+    KpointType *nvns;
     int nl_first_state;  // first state in the buffer
 
     // Pointers to weight and Bweight
@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_OrbitalPager_H
+#define RMG_OrbitalPager_H 1
+
+#include <cstddef>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Manages paging of orbitals that live in a file mapped with CreateMmapArray
+// (nvme_orbitals). The solvers touch orbitals in blocks of consecutive states so
+// instead of taking a synchronous page fault on every new page the pager reads the
+// next block ahead on an I/O thread and writes finished blocks back behind the
+// computation. Blocks are tracked in the order they were prefetched and once more
+// than cache_bytes are resident the oldest are written back and dropped from memory.
+//
+// The mapping stays the only copy of the data so every other routine can keep
+// accessing orbitals directly. All operations are hints and never change the data.
+class OrbitalPager {
+
+public:
+    OrbitalPager(int fd, void *map_base, void *base, size_t orbital_bytes, int num_orbitals, size_t cache_bytes);
+    ~OrbitalPager(void);
+
+    // Starts reading orbitals [first, first+count) into memory.
+    void Prefetch(int first, int count);
+
+    // Starts writing orbitals [first, first+count) back to the file without waiting for
+    // the writes to complete. They stay resident.
+    void WriteBehind(int first, int count);
+
+    // Blocks until all queued operations are complete.
+    void Wait(void);
+
+private:
+    enum PagerOp {PAGER_PREFETCH, PAGER_WRITE, PAGER_EVICT};
+    struct PagerTask {
+        PagerOp op;
+        int first;
+        int count;
+    };
+
+    void worker(void);
+    void page_range(int first, int count, bool outer, char *&start, size_t &length, size_t &offset);
+
+    int fd;
+    char *map_base;
+    char *base;
+    size_t orbital_bytes;
+    int num_orbitals;
+    size_t cache_bytes;
+    size_t page_size;
+
+    // Blocks currently resident in prefetch order and their total size
+    std::deque<PagerTask> resident;
+    size_t resident_bytes;
+
+    std::deque<PagerTask> queue;
+    int busy;
+    bool done;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::thread io_thread;
+};
+
+#endif
@@ -50,6 +50,10 @@
 // (p) the offset into the wavefunction array the projections start from (offset)
 // and the set of weights that represent the projectors (w).
 //
+// For localized projectors the states may be split into ct.projector_pipeline_chunks
+// chunks. The ion ownership messages for a chunk are then sent as soon as its gemm
+// finishes so that the communication overlaps the gemm for the next chunk.
+//
 
 template <typename KpointType> class Projector {
 
@@ -117,12 +121,13 @@ private:
     int num_loc_ions;
 
     void betaxpsi_calculate (Kpoint<KpointType> * kptr, KpointType * sint_ptr, KpointType * psi, int num_states, KpointType *weight);
+    void project_pipelined(Kpoint<KpointType> *kptr, KpointType *orbitals, KpointType *p, int offset, int n, KpointType *w, int nchunks);
     void betaxpsi_receive (KpointType * recv_buff, int num_pes,
                                int *pe_list, int *num_ions_per_pe,
-                               MPI_Request * req_recv, int num_states);
+                               MPI_Request * req_recv, int num_states, int tag);
     void betaxpsi_send (KpointType * send_buff, int num_pes,
                             int *pe_list, int *num_ions_per_pe,
-                            MPI_Request * req_send, int num_states);
+                            MPI_Request * req_send, int num_states, int tag);
     void betaxpsi_pack (KpointType * sint, KpointType * fill_buff,
                             int num_pes, int *num_ions_per_pe,
                             int_2d_array &list_ions_per_pe, int num_states);
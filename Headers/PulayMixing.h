@@ -3,6 +3,43 @@
 
 #include<functional>
 #include<complex>
+#include<vector>
+
+// Storage for the history vectors of the Pulay and Broyden mixers. Vectors may be
+// kept in full double precision, in single precision or ZFP compressed. Inner
+// products and updates stream through the stored data one chunk at a time so the
+// compressed forms never need a full size scratch array.
+#define MIXING_HISTORY_DOUBLE 0
+#define MIXING_HISTORY_FLOAT 1
+#define MIXING_HISTORY_ZFP 2
+
+class MixingHistory {
+
+private:
+    size_t Nsize;
+    int storage;
+    std::vector<std::vector<double>> dstore;
+    std::vector<std::vector<float>> fstore;
+    std::vector<std::vector<std::vector<double>>> zstore;
+    std::vector<double> chunk, zbuf;
+
+    double *get_chunk(int slot, size_t ichunk, size_t &len);
+    void put_chunk(int slot, size_t ichunk, double *x, size_t len);
+
+public:
+    MixingHistory(size_t Nsize, int nslots, int storage);
+
+    // Replaces slot with x
+    void store(int slot, double *x);
+    // Calls f(data, offset, len) for consecutive pieces of slot
+    void visit(int slot, std::function<void(double *, size_t, size_t)> f);
+    // Returns the local part of <slot|y>
+    double dot(int slot, double *y);
+    // y += alpha * slot
+    void axpy(int slot, double alpha, double *y);
+    // slot += alpha * x
+    void update(int slot, double alpha, double *x);
+};
 
 class PulayMixing {
 
@@ -14,12 +51,15 @@ private:
     int pulay_order, refresh_steps;
     int step;
     int max_order = 10;
-    double *hist;
-    double *res_hist;
+    MixingHistory *xhist = NULL;
+    MixingHistory *fhist = NULL;
+    std::vector<int> hist_slot;
+    std::vector<int> res_hist_slot;
+    // Residual history in G-space restricted to the local G-vectors inside the
+    // density cutoff sphere, whose local indices are in gsphere.
     std::complex<double> *res_histG;
+    std::vector<size_t> gsphere;
     double *A_mat;
-    std::vector<double*> hist_ptr;
-    std::vector<double*> res_hist_ptr;
     std::vector<std::complex<double>*> res_histG_ptr;
     std::function<void(double*, int)> Precond;
     bool need_precond;
@@ -49,6 +89,7 @@ public:
     void Refresh();
 
     void SetBroyden(int pbasis);
+    void SetHistoryStorage(int storage);
     void MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, double *vh_in);
 
 };
@@ -63,6 +63,13 @@ void FftGradient(double *x, double *fgx, double *fgy, double *fgz, Pw &pwaves);
 void FftGradient(std::complex<float> *x, std::complex<float> *fgx, std::complex<float> *fgy, std::complex<float> *fgz, Pw &pwaves);
 void FftGradient(std::complex<double> *x, std::complex<double> *fgx, std::complex<double> *fgy, std::complex<double> *fgz, Pw &pwaves);
 
+void FftDivergenceCoarse(double *fx, double *fy, double *fz, double *div);
+void FftDivergenceCoarse(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div);
+void FftDivergenceFine(double *fx, double *fy, double *fz, double *div);
+void FftDivergenceFine(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div);
+void FftDivergence(double *fx, double *fy, double *fz, double *div, Pw &pwaves);
+void FftDivergence(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div, Pw &pwaves);
+
 
 void FftLaplacianCoarse(float *x, float *lapx);
 void FftLaplacianCoarse(std::complex<float> *x, std::complex<float> *lapx);
@@ -82,9 +82,32 @@ class Symmetry
         double symprec;
         double angprec;
 
+        // For each symmetry operation and local grid point the position of the
+        // image point in the buffer filled by exchange_images. Only allocated
+        // when ct.compact_symmetry_indices is false, otherwise rows are computed
+        // on the fly by image_row.
         std::vector<uint32_t> sym_idx;
 
-        void init_symm_ijk();
+        // Owning processor coordinate and local coordinate for each global grid
+        // coordinate along x, y and z.
+        std::vector<int> xpe, ype, zpe;
+        std::vector<int> xloc, yloc, zloc;
+        int pe_y, pe_z;
+
+        // Sparse exchange plan for the image points. Each peer contributes the
+        // bounding box (in its local coordinates) of the points we reference.
+        // Points owned by recv_peers[i] land at images[recv_offsets[i]...] while the
+        // local points listed in send_idx[send_offsets[i]...] are sent to send_peers[i].
+        size_t nimages;
+        std::vector<int> box_lo, box_dim, box_offset;
+        std::vector<int> recv_peers, recv_counts, recv_offsets;
+        std::vector<int> send_peers, send_counts, send_offsets;
+        std::vector<int> send_idx;
+
+        void image_row_coords(int isy, int ix, int iy, int *gx, int *gy, int *gz);
+        const uint32_t *image_row(int isy, int ix, int iy, uint32_t *work);
+        void init_symm_ijk(BaseGrid &G);
+        void exchange_images(double *object, int ncomp, double *images);
 
     public:
         int nsym;
@@ -0,0 +1,248 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_XcKernels_H
+#define RMG_XcKernels_H 1
+
+#include <cmath>
+
+// Native versions of the spin unpolarized LDA and GGA routines in functionals.F90.
+// Each functor evaluates a single grid point using selects rather than branches so
+// that the batched drivers in XcKernels.cpp vectorize. Constants and the order of
+// operations follow the Fortran reference so results agree to round-off.
+//
+// LDA functors take rs and return the energy per particle and the potential.
+// GGA functors take rho and |grad rho|^2 and return the energy density and the
+// derivatives with respect to rho and to |grad rho| (divided by |grad rho|).
+
+// Number of grid points processed per call to the batched drivers
+#define XC_BATCH_SIZE 256
+
+struct XcNoLda
+{
+    static inline void eval(double rs, double &e, double &v)
+    {
+        e = 0.0;
+        v = 0.0;
+    }
+};
+
+// Slater exchange with alpha=2/3
+struct XcSlater
+{
+    static inline void eval(double rs, double &ex, double &vx)
+    {
+        const double f = -0.687247939924714, alpha = 2.0 / 3.0;
+        ex = f * alpha / rs;
+        vx = 4.0 / 3.0 * f * alpha / rs;
+    }
+};
+
+// Perdew-Zunger (iflag=1) and Ortiz-Ballone (iflag=2) correlation
+template <int iflag> struct XcPz
+{
+    static inline void eval(double rs, double &ec, double &vc)
+    {
+        const double a = (iflag == 1) ? 0.0311 : 0.031091;
+        const double b = (iflag == 1) ? -0.048 : -0.046644;
+        const double c = (iflag == 1) ? 0.0020 : 0.00419;
+        const double d = (iflag == 1) ? -0.0116 : -0.00983;
+        const double gc = (iflag == 1) ? -0.1423 : -0.103756;
+        const double b1 = (iflag == 1) ? 1.0529 : 0.56371;
+        const double b2 = (iflag == 1) ? 0.3334 : 0.27358;
+
+        // high density formula
+        double lnrs = std::log(rs);
+        double ech = a * lnrs + b + c * rs * lnrs + d * rs;
+        double vch = a * lnrs + (b - a / 3.0) + 2.0 / 3.0 * c * rs * lnrs + (2.0 * d - c) / 3.0 * rs;
+
+        // interpolation formula
+        double rs12 = std::sqrt(rs);
+        double ox = 1.0 + b1 * rs12 + b2 * rs;
+        double dox = 1.0 + 7.0 / 6.0 * b1 * rs12 + 4.0 / 3.0 * b2 * rs;
+        double eci = gc / ox;
+        double vci = eci * dox / ox;
+
+        ec = (rs < 1.0) ? ech : eci;
+        vc = (rs < 1.0) ? vch : vci;
+    }
+};
+
+// Perdew-Wang correlation, interpolation formula (iflag=1 in pw)
+struct XcPw
+{
+    static inline void eval(double rs, double &ec, double &vc)
+    {
+        const double a = 0.031091, b1 = 7.5957, b2 = 3.5876;
+        const double a1 = 0.21370, b3 = 1.6382, b4 = 0.49294;
+        double rs12 = std::sqrt(rs);
+        double rs32 = rs * rs12;
+        double rs2 = rs * rs;
+        double om = 2.0 * a * (b1 * rs12 + b2 * rs + b3 * rs32 + b4 * rs2);
+        double dom = 2.0 * a * (0.5 * b1 * rs12 + b2 * rs + 1.5 * b3 * rs32 + 2.0 * b4 * rs2);
+        double olog = std::log(1.0 + 1.0 / om);
+        ec = -2.0 * a * (1.0 + a1 * rs) * olog;
+        vc = -2.0 * a * (1.0 + 2.0 / 3.0 * a1 * rs) * olog - 2.0 / 3.0 * a * (1.0 + a1 * rs) * dom / (om * (om + 1.0));
+    }
+};
+
+// Lee-Yang-Parr correlation, LDA part only
+struct XcLyp
+{
+    static inline void eval(double rs, double &ec, double &vc)
+    {
+        const double a = 0.04918, b = 0.132 * 2.87123400018819108;
+        const double pi43 = 1.61199195401647, c = 0.2533 * pi43, d = 0.349 * pi43;
+        double ecrs = b * std::exp(-c * rs);
+        double ox = 1.0 / (1.0 + d * rs);
+        ec = -a * ox * (1.0 + ecrs);
+        vc = ec - rs / 3.0 * a * ox * (d * ox + ecrs * (d * ox + c));
+    }
+};
+
+struct XcNoGga
+{
+    static inline void eval(double rho, double grho, double &s, double &v1, double &v2)
+    {
+        s = 0.0;
+        v1 = 0.0;
+        v2 = 0.0;
+    }
+};
+
+// Becke 88 exchange, gradient corrected part only
+struct XcBecke88
+{
+    static inline void eval(double rho, double grho, double &sx, double &v1x, double &v2x)
+    {
+        const double beta = 0.0042, two13 = 1.259921049894873;
+        double rho13 = std::pow(rho, 1.0 / 3.0);
+        double rho43 = rho13 * rho13 * rho13 * rho13;
+        double xs = two13 * std::sqrt(grho) / rho43;
+        double xs2 = xs * xs;
+        double sa2b8 = std::sqrt(1.0 + xs2);
+        double shm1 = std::log(xs + sa2b8);
+        double dd = 1.0 + 6.0 * beta * xs * shm1;
+        double dd2 = dd * dd;
+        double ee = 6.0 * beta * xs2 / sa2b8 - 1.0;
+        sx = two13 * grho / rho43 * (-beta / dd);
+        v1x = -(4.0 / 3.0) / two13 * xs2 * beta * rho13 * ee / dd2;
+        v2x = two13 * beta * (ee - dd) / (rho43 * dd2);
+    }
+};
+
+// PBE exchange without the Slater term. iflag=1 PBE, iflag=2 revPBE, iflag=3 PBEsol
+template <int iflag> struct XcPbex
+{
+    static inline void eval(double rho, double grho, double &sx, double &v1x, double &v2x)
+    {
+        const double third = 1.0 / 3.0, c1 = 0.75 / M_PI, c2 = 3.093667726280136, c5 = 4.0 * third;
+        const double k = (iflag == 2) ? 1.2450 : 0.804;
+        const double mu = (iflag == 3) ? 0.12345679012345679012 : 0.21951;
+
+        double agrho = std::sqrt(grho);
+        double kf = c2 * std::pow(rho, 1.0 / 3.0);
+        double dsg = 0.5 / kf;
+        double s1 = agrho * dsg / rho;
+        double s2 = s1 * s1;
+        double ds = -c5 * s1;
+
+        double f1 = s2 * mu / k;
+        double f2 = 1.0 + f1;
+        double f3 = k / f2;
+        double fx = k - f3;
+        double exunif = -c1 * kf;
+        sx = exunif * fx;
+
+        double dxunif = exunif * third;
+        double dfx1 = f2 * f2;
+        double dfx = 2.0 * mu * s1 / dfx1;
+        v1x = sx + dxunif * fx + exunif * dfx * ds;
+        v2x = exunif * dfx * dsg / agrho;
+        sx = sx * rho;
+    }
+};
+
+// PBE correlation without the LDA part. iflag=1 PBE, iflag=2 PBEsol
+template <int iflag> struct XcPbec
+{
+    static inline void eval(double rho, double grho, double &sc, double &v1c, double &v2c)
+    {
+        const double ga = 0.031091;
+        const double be = (iflag == 2) ? 0.046 : 0.066725;
+        const double pi34 = 0.6203504908994;
+        const double xkf = 1.919158292677513, xks = 1.128379167095513;
+
+        double rs = pi34 / std::pow(rho, 1.0 / 3.0);
+        double ec, vc;
+        XcPw::eval(rs, ec, vc);
+        double kf = xkf / rs;
+        double ks = xks * std::sqrt(kf);
+        double t = std::sqrt(grho) / (2.0 * ks * rho);
+        double expe = std::exp(-ec / ga);
+        double af = be / ga * (1.0 / (expe - 1.0));
+        double bf = expe * (vc - ec);
+        double y = af * t * t;
+        double xy = (1.0 + y) / (1.0 + y + y * y);
+        double qy = y * y * (2.0 + y) / ((1.0 + y + y * y) * (1.0 + y + y * y));
+        double s1 = 1.0 + be / ga * t * t * xy;
+        double h0 = ga * std::log(s1);
+        double dh0 = be * t * t / s1 * (-7.0 / 3.0 * xy - qy * (af * bf / be - 7.0 / 3.0));
+        double ddh0 = be / (2.0 * ks * ks * rho) * (xy - qy) / s1;
+        sc = rho * h0;
+        v1c = h0 + dh0;
+        v2c = ddh0;
+    }
+};
+
+// Lee-Yang-Parr correlation, gradient corrected part only
+struct XcGlyp
+{
+    static inline void eval(double rho, double grho, double &sc, double &v1c, double &v2c)
+    {
+        const double a = 0.04918, b = 0.132, c = 0.2533, d = 0.349;
+        double rhom13 = std::pow(rho, -1.0 / 3.0);
+        double om = std::exp(-c * rhom13) / (1.0 + d * rhom13);
+        double xl = 1.0 + (7.0 / 3.0) * (c * rhom13 + d * rhom13 / (1.0 + d * rhom13));
+        double ff = a * b * grho / 24.0;
+        double rhom53 = rhom13 * rhom13 * rhom13 * rhom13 * rhom13;
+        sc = ff * rhom53 * om * xl;
+        double dom = -om * (c + d + c * d * rhom13) / (1.0 + d * rhom13);
+        double dxl = (7.0 / 3.0) * (c + d + 2.0 * c * d * rhom13 + c * d * d * rhom13 * rhom13) /
+                     ((1.0 + d * rhom13) * (1.0 + d * rhom13));
+        double rhom43 = rhom13 * rhom13 * rhom13 * rhom13;
+        v1c = -ff * rhom43 / 3.0 * (5.0 * rhom43 * om * xl + rhom53 * dom * xl + rhom53 * om * dxl);
+        v2c = 2.0 * sc / grho;
+    }
+};
+
+// Returns true if the exchange and correlation selected in the Fortran funct module
+// (iexch, icorr, igcx, igcc) can be evaluated by the batched kernels.
+bool XcBatchSupported(int iexch, int icorr, int igcx, int igcc);
+
+// Batched equivalents of xc() and gcxc() for n points. Points with rho below the
+// Fortran small density cutoff return zeros just like the reference routines.
+void XcLdaBatch(int iexch, int icorr, int n, const double *rho, double *ex, double *ec, double *vx, double *vc);
+void XcGgaBatch(int igcx, int igcc, int n, const double *rho, const double *grho,
+                double *sx, double *sc, double *v1x, double *v2x, double *v1c, double *v2c);
+
+#endif
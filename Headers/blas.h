@@ -94,6 +94,7 @@
 #define		dsyevr		RMG_FC_GLOBAL(dsyevr, DSYEVR)
 #define		zheev		RMG_FC_GLOBAL(zheev, ZHEEV)
 #define		dtrsm		RMG_FC_GLOBAL(dtrsm, DTRSM)
+#define		ztrsm		RMG_FC_GLOBAL(ztrsm, ZTRSM)
 #define		dsygst		RMG_FC_GLOBAL(dsygst, DSYGST)
 #define		zgeev		RMG_FC_GLOBAL(zgeev, ZGEEV)
 #define		zgemv		RMG_FC_GLOBAL(zgemv, ZGEMV)
@@ -111,6 +112,7 @@
 #define		ctrttp		RMG_FC_GLOBAL(ctrttp, CTRTTP)
 #define		ctpttr		RMG_FC_GLOBAL(ctpttr, CTPTTR)
 #define		dtrtri		RMG_FC_GLOBAL(dtrtri, DTRTRI)
+#define		dgeqp3		RMG_FC_GLOBAL(dgeqp3, DGEQP3)
 #define		zgeqp3		RMG_FC_GLOBAL(zgeqp3, ZGEQP3)
 #define		zgeqpf		RMG_FC_GLOBAL(zgeqpf, ZGEQPF)
 #define		zgesvd		RMG_FC_GLOBAL(zgesvd, ZGESVD)
@@ -211,6 +213,7 @@ void dsyevr (char *, char *, char *, int *, double *, int *, double *, double *,
 void dsygvj(int *, char *, char *, int *, double *, int *, double *, int *, double *, double *, int*, int *, int*, int*);
 
 void dtrsm(char *side, char *uplo, char *transa, char *diag, int *M, int *N, double *alpha, double *A, int *lda, double *B, int *ldb);
+void ztrsm(char *side, char *uplo, char *transa, char *diag, int *M, int *N, std::complex<double> *alpha, double *A, int *lda, double *B, int *ldb);
 void dsygst( int *itype, char *uplo, int *N, double *A, int *LDA, double *B, int *LDB, int *INFO );
 double dzasum(int *, double *A, int *);
 void dsygvd(int *itype, char *jobz, char *uplo, int *n, double *a, int *lda, double *b, int *ldb, double *eigs, double *work, int *lwork, int *iwork, int *liwork, int *info);
@@ -228,6 +231,7 @@ void dsytrf(char *, int *, double *, int *, int *, double *, int *, int *);
 void dsytri(char *, int *, double *, int *, int *, double *, int *);
 void dger(int *, int *, double *, double *, int *, double *, int *, double *, int *);
 
+void dgeqp3(int *, int *, double *, int *, int *, double *, double *, int *, int *);
 void zgeqp3(int *, int *, std::complex<double> *, int *, int *, std::complex<double> *, std::complex<double> *, int *, double *, int *);
 void zgeqpf(int *, int *, std::complex<double> *, int *, int *, std::complex<double> *, std::complex<double> *, int *, double *, int *);
 void zgesvd(char *, char *, int *, int *, std::complex<double> *, int *, double *, std::complex<double> *, int*,
@@ -231,6 +231,14 @@
 #define DAVIDSON_SOLVER 1
 #define POISSON_PFFT_SOLVER 1
 
+// Density residual preconditioners
+#define DRHO_PRECOND_KERKER 0
+#define DRHO_PRECOND_TF 1
+
+// Formats for volumetric output
+#define VOLUMETRIC_CUBE 0
+#define VOLUMETRIC_NPY 1
+
 // Fft filtering types
 #define LOW_PASS 0
 #define HIGH_PASS 1
@@ -96,6 +96,9 @@
 /* Restart files are compressed using zfp compressor and this accuracy factor */
 #define RESTART_TOLERANCE  1.0e-09
 
+/* Set in the size of a compressed restart buffer when the tolerance used follows the size */
+#define RESTART_TOLERANCE_FLAG  ((size_t)1 << 63)
+
 #if CUDA_ENABLED || HIP_ENABLED || SYCL_ENABLED
 
     #define MAX_GPU_DEVICES 16
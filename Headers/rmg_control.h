@@ -116,10 +116,16 @@ public:
     bool compressed_infile;
     bool compressed_outfile;
 
+    /** Relative error bound for compressed restart orbitals, zero selects thr_rms */
+    double restart_wave_tolerance;
+
     /** whether to mmap the weights for the projectors weights, work space and orbitals */
     bool nvme_weights;
     bool nvme_work;
     bool nvme_orbitals;
+
+    /** Memory in MB per k-point for orbital blocks paged in from disk. Zero relies on page faults. */
+    int nvme_orbital_cache;
     int nvme_orbital_fd;
     int nvme_work_fd;
     int nvme_weight_fd;
@@ -161,6 +167,9 @@ public:
     /* Hybrid EXC flag */
     int xc_is_hybrid;
     double exx_fraction;
+
+    /* Use the native batched kernels for unpolarized LDA/GGA when the functional is supported */
+    bool batched_xc_kernels;
     int vdw_corr;
     int dftd3_version;
     double Evdw;
@@ -280,6 +289,15 @@ public:
     /** the sprocessor topology used during a restart run */
     bool write_serial_restart;
 
+    /** Write restart data to a single HDF5 file instead of one file per processor. */
+    bool write_hdf5_restart;
+
+    /** Read restart data from a single HDF5 file. Any processor topology may be used. */
+    bool read_hdf5_restart;
+
+    /** Write the per processor restart files from a background thread. */
+    bool async_restart;
+
     /** If true also implies write_serial_restart */
     bool write_qmcpack_restart;
     bool write_qmcpack_restart_localized;
@@ -328,6 +346,9 @@ public:
     /* Renormalize forcecs */
     bool renormalize_forces;
 
+    /* Displacement below which ion contributions are not regenerated in ReinitIonicPotentials */
+    double incremental_reinit_threshold;
+
     /** Number of ions */
     int num_ions;
     
@@ -399,12 +420,16 @@ public:
 
     bool charge_pulay_Gspace;
     bool drho_precond;
+    int drho_precond_type;
     /*Order of Pulay mixing for charge density*/
     int charge_pulay_order;
 
     /*How often to refresh Pulay history*/
     int charge_pulay_refresh;
 
+    /*Storage type for Pulay and Broyden history vectors*/
+    int mixing_history_storage;
+
     /*Order of Broyden mixing for charge density*/
     int charge_broyden_order;
 
@@ -596,6 +621,24 @@ public:
     // Single/double precision delta fft threshold for EXX Vexx computation
     double vexx_fft_threshold;
 
+    // Apply exact exchange through the adaptively compressed (ACE) operator
+    bool exx_ace;
+
+    // Redistribute orbitals for EXX in memory instead of through serial files
+    bool exx_in_memory;
+
+    // Use interpolative separable density fitting for gamma point exact exchange
+    bool exx_isdf;
+
+    // Number of ISDF interpolation points per orbital
+    double isdf_rank_factor;
+
+    // Build gamma point exact exchange from localized (SCDM) occupied orbitals
+    bool exx_localized;
+
+    // Relative overlap below which localized orbital pairs are skipped
+    double exx_pair_threshold;
+
     /* fermi energy */
     double efermi;
 
@@ -834,6 +877,9 @@ public:
     bool cube_vh;
     bool cube_pot;
     std::vector<int> cube_states_list;
+
+    /* Format used for cube_rho, cube_vh and cube_states_list output */
+    int volumetric_output_format;
     std::vector<double> stm_bias_list;
     std::vector<double> stm_height_list;
     
@@ -883,6 +929,9 @@ public:
     bool time_reversal;
     bool frac_symm;
 
+    // Compute symmetry image indices on the fly instead of storing nsym*pbasis tables
+    bool compact_symmetry_indices;
+
    bool wannier90;
    int wannier90_scdm;
    double wannier90_scdm_mu;
@@ -897,6 +946,9 @@ public:
 
    // Non-local block size
    int non_local_block_size;
+
+   // Number of state chunks used to overlap the localized projector ion exchange with the gemms
+   int projector_pipeline_chunks;
    int poisson_solver;
    int dipole_corr[3];
 
@@ -908,6 +960,12 @@ public:
 
    // Flag indicating whether or not to localize the non-local projectors
    bool localize_projectors;
+
+   // Flag indicating whether delocalized projectors are generated per k-point instead of stored
+   bool delocalized_beta_on_the_fly;
+
+   // Flag indicating whether localized projector weights for all k-points are built from one real-space projector
+   bool batched_kpoint_weights;
    bool localize_localpp;
    bool proj_nophase;
 
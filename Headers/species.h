@@ -35,6 +35,7 @@ public:
     void InitSpinOrbit (void);
     void InitPseudo (Lattice &L, BaseGrid *G, bool write_flag);
     void InitSemilocalBessel (void);
+    void GetDelocalizedBeta (double *kvec, std::complex<double> *beta, std::complex<double> *beta_r[3]);
     void InitWeights(bool localize)
     {
         if(localize)
@@ -329,9 +330,19 @@ public:
 
     fftw_complex *phase = NULL;
 
+    /* Projector layout and Clebsch-Gordan tables used to generate delocalized projectors */
+    std::vector<int> proj_ip;
+    std::vector<int> proj_l;
+    std::vector<int> proj_m;
+    std::vector<int> cg_lpx;
+    std::vector<int> cg_lpl;
+    std::vector<double> cg_ap;
+
     /*This will store results of forward fourier transform on the coarse grid */
     fftw_complex *forward_beta=NULL;
     fftw_complex *forward_beta_r[3] = {NULL, NULL, NULL};
+    // forward_beta holds only the k=0 delocalized transform, see InitDelocalizedWeight
+    bool forward_beta_k_independent = false;
     fftw_complex *forward_orbital=NULL;
     fftw_complex *forward_orbital_gamma=NULL;
 
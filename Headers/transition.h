@@ -64,6 +64,8 @@ int init_kpoints (int *mesh, int *is_shift);
 template <typename OrbitalType> void STM_calc (Kpoint<OrbitalType> **Kptr, double *rho, std::vector<double> bias_list, std::vector<double>
 height_list);
 template <typename DataType> void OutputCubeFile(DataType *a, int grid, std::string filename);
+template <typename DataType> void OutputNpyFile(DataType *a, int grid, std::string filename);
+template <typename DataType> void AppendNpzDistributed(std::string zipname, std::string varname, DataType *a, int grid, MPI_Comm comm);
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b);
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b, double *kvec);
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b, int, int, int, double, double, double, int, double *kvec);
@@ -71,6 +73,8 @@ template <typename DataType> void ApplyGradient (DataType *a, DataType *gx, Data
 template <typename DataType> void SumGradientKvec (DataType *a, DataType *b, double *kvec, const char *grid);
 template <typename DataType> void ApplyGradient (DataType *a, DataType *gx, DataType *gy, DataType *gz, int order, const char *grid, BaseGrid *G, TradeImages *T);
 template <typename DataType> void ApplyGradient (DataType *a, DataType *gx, DataType *gy, DataType *gz, int dimx, int dimy, int dimz, int order);
+template <typename DataType> void ApplyDivergence (DataType *ax, DataType *ay, DataType *az, DataType *div, int order, const char *grid);
+template <typename DataType> void ApplyDivergence (DataType *ax, DataType *ay, DataType *az, DataType *div, int order, const char *grid, BaseGrid *G, TradeImages *T);
 template <typename DataType> double ApplyLaplacian (DataType *a, DataType *b, int order, const char *grid);
 template <typename DataType> double ApplyLaplacian (DataType *a, DataType *b, int order, const char *grid, BaseGrid *G, TradeImages *T);
 
@@ -114,6 +118,8 @@ void RmgPrintTimings(MPI_Comm comm, const char *outfile, int steps, int num_ions
 template <typename KpointType>
 void ReinitIonicPotentials (Kpoint<KpointType> **kptr, double * vnuc, double * rhocore, double * rhoc);
 
+template <typename KpointType>
+void GetLocalizedWeightBatched (Kpoint<KpointType> **Kptr, int nkpts, std::vector<bool> *skip = NULL);
 template <typename KpointType>
 void AssignWeight (Kpoint<KpointType> *kptr, SPECIES * sp, int ion, fftw_complex * beptr, KpointType *Nlweight);
 template <typename KpointType>
@@ -198,7 +204,7 @@ void SetLaplacian();
 void WriteHeader (void);
 template <typename T> void AppExx(Kpoint<T> *kptr, T *psi, int N, T *vexx, T* nv);
 void DeviceSynchronize(void);
-void Precond_drho(double *);
+void Precond_drho(double *drho, double *rho);
 template <typename T> void Write_Wfs_forWannier(int kpt_global, Kpoint<T> *kptr, std::vector<bool> exclude_bands, std::string wavefule);
 double GetPlanarAnisotropy(double *density);
 void GetFdFactor(int kidx);
@@ -35,6 +35,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/lexical_cast.hpp>
+#include "hdf5.h"
 #include "BaseGrid.h"
 #include "transition.h"
 
@@ -349,6 +350,14 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
 "choice.",
                      "charge_mixing_type must be either \"Broyden\", \"Linear\" or \"Pulay\". Terminating. ", MIXING_OPTIONS);
     
+    If.RegisterInputKey("mixing_history_storage", NULL, &lc.mixing_history_storage, "Double",
+                     CHECK_AND_TERMINATE, OPTIONAL, mixing_history_storage,
+"Storage used for the Pulay and Broyden history vectors. Float and Zfp both "
+"roughly halve the memory needed for the history at the cost of a small loss "
+"of precision in the extrapolation, which allows deeper histories for large "
+"systems. ",
+                     "mixing_history_storage must be either \"Double\", \"Float\" or \"Zfp\". Terminating. ", MIXING_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("ldau_mixing_type", NULL, &lc.ldau_mixing_type, "Linear",
                      CHECK_AND_TERMINATE, OPTIONAL, charge_mixing_type,
 "RMG supports Pulay and Linear mixing for DFT+U occupation mixing ",
@@ -477,6 +486,41 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "FFT mode for exact exchange computations.",
             "exx mode not supported. Terminating. ", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("exx_ace", &lc.exx_ace, false, 
+            "If true the exact exchange operator is applied in the inner scf steps "
+            "through its adaptively compressed (ACE) form built after each outer "
+            "exx step instead of using fixed V_x|psi> vectors. ", XC_OPTIONS);
+
+    If.RegisterInputKey("exx_in_memory", &lc.exx_in_memory, true, 
+            "If true the orbitals needed for gamma point exact exchange are redistributed "
+            "between nodes with MPI. If false they are written to and read back from a "
+            "serial wavefunction file which uses less memory but is slow on parallel "
+            "filesystems. ", XC_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("exx_isdf", &lc.exx_isdf, false, 
+            "If true gamma point exact exchange and the Cholesky factorized integrals "
+            "written for AFQMC use interpolative separable density fitting (ISDF) of "
+            "the orbital pair products. This replaces the fft for every orbital pair "
+            "with one fft per interpolation point. Requires exx_mode=\"Local fft\". ", XC_OPTIONS);
+
+    If.RegisterInputKey("isdf_rank_factor", &lc.isdf_rank_factor, 1.0, 64.0, 8.0,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of ISDF interpolation points per orbital. Larger values are more "
+            "accurate and more expensive. ",
+            "isdf_rank_factor must lie in the range (1.0,64.0). Resetting to default value of 8.0. ", XC_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("exx_localized", &lc.exx_localized, false, 
+            "If true gamma point exact exchange is built from localized occupied orbitals "
+            "obtained with the SCDM method and orbital pairs that do not overlap are "
+            "skipped. For insulators the number of pairs then grows linearly with system "
+            "size. Most effective with screened hybrids such as HSE. ", XC_OPTIONS);
+
+    If.RegisterInputKey("exx_pair_threshold", &lc.exx_pair_threshold, 1.0e-12, 1.0e-1, 1.0e-5,
+            CHECK_AND_FIX, OPTIONAL,
+            "Pairs of localized orbitals whose overlap of absolute values relative to "
+            "their norms is below this value are skipped when exx_localized is true. ",
+            "exx_pair_threshold must lie in the range (1.0e-12,1.0e-1). Resetting to default value of 1.0e-5. ", XC_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("ExxIntCholosky", &lc.ExxIntChol, true, 
             "if set true, Exx integrals are Cholesky factorized to 3-index ");
 
@@ -493,6 +537,12 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "maximum number of Exx integral cholesky vectors ", 
             "exxchol_max * num_states ");
 
+    If.RegisterInputKey("batched_xc_kernels", &lc.batched_xc_kernels, true,
+            "If true the exchange correlation energy and potential for spin unpolarized "
+            "LDA and GGA functionals are computed with native batched kernels instead of "
+            "calling the Fortran routines one grid point at a time. Functionals that the "
+            "kernels do not support always use the Fortran routines. ", XC_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("exx_fraction", &lc.exx_fraction, -1.0, 1.0, -1.0,
             CHECK_AND_FIX, OPTIONAL,
             "when hybrid functional is used, the fraction of Exx",
@@ -504,6 +554,14 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("drho_precond", &lc.drho_precond, true, 
             "if set true, charge density residual is preconded with q^2/(q^2+q0^2) ", MIXING_OPTIONS);
 
+    If.RegisterInputKey("drho_precond_type", NULL, &lc.drho_precond_type, "Kerker",
+                     CHECK_AND_TERMINATE, OPTIONAL, drho_precond_type,
+"Preconditioner applied to the charge density residual when drho_precond is true. "
+"Kerker uses q^2/(q^2+q0^2) with q0 from drho_precond_q0. Thomas-Fermi uses a "
+"local screening length computed from the density which works better for "
+"inhomogeneous systems such as slabs, surfaces and metal/vacuum interfaces. ",
+                     "drho_precond_type must be either \"Kerker\" or \"Thomas-Fermi\". Terminating. ", MIXING_OPTIONS);
+
     If.RegisterInputKey("cube_rho", &lc.cube_rho, false, 
             "if set true, charge density is printed out in cube format ");
 
@@ -513,6 +571,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("cube_pot", &lc.cube_vh, false, 
             "if set true, total potential is printed out in cube format ");
 
+    If.RegisterInputKey("volumetric_output_format", NULL, &lc.volumetric_output_format, "cube",
+                     CHECK_AND_TERMINATE, OPTIONAL, volumetric_output_format,
+"File format for the densities, potentials and orbitals selected by cube_rho, "
+"cube_vh and cube_states_list. cube writes Gaussian cube text files and npy "
+"writes binary NumPy arrays. Both are written collectively by all ranks. ",
+                     "volumetric_output_format must be either \"cube\" or \"npy\". Terminating. ", MISC_OPTIONS);
+
     std::string states_list;
 
     If.RegisterInputKey("cube_states_list", &states_list, "",
@@ -666,6 +731,14 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Maximum ionic time step to use for molecular dynamics or structural optimizations. ",
             "max_ionic_time_step must lie in the range (0.0,150.0). Resetting to the default value of 150.0. ", MD_OPTIONS);
 
+    If.RegisterInputKey("incremental_reinit_threshold", &lc.incremental_reinit_threshold, 0.0, 0.1, 0.0,
+            CHECK_AND_FIX, OPTIONAL,
+            "If greater than zero the local potentials and localized projector weights are "
+            "updated incrementally after each ionic step. Only ions that have moved by more "
+            "than this distance in bohr since their contributions were last generated are "
+            "recomputed. A value of 0.0 disables incremental updates. ",
+            "incremental_reinit_threshold must lie in the range (0.0,0.1). Resetting to the default value of 0.0. ", MD_OPTIONS);
+
     If.RegisterInputKey("qmc_nband", &lc.qmc_nband, 0, INT_MAX, 0, 
             CHECK_AND_FIX, OPTIONAL, 
             "The number of band used in rmg-qmcpack interface. ", 
@@ -929,6 +1002,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Block size to use when applying the non-local and S operators. ",
             "non_local_block_size must lie in the range (64,40000). Resetting to the default value of 512. ", PERF_OPTIONS);
 
+    If.RegisterInputKey("projector_pipeline_chunks", &lc.projector_pipeline_chunks, 1, 32, 1,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of chunks the states are split into when computing localized projections. "
+            "Values larger than 1 overlap the ion ownership communication for one chunk with the "
+            "projector gemm for the next. ",
+            "projector_pipeline_chunks must lie in the range (1,32). Resetting to the default value of 1. ", PERF_OPTIONS);
+
     If.RegisterInputKey("E_POINTS", &lc.E_POINTS, 201, 201, 201,
             CHECK_AND_FIX, OPTIONAL,
             "",
@@ -1008,6 +1088,12 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("frac_symmetry", &lc.frac_symm, true, 
             "For supercell calculation, one can disable the fractional translation symmetry", CELL_OPTIONS);
 
+    If.RegisterInputKey("compact_symmetry_indices", &lc.compact_symmetry_indices, true, 
+            "If true the grid indices of symmetry images used to symmetrize the charge "
+            "density are computed on the fly from the rotation matrices and fractional "
+            "translations. If false they are precomputed and stored for every symmetry "
+            "operation and fine grid point which is faster but uses much more memory. ", CELL_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("rmg2bgw", &lc.rmg2bgw, false, 
             "Write wavefunction in G-space to BerkeleyGW WFN file.", MISC_OPTIONS|EXPERIMENTAL_OPTION);
 
@@ -1128,6 +1214,24 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Directs RMG to read from serial restart files. Normally used when changing "
             "the sprocessor topology used during a restart run ", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("write_hdf5_restart", &lc.write_hdf5_restart, false,
+            "Write the restart data to a single HDF5 file with one dataset for each of the "
+            "potentials and for the orbitals of each k-point instead of one file per processor. "
+            "The file is written collectively so HDF5 must be built with MPI support. Not "
+            "available for structure relaxation, molecular dynamics or NEB since the orbital "
+            "extrapolation between ionic steps reads the per processor restart files.", CONTROL_OPTIONS);
+
+    If.RegisterInputKey("read_hdf5_restart", &lc.read_hdf5_restart, false,
+            "Directs RMG to read from a restart file written with write_hdf5_restart. The "
+            "processor topology and number of k-point groups may differ from the run that "
+            "wrote the file.", CONTROL_OPTIONS);
+
+    If.RegisterInputKey("async_restart", &lc.async_restart, false,
+            "If true the orbitals and potentials of the per processor restart files are copied "
+            "to a staging buffer and written by a background thread while the calculation "
+            "continues. A restart write only blocks if the previous one has not finished. "
+            "Requires memory for a second copy of the orbitals.", CONTROL_OPTIONS);
+
     If.RegisterInputKey("write_qmcpack_restart", &lc.write_qmcpack_restart, false,
             "If true then a QMCPACK restart file is written as well as a serial restart file.", CONTROL_OPTIONS);
 
@@ -1140,6 +1244,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("compressed_outfile", &lc.compressed_outfile, true,
             "Flag indicating whether or not  parallel output wavefunction file uses compressed format.", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("restart_wave_tolerance", &lc.restart_wave_tolerance, 0.0, 1.0e-3, 0.0,
+            CHECK_AND_FIX, OPTIONAL,
+            "Error bound for orbitals in compressed restart files relative to the largest value "
+            "of each orbital. A value of zero uses rms_convergence_criterion. Orbitals read from "
+            "compressed files are reorthogonalized on restart.",
+            "restart_wave_tolerance must lie in the range (0.0, 1.0e-3). Resetting to the default value of 0.0. ", CONTROL_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("nvme_weights", &lc.nvme_weights, false,
             "Flag indicating whether or not projector weights should be mapped to disk.", CONTROL_OPTIONS);
 
@@ -1149,6 +1260,16 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("nvme_orbitals", &lc.nvme_orbitals, false,
             "Flag indicating whether or not orbitals should be mapped to disk.", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("nvme_orbital_cache", &lc.nvme_orbital_cache, 0, 1000000, 0,
+            CHECK_AND_FIX, OPTIONAL,
+            "Memory in MB per k-point for orbitals mapped to disk with nvme_orbitals. If nonzero "
+            "the solvers read the next block of orbitals ahead and write finished blocks back "
+            "on a background thread and the oldest blocks are dropped from memory once this "
+            "limit is reached. Smaller values than two blocks of non_local_block_size orbitals "
+            "are raised to that size. If zero orbitals are paged in on demand by the operating "
+            "system. Ignored in GPU builds where the orbitals are never mapped to disk.",
+            "nvme_orbital_cache must lie in the range (0, 1000000). Resetting to the default value of 0. ", CONTROL_OPTIONS);
+
     If.RegisterInputKey("alt_laplacian", &lc.alt_laplacian, true,
             "Flag indicating whether or not to use alternate laplacian weights for some operators.", MISC_OPTIONS|EXPERT_OPTION);
 
@@ -1173,6 +1294,22 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "or delocalized projectors so it is better to set localize_projectors "
             "to false.", PSEUDO_OPTIONS);
 
+    If.RegisterInputKey("delocalized_beta_on_the_fly", &lc.delocalized_beta_on_the_fly, false,
+            "When delocalized projectors are used the forward transforms of the beta "
+            "functions are normally stored for every k-point. If this is set to true "
+            "only one k-independent transform is stored per species and the Bloch "
+            "phase is applied in real space when the projector weights are computed. "
+            "Species whose projectors overlap their own periodic images are "
+            "regenerated for one k-point at a time instead. This greatly reduces "
+            "memory use for large k-point sets.", PSEUDO_OPTIONS);
+
+    If.RegisterInputKey("batched_kpoint_weights", &lc.batched_kpoint_weights, false,
+            "When localized projectors are used with multiple k-points the real-space "
+            "projector for each ion is generated once and the weights for every k-point "
+            "are obtained by applying the Bloch phase. This removes most of the per "
+            "k-point cost of generating the weights after each ionic step and only the "
+            "k-independent forward transforms are stored.", PSEUDO_OPTIONS);
+
     If.RegisterInputKey("localize_localpp", &lc.localize_localpp, true,
             "The local potential associated with a particular ion also decays "
             "rapidly in real-space with increasing r. As with beta projectors "
@@ -1737,6 +1874,23 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
         lc.drho_precond = false;
     }
 
+    // Without parallel HDF5 the ranks would have to write the single file one at a time
+#ifndef H5_HAVE_PARALLEL
+    if(lc.write_hdf5_restart)
+    {
+        rmg_error_handler (__FILE__, __LINE__, "\nError. write_hdf5_restart requires an HDF5 library built with MPI support. Terminating.\n\n");
+    }
+#endif
+
+    // Orbital extrapolation between ionic steps reads the previous step from the per
+    // processor restart files which are not written with write_hdf5_restart.
+    if(lc.write_hdf5_restart &&
+       ((lc.forceflag == MD_FASTRLX) || (lc.forceflag == MD_CVE) || (lc.forceflag == MD_CVT) ||
+        (lc.forceflag == MD_CPT) || (lc.forceflag == NEB_RELAX)))
+    {
+        rmg_error_handler (__FILE__, __LINE__, "\nError. write_hdf5_restart is not supported for structure relaxation, molecular dynamics\nor NEB calculations. Terminating.\n\n");
+    }
+
     // Force grad order must match kohn_sham_fd_order unless fft is chose
     if(lc.force_grad_order != lc.kohn_sham_fd_order) lc.force_grad_order = 0;
 }
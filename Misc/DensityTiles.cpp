@@ -0,0 +1,57 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "DensityTiles.h"
+
+
+size_t DensityTileSize(size_t n)
+{
+    size_t nthreads = std::max(omp_get_max_threads(), 1);
+    size_t tsize = (n + nthreads - 1) / nthreads;
+
+    // Keep tiles a multiple of 64 points so they start on cache line boundaries
+    tsize = ((tsize + 63) / 64) * 64;
+    return std::max(std::min(tsize, (size_t)DENSITY_TILE_SIZE), (size_t)64);
+}
+
+void ReduceThreadBuffers(std::vector<double *> &bufs, double *out, size_t n)
+{
+    size_t tsize = DensityTileSize(n);
+    size_t ntiles = (n + tsize - 1) / tsize;
+    int nbufs = bufs.size();
+
+#pragma omp parallel for schedule(static)
+    for(size_t tile = 0;tile < ntiles;tile++)
+    {
+        size_t start = tile * tsize;
+        size_t stop = std::min(start + tsize, n);
+        for(int ib = 0;ib < nbufs;ib++)
+        {
+            double *buf = bufs[ib];
+#pragma omp simd
+            for(size_t idx = start;idx < stop;idx++) out[idx] += buf[idx];
+        }
+    }
+}
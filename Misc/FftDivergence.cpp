@@ -0,0 +1,145 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <math.h>
+#include <float.h>
+#include <complex>
+#include <iostream>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "const.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "RmgException.h"
+#include "RmgSumAll.h"
+#include "transition.h"
+#include "RmgParallelFft.h"
+
+// Computes div(f) = df_x/dx + df_y/dy + df_z/dz spectrally. Each component is
+// transformed forward once and the three derivatives are summed in reciprocal
+// space so only a single inverse transform is needed.
+
+void FftDivergenceCoarse(double *fx, double *fy, double *fz, double *div)
+{
+    FftDivergence(fx, fy, fz, div, *coarse_pwaves);
+}
+
+void FftDivergenceCoarse(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div)
+{
+    FftDivergence(fx, fy, fz, div, *coarse_pwaves);
+}
+
+void FftDivergenceFine(double *fx, double *fy, double *fz, double *div)
+{
+    FftDivergence(fx, fy, fz, div, *fine_pwaves);
+}
+
+void FftDivergenceFine(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div)
+{
+    FftDivergence(fx, fy, fz, div, *fine_pwaves);
+}
+
+void FftDivergence(double *fx, double *fy, double *fz, double *div, Pw &pwaves)
+{
+
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double scale = 1.0 / (double)pwaves.global_basis;
+    int isize = pwaves.pbasis;
+
+    std::complex<double> czero(0.0,0.0);
+    std::complex<double> ci(0.0,1.0);
+    std::complex<double> *tx = new std::complex<double>[isize];
+    std::complex<double> *cdiv = new std::complex<double>[isize];
+
+    double gcut = pwaves.gcut;
+    for(int ig=0;ig < isize;ig++) cdiv[ig] = czero;
+
+    for(int icar=0;icar < 3;icar++) {
+
+        double *ts;
+        if(icar == 0) ts = fx;
+        if(icar == 1) ts = fy;
+        if(icar == 2) ts = fz;
+
+        for(int ix = 0;ix < isize;ix++) {
+            tx[ix] = std::complex<double>(ts[ix], 0.0);
+        }
+
+        pwaves.FftForward(tx, tx);
+
+        for(int ig=0;ig < isize;ig++) {
+            if(pwaves.gmags[ig] < gcut)
+                cdiv[ig] += ci * tpiba * pwaves.g[ig].a[icar] * tx[ig];
+        }
+    }
+
+    pwaves.FftInverse(cdiv, cdiv);
+
+    for(int ix=0;ix < isize;ix++) div[ix] = scale * std::real(cdiv[ix]);
+
+    delete [] cdiv;
+    delete [] tx;
+}
+
+void FftDivergence(std::complex<double> *fx, std::complex<double> *fy, std::complex<double> *fz, std::complex<double> *div, Pw &pwaves)
+{
+
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double scale = 1.0 / (double)pwaves.global_basis;
+    int isize = pwaves.pbasis;
+
+    std::complex<double> czero(0.0,0.0);
+    std::complex<double> ci(0.0,1.0);
+    std::complex<double> *tx = new std::complex<double>[isize];
+    std::complex<double> *cdiv = new std::complex<double>[isize];
+
+    double gcut = pwaves.gcut;
+    for(int ig=0;ig < isize;ig++) cdiv[ig] = czero;
+
+    for(int icar=0;icar < 3;icar++) {
+
+        std::complex<double> *ts;
+        if(icar == 0) ts = fx;
+        if(icar == 1) ts = fy;
+        if(icar == 2) ts = fz;
+
+        for(int ix = 0;ix < isize;ix++) {
+            tx[ix] = ts[ix];
+        }
+
+        pwaves.FftForward(tx, tx);
+
+        for(int ig=0;ig < isize;ig++) {
+            if(pwaves.gmags[ig] < gcut)
+                cdiv[ig] += ci * tpiba * pwaves.g[ig].a[icar] * tx[ig];
+        }
+    }
+
+    pwaves.FftInverse(cdiv, cdiv);
+
+    for(int ix=0;ix < isize;ix++) div[ix] = scale * cdiv[ix];
+
+    delete [] cdiv;
+    delete [] tx;
+}
@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <cstdint>
+#include <algorithm>
+#include "OrbitalPager.h"
+
+
+OrbitalPager::OrbitalPager(int fd, void *map_base, void *base, size_t orbital_bytes, int num_orbitals, size_t cache_bytes)
+{
+    this->fd = fd;
+    this->map_base = (char *)map_base;
+    this->base = (char *)base;
+    this->orbital_bytes = orbital_bytes;
+    this->num_orbitals = num_orbitals;
+    this->cache_bytes = cache_bytes;
+    this->page_size = sysconf(_SC_PAGESIZE);
+    this->resident_bytes = 0;
+    this->busy = 0;
+    this->done = false;
+    this->io_thread = std::thread(&OrbitalPager::worker, this);
+}
+
+OrbitalPager::~OrbitalPager(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->done = true;
+    }
+    this->cv.notify_all();
+    this->io_thread.join();
+}
+
+// Page aligned extent of orbitals [first, first+count) in memory and in the file.
+// Unless outer is set ranges only cover whole pages inside the block so neighbouring
+// blocks are not evicted when the block boundary falls inside a page.
+void OrbitalPager::page_range(int first, int count, bool outer, char *&start, size_t &length, size_t &offset)
+{
+    first = std::max(first, 0);
+    count = std::min(count, this->num_orbitals - first);
+    char *b = this->base + (size_t)first * this->orbital_bytes;
+    char *e = b + (size_t)std::max(count, 0) * this->orbital_bytes;
+    size_t boff = (uintptr_t)b % page_size;
+    size_t eoff = (uintptr_t)e % page_size;
+    if(outer)
+    {
+        start = b - boff;
+        if(eoff) e = e + (page_size - eoff);
+    }
+    else
+    {
+        start = (boff) ? b + (page_size - boff) : b;
+        e = e - eoff;
+    }
+    length = (e > start) ? (size_t)(e - start) : 0;
+    offset = (size_t)(start - this->map_base);
+}
+
+void OrbitalPager::Prefetch(int first, int count)
+{
+    if(count <= 0 || first >= this->num_orbitals) return;
+    count = std::min(count, this->num_orbitals - first);
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        PagerTask task = {PAGER_PREFETCH, first, count};
+        this->queue.push_back(task);
+
+        // Evict the oldest blocks if the cache would overflow
+        this->resident.push_back(task);
+        this->resident_bytes += (size_t)count * this->orbital_bytes;
+        while(this->resident_bytes > this->cache_bytes && this->resident.size() > 1)
+        {
+            PagerTask old = this->resident.front();
+            this->resident.pop_front();
+            this->resident_bytes -= (size_t)old.count * this->orbital_bytes;
+            old.op = PAGER_EVICT;
+            this->queue.push_back(old);
+        }
+    }
+    this->cv.notify_all();
+}
+
+void OrbitalPager::WriteBehind(int first, int count)
+{
+    if(count <= 0 || first >= this->num_orbitals) return;
+    count = std::min(count, this->num_orbitals - first);
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        PagerTask task = {PAGER_WRITE, first, count};
+        this->queue.push_back(task);
+    }
+    this->cv.notify_all();
+}
+
+void OrbitalPager::Wait(void)
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->cv.wait(guard, [this]{ return this->queue.empty() && !this->busy; });
+}
+
+void OrbitalPager::worker(void)
+{
+    while(true)
+    {
+        PagerTask task;
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->cv.wait(guard, [this]{ return this->done || !this->queue.empty(); });
+            if(this->queue.empty()) return;
+            task = this->queue.front();
+            this->queue.pop_front();
+            this->busy = 1;
+        }
+
+        char *start;
+        size_t length, offset;
+        this->page_range(task.first, task.count, task.op == PAGER_PREFETCH, start, length, offset);
+        if(length)
+        {
+            if(task.op == PAGER_PREFETCH)
+            {
+                // Fault the pages in here so the compute threads find them resident
+                madvise(start, length, MADV_WILLNEED);
+                volatile char sum = 0;
+                for(size_t idx = 0;idx < length;idx += this->page_size) sum += start[idx];
+            }
+            else if(task.op == PAGER_WRITE)
+            {
+                // Only start the writeback. Blocks are flushed synchronously on eviction.
+                msync(start, length, MS_ASYNC);
+            }
+            else
+            {
+                // Dirty pages are written first so dropping them never loses data
+                msync(start, length, MS_SYNC);
+                madvise(start, length, MADV_DONTNEED);
+                posix_fadvise(this->fd, offset, length, POSIX_FADV_DONTNEED);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->busy = 0;
+        }
+        this->cv.notify_all();
+    }
+}
@@ -44,15 +44,6 @@ template <typename T> void OutputCubeFile(T *array_dist, int grid, std::string f
     starts[2] = FPZ_OFFSET;
 
     double *array_d = (double *)array_dist;
-    // number of doubles in the last dimension
-    // number of lines in the output
-    // numbe of char for the last dimension
-    int num_d = subsizes[2] * sizeof(T)/sizeof(double);
-    int num_lines = (num_d + 5)/6;
-    int num_char = (6 * 12 +1) * num_lines +1;
-
-    char *array_print = new char[subsizes[0] * subsizes[1] * num_char];
-
     int nval = sizeof(T)/sizeof(double);
     if(pct.gridpe == 0 )
     {
@@ -88,12 +79,25 @@ template <typename T> void OutputCubeFile(T *array_dist, int grid, std::string f
         fclose(fhand);
     }
 
+    // Values along z are written 6 to a line with the line breaks placed by the global
+    // z index. Each rank's part of a row then has a fixed position in the file so the
+    // rows are assembled correctly for any processor grid.
+    int nz = sizes[2] * nval;
+    int z0 = starts[2] * nval;
+    int z1 = z0 + subsizes[2] * nval;
+    int row_chars = 12 * nz + nz / 6 + ((nz % 6) ? 1 : 0);
+    int start_char = 12 * z0 + z0 / 6;
+    int end_char = (z1 == nz) ? row_chars : 12 * z1 + z1 / 6;
+    int num_char = end_char - start_char;
+
+    char *array_print = new char[(size_t)subsizes[0] * subsizes[1] * num_char + 1];
     char *buffer = array_print;
     for (int i=0; i<subsizes[0]; i++) {
         for (int j=0; j<subsizes[1]; j++) {
             for (int k=0; k<subsizes[2] * nval; k++) {
-                int idx = i * subsizes[1] * subsizes[2] + j * subsizes[2] + k;
-                if(k%6 == 5)
+                size_t idx = ((size_t)i * subsizes[1] + j) * subsizes[2] * nval + k;
+                int g = z0 + k;
+                if((g%6 == 5) || (g == nz - 1))
                 {
                     sprintf(buffer,  "%12.3e\n", array_d[idx]);
                     buffer += 13;
@@ -104,26 +108,14 @@ template <typename T> void OutputCubeFile(T *array_dist, int grid, std::string f
                     buffer += 12;
                 }
             }
-            sprintf(buffer,  "\n");
-            buffer +=1;
-
         }
     }
 
     int order = MPI_ORDER_C;
 
-    int tot_num_char = num_char * pct.pe_z;
+    sizes[2] = row_chars;
     subsizes[2] = num_char;
-    sizes[2] = tot_num_char;
- 
-    int pex, pey, pez;
-    pe2xyz (pct.gridpe, &pex, &pey, &pez);
-    starts[2] = pez * num_char;
-    if(sizes[2]/subsizes[2] * subsizes[2] != sizes[2])
-    {
-       printf("\n WARNING: grid not divisible by PE_Z, cube file may not be correct\n");
-
-    }
+    starts[2] = start_char;
 
     MPI_Info fileinfo;
     MPI_Datatype grid_char;
@@ -149,5 +141,8 @@ template <typename T> void OutputCubeFile(T *array_dist, int grid, std::string f
     MPI_File_write_all(mpi_fhand, array_print, pbasis_char, MPI_CHAR, &status);
     MPI_File_close(&mpi_fhand);
 
-}
+    MPI_Type_free(&grid_char);
+    MPI_Info_free(&fileinfo);
+    delete [] array_print;
 
+}
@@ -0,0 +1,256 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex>
+#include <map>
+#include <vector>
+#include "transition.h"
+#include "RmgException.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include "cnpy.h"
+#endif
+
+/*
+
+  Writes distributed grid arrays to NumPy files without assembling the global array.
+  Rank 0 writes the headers and every rank then writes its own block of the grid with
+  a collective MPI-IO call, so memory use stays proportional to the local subdomain.
+
+*/
+
+template void OutputNpyFile(double *, int, std::string);
+template void OutputNpyFile(std::complex<double> *, int, std::string);
+template void AppendNpzDistributed(std::string, std::string, double *, int, MPI_Comm);
+template void AppendNpzDistributed(std::string, std::string, std::complex<double> *, int, MPI_Comm);
+
+#if !(defined(_WIN32) || defined(_WIN64))
+
+static void local_block(int grid, int *sizes, int *subsizes, int *starts)
+{
+    sizes[0] = Rmg_G->get_NX_GRID(grid);
+    sizes[1] = Rmg_G->get_NY_GRID(grid);
+    sizes[2] = Rmg_G->get_NZ_GRID(grid);
+    subsizes[0] = Rmg_G->get_PX0_GRID(grid);
+    subsizes[1] = Rmg_G->get_PY0_GRID(grid);
+    subsizes[2] = Rmg_G->get_PZ0_GRID(grid);
+    starts[0] = Rmg_G->get_PX_OFFSET(grid);
+    starts[1] = Rmg_G->get_PY_OFFSET(grid);
+    starts[2] = Rmg_G->get_PZ_OFFSET(grid);
+}
+
+// Writes the local block of the array into a C ordered global array starting at
+// byte disp of an existing file.
+template <typename T>
+static void write_block(MPI_Comm comm, std::string &filename, MPI_Offset disp, T *array, int grid)
+{
+    int sizes[3], subsizes[3], starts[3];
+    local_block(grid, sizes, subsizes, starts);
+
+    MPI_Datatype elem, block;
+    MPI_Type_contiguous(sizeof(T)/sizeof(double), MPI_DOUBLE, &elem);
+    MPI_Type_commit(&elem);
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, elem, &block);
+    MPI_Type_commit(&block);
+
+    MPI_File mpi_fhand;
+    MPI_Status status;
+    if(MPI_File_open(comm, filename.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &mpi_fhand) != MPI_SUCCESS)
+        throw RmgFatalException() << "Unable to open " << filename << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    MPI_File_set_view(mpi_fhand, disp, elem, block, "native", MPI_INFO_NULL);
+    MPI_File_write_all(mpi_fhand, array, subsizes[0] * subsizes[1] * subsizes[2], elem, &status);
+    MPI_File_close(&mpi_fhand);
+
+    MPI_Type_free(&block);
+    MPI_Type_free(&elem);
+}
+
+// CRC32 of len zero bytes. Long runs are built from their halves.
+static uLong crc_zeros(size_t len)
+{
+    static std::map<size_t, uLong> cache;
+    static std::vector<unsigned char> zeros(65536, 0);
+
+    auto it = cache.find(len);
+    if(it != cache.end()) return it->second;
+
+    uLong crc;
+    if(len <= zeros.size())
+    {
+        crc = crc32(0L, zeros.data(), (uInt)len);
+    }
+    else
+    {
+        size_t half = len / 2;
+        crc = crc32_combine(crc_zeros(half), crc_zeros(len - half), (z_off_t)(len - half));
+    }
+    cache[len] = crc;
+    return crc;
+}
+
+// CRC32 of the global array in file order. The CRC is affine in the data so it is the
+// XOR over ranks of the CRC of each rank's block padded with zeros to the full length,
+// corrected by the CRC of the zero array when the number of ranks is even.
+template <typename T>
+static uLong distributed_crc(T *array, int grid, MPI_Comm comm)
+{
+    int sizes[3], subsizes[3], starts[3];
+    local_block(grid, sizes, subsizes, starts);
+
+    size_t run = (size_t)subsizes[2] * sizeof(T);
+    size_t total = (size_t)sizes[0] * sizes[1] * sizes[2] * sizeof(T);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    size_t pos = 0;
+    for(int ix = 0;ix < subsizes[0];ix++)
+    {
+        for(int iy = 0;iy < subsizes[1];iy++)
+        {
+            size_t start = (((size_t)(ix + starts[0]) * sizes[1] + iy + starts[1]) * sizes[2] + starts[2]) * sizeof(T);
+            crc = crc32_combine(crc, crc_zeros(start - pos), (z_off_t)(start - pos));
+            unsigned char *p = (unsigned char *)&array[((size_t)ix * subsizes[1] + iy) * subsizes[2]];
+            crc = crc32_combine(crc, crc32(0L, p, (uInt)run), (z_off_t)run);
+            pos = start + run;
+        }
+    }
+    crc = crc32_combine(crc, crc_zeros(total - pos), (z_off_t)(total - pos));
+
+    int npes;
+    unsigned long lcrc = crc, gcrc;
+    MPI_Comm_size(comm, &npes);
+    MPI_Allreduce(&lcrc, &gcrc, 1, MPI_UNSIGNED_LONG, MPI_BXOR, comm);
+    if(npes % 2 == 0) gcrc ^= crc_zeros(total);
+    return gcrc;
+}
+
+#endif
+
+
+// Writes a distributed array on the coarse (grid=1) or fine grid to a .npy file.
+template <typename T> void OutputNpyFile(T *array_dist, int grid, std::string filename)
+{
+#if !(defined(_WIN32) || defined(_WIN64))
+    RmgTimer RT0("NpyFile output");
+
+    unsigned int shape[3] = {(unsigned int)Rmg_G->get_NX_GRID(grid), (unsigned int)Rmg_G->get_NY_GRID(grid), (unsigned int)Rmg_G->get_NZ_GRID(grid)};
+    std::vector<char> header = cnpy::create_npy_header(array_dist, shape, 3);
+
+    if(pct.gridpe == 0)
+    {
+        FILE *fhand = fopen(filename.c_str(), "wb");
+        if(!fhand)
+            throw RmgFatalException() << "Unable to create " << filename << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+        fwrite(header.data(), sizeof(char), header.size(), fhand);
+        fclose(fhand);
+    }
+    MPI_Barrier(pct.grid_comm);
+
+    write_block(pct.grid_comm, filename, (MPI_Offset)header.size(), array_dist, grid);
+#endif
+}
+
+
+// Appends a distributed array as varname.npy to an existing uncompressed .npz archive
+// such as one created by cnpy::npz_save. The entry is laid out as cnpy does it.
+template <typename T> void AppendNpzDistributed(std::string zipname, std::string varname, T *array_dist, int grid, MPI_Comm comm)
+{
+#if !(defined(_WIN32) || defined(_WIN64))
+    using cnpy::operator+=;
+    RmgTimer RT0("NpzFile output");
+
+    unsigned int shape[3] = {(unsigned int)Rmg_G->get_NX_GRID(grid), (unsigned int)Rmg_G->get_NY_GRID(grid), (unsigned int)Rmg_G->get_NZ_GRID(grid)};
+    std::vector<char> npy_header = cnpy::create_npy_header(array_dist, shape, 3);
+    size_t data_bytes = (size_t)shape[0] * shape[1] * shape[2] * sizeof(T);
+    unsigned int nbytes = data_bytes + npy_header.size();
+    std::string fname = varname + ".npy";
+
+    uLong crc = distributed_crc(array_dist, grid, comm);
+    crc = crc32_combine(crc32(0L, (unsigned char *)npy_header.data(), npy_header.size()), crc, (z_off_t)data_bytes);
+
+    int rank;
+    MPI_Offset disp = 0;
+    MPI_Comm_rank(comm, &rank);
+    if(rank == 0)
+    {
+        unsigned short nrecs;
+        unsigned int global_header_size, global_header_offset;
+        FILE *fp = fopen(zipname.c_str(), "r+b");
+        if(!fp)
+            throw RmgFatalException() << "Unable to open " << zipname << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+        cnpy::parse_zip_footer(fp, nrecs, global_header_size, global_header_offset);
+        std::vector<char> global_header(global_header_size);
+        fseek(fp, global_header_offset, SEEK_SET);
+        if(fread(global_header.data(), sizeof(char), global_header_size, fp) != global_header_size)
+            throw RmgFatalException() << "Error reading " << zipname << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+
+        std::vector<char> local_header;
+        local_header += "PK";
+        local_header += (unsigned short) 0x0403;
+        local_header += (unsigned short) 20;
+        local_header += (unsigned short) 0;
+        local_header += (unsigned short) 0;
+        local_header += (unsigned short) 0;
+        local_header += (unsigned short) 0;
+        local_header += (unsigned int) crc;
+        local_header += (unsigned int) nbytes;
+        local_header += (unsigned int) nbytes;
+        local_header += (unsigned short) fname.size();
+        local_header += (unsigned short) 0;
+        local_header += fname;
+
+        global_header += "PK";
+        global_header += (unsigned short) 0x0201;
+        global_header += (unsigned short) 20;
+        global_header.insert(global_header.end(), local_header.begin()+4, local_header.begin()+30);
+        global_header += (unsigned short) 0;
+        global_header += (unsigned short) 0;
+        global_header += (unsigned short) 0;
+        global_header += (unsigned int) 0;
+        global_header += (unsigned int) global_header_offset;
+        global_header += fname;
+
+        std::vector<char> footer;
+        footer += "PK";
+        footer += (unsigned short) 0x0605;
+        footer += (unsigned short) 0;
+        footer += (unsigned short) 0;
+        footer += (unsigned short) (nrecs+1);
+        footer += (unsigned short) (nrecs+1);
+        footer += (unsigned int) global_header.size();
+        footer += (unsigned int) (global_header_offset + nbytes + local_header.size());
+        footer += (unsigned short) 0;
+
+        // The new entry replaces the old central directory, which is rewritten after the data
+        fseek(fp, global_header_offset, SEEK_SET);
+        fwrite(local_header.data(), sizeof(char), local_header.size(), fp);
+        fwrite(npy_header.data(), sizeof(char), npy_header.size(), fp);
+        disp = global_header_offset + local_header.size() + npy_header.size();
+        fseek(fp, disp + data_bytes, SEEK_SET);
+        fwrite(global_header.data(), sizeof(char), global_header.size(), fp);
+        fwrite(footer.data(), sizeof(char), footer.size(), fp);
+        fclose(fp);
+    }
+    MPI_Bcast(&disp, 1, MPI_OFFSET, 0, comm);
+
+    write_block(comm, zipname, disp, array_dist, grid);
+#endif
+}
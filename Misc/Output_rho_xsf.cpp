@@ -28,7 +28,6 @@ void Output_rho_xsf(double *array_3d, MPI_Comm comm)
     MPI_Datatype num_as_string;
     MPI_Datatype localarray;
     int FPX_OFFSET, FPY_OFFSET, FPZ_OFFSET, idx; 
-    int idx1;
     char *const fmt="%12.6e ";
     char *const endfmt="%12.6e\n";
     const int charspernum=13;
@@ -66,7 +65,7 @@ void Output_rho_xsf(double *array_3d, MPI_Comm comm)
 
     char *array_in_char;
 
-    array_in_char = new char[sizes[0] * sizes[1] * sizes[2] *charspernum];
+    array_in_char = new char[(size_t)subsizes[0] * subsizes[1] * subsizes[2] * charspernum + 1];
 
     int count = 0;
     for (int k=0; k<subsizes[2]; k++) {
@@ -172,25 +171,10 @@ void Output_rho_xsf(double *array_3d, MPI_Comm comm)
         cell[i+6] = Rmg_L.a2[i];
     }
     const unsigned int shape[] = {3,3};
-    cnpy::npz_save(newname, "cell", cell, shape, 2, "w");
-
-    int length = sizes[0] * sizes[1] * sizes[2];
-    double *g_array = new double[sizes[0] * sizes[1] * sizes[2]];
-    for(idx = 0; idx < sizes[0] * sizes[1] * sizes[2]; idx++) g_array[idx] = 0.0;
-    for(int i = 0; i < subsizes[0]; i++)
-    for(int j = 0; j < subsizes[1]; j++)
-    for(int k = 0; k < subsizes[2]; k++)
-    { 
-
-      idx = i * subsizes[1] * subsizes[2] + j * subsizes[2] + k;
-      idx1 = (i+starts[0]) * sizes[1] * sizes[2] + (j+ starts[1]) * sizes[2] + k + starts[2];
-      g_array[idx1] = array_3d[idx];
-    }
+    if(pct.gridpe == 0) cnpy::npz_save(newname, "cell", cell, shape, 2, "w");
+    MPI_Barrier(comm);
 
-    MPI_Allreduce(MPI_IN_PLACE, g_array, length, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
- 
-    const unsigned int shape1[] = {(unsigned int)sizes[0], (unsigned int)sizes[1], (unsigned int)sizes[2]};
-    cnpy::npz_save(newname, "density", g_array, shape1, 3, "a");
+    AppendNpzDistributed(std::string(newname), std::string("density"), array_3d, Rmg_G->default_FG_RATIO, comm);
 #endif
 
 }
@@ -8,8 +8,26 @@
 #include "transition.h"
 #include "RmgParallelFft.h"
 #include "RmgException.h"
+#include "RmgTimer.h"
 
-void Precond_drho(double *drho)
+// Maximum conjugate gradient steps and relative residual for the Thomas-Fermi preconditioner
+#define TF_PRECOND_MAXIT 30
+#define TF_PRECOND_TOL 1.0e-3
+
+static void Precond_drho_kerker(double *drho);
+static void Precond_drho_tf(double *drho, double *rho);
+
+// Preconditions the density residual drho. rho is the input density of the step
+// and is only referenced by the Thomas-Fermi preconditioner.
+void Precond_drho(double *drho, double *rho)
+{
+    if(ct.drho_precond_type == DRHO_PRECOND_TF)
+        Precond_drho_tf(drho, rho);
+    else
+        Precond_drho_kerker(drho);
+}
+
+static void Precond_drho_kerker(double *drho)
 {
 
     // Kerker preconditioning parameter q0 in unit of au^-1;
@@ -44,3 +62,116 @@ void Precond_drho(double *drho)
         for(size_t i = 0;i < pbasis;i++) drho[is*pbasis + i] = std::real(c_fm[i])/(double)fine_pwaves->global_basis;
     }
 }
+
+
+// out = IFFT[w(G) FFT[in]] with w = G^2 if q2 < 0 and w = 1/(G^2 + q2) otherwise.
+// The G=0 term uses the smallest G^2 as in the Kerker preconditioner above.
+static void GspaceFilter(double *in, double *out, double q2, std::complex<double> *c)
+{
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double tpiba2 = tpiba * tpiba;
+    size_t pbasis = fine_pwaves->pbasis;
+
+    for(size_t ig=0;ig < pbasis;ig++) c[ig] = std::complex<double>(in[ig], 0.0);
+    fine_pwaves->FftForward(c, c);
+    for(size_t ig=0;ig < pbasis;ig++)
+    {
+        double g2 = fine_pwaves->gmags[ig] * tpiba2;
+        if( g2 < 1.0e-5) g2 =  tpiba2;
+        c[ig] *= (q2 < 0.0) ? g2 : 1.0 / (g2 + q2);
+    }
+    fine_pwaves->FftInverse(c, c);
+    double scale = 1.0 / (double)fine_pwaves->global_basis;
+    for(size_t i = 0;i < pbasis;i++) out[i] = std::real(c[i]) * scale;
+}
+
+// Thomas-Fermi preconditioner of Raczkowski, Canning and Wang, PRB 64, 121101 (2001).
+// Solves [-del^2 + k_TF^2(r)] x = -del^2 drho with the local screening wavevector
+// k_TF^2(r) = 4 k_F(r)/pi so that the residual is screened in metallic regions while
+// vacuum regions are mixed without damping, which is what slabs and interfaces need.
+// For a uniform density this reduces to Kerker with q0 = k_TF. The equation is solved
+// with conjugate gradients preconditioned by the Kerker operator of the average k_TF^2.
+static void Precond_drho_tf(double *drho, double *rho)
+{
+    RmgTimer RT("Mix rho: Thomas-Fermi");
+    size_t pbasis = fine_pwaves->pbasis;
+    int ncomp = ct.noncoll_factor * ct.noncoll_factor;
+
+    // Local k_TF^2 from the total valence density
+    std::vector<double> k2(pbasis);
+    for(size_t i = 0;i < pbasis;i++) k2[i] = rho[i];
+    if(ct.spin_flag && ct.noncoll_factor == 1)
+        MPI_Allreduce(MPI_IN_PLACE, k2.data(), (int)pbasis, MPI_DOUBLE, MPI_SUM, pct.spin_comm);
+
+    double k2avg = 0.0;
+    for(size_t i = 0;i < pbasis;i++)
+    {
+        double kf = std::cbrt(3.0 * PI * PI * std::max(k2[i], 0.0));
+        k2[i] = 4.0 * kf / PI;
+        k2avg += k2[i];
+    }
+    GlobalSums(&k2avg, 1, pct.grid_comm);
+    k2avg /= (double)fine_pwaves->global_basis;
+
+    // Nothing to screen
+    if(k2avg < 1.0e-10) return;
+
+    std::vector<std::complex<double>> c(pbasis);
+    std::vector<double> b(pbasis), r(pbasis), z(pbasis), p(pbasis), ap(pbasis);
+
+    for(int is = 0; is < ncomp; is++)
+    {
+        double *x = &drho[is*pbasis];
+
+        // Right hand side and the Kerker solution as starting guess
+        GspaceFilter(x, b.data(), -1.0, c.data());
+        GspaceFilter(b.data(), x, k2avg, c.data());
+
+        // r = b - A x
+        GspaceFilter(x, ap.data(), -1.0, c.data());
+        double sums[2] = {0.0, 0.0};
+        for(size_t i = 0;i < pbasis;i++)
+        {
+            r[i] = b[i] - ap[i] - k2[i] * x[i];
+            sums[0] += b[i] * b[i];
+        }
+        GspaceFilter(r.data(), z.data(), k2avg, c.data());
+        for(size_t i = 0;i < pbasis;i++) sums[1] += r[i] * z[i];
+        GlobalSums(sums, 2, pct.grid_comm);
+        double bnorm = std::sqrt(sums[0]);
+        double rz = sums[1];
+        if(bnorm == 0.0) continue;
+
+        p = z;
+        for(int it = 0;it < TF_PRECOND_MAXIT;it++)
+        {
+            GspaceFilter(p.data(), ap.data(), -1.0, c.data());
+            double pap = 0.0;
+            for(size_t i = 0;i < pbasis;i++)
+            {
+                ap[i] += k2[i] * p[i];
+                pap += p[i] * ap[i];
+            }
+            GlobalSums(&pap, 1, pct.grid_comm);
+            double alpha = rz / pap;
+
+            double rnorm = 0.0;
+            for(size_t i = 0;i < pbasis;i++)
+            {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * ap[i];
+                rnorm += r[i] * r[i];
+            }
+            GlobalSums(&rnorm, 1, pct.grid_comm);
+            if(std::sqrt(rnorm) < TF_PRECOND_TOL * bnorm) break;
+
+            GspaceFilter(r.data(), z.data(), k2avg, c.data());
+            double rz_new = 0.0;
+            for(size_t i = 0;i < pbasis;i++) rz_new += r[i] * z[i];
+            GlobalSums(&rz_new, 1, pct.grid_comm);
+            double beta = rz_new / rz;
+            rz = rz_new;
+            for(size_t i = 0;i < pbasis;i++) p[i] = z[i] + beta * p[i];
+        }
+    }
+}
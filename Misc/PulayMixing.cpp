@@ -9,6 +9,158 @@
 #include "transition.h"
 #include "RmgParallelFft.h"
 #include "RmgException.h"
+#include "ZfpCompress.h"
+
+// History vectors are processed in chunks of this many values. For ZFP storage
+// each chunk is compressed as a 3D block of dimensions (n/256, 16, 16).
+#define MIXING_HISTORY_CHUNK 65536
+// Bit planes kept by ZFP, comparable to or better than single precision
+#define MIXING_HISTORY_ZFP_PRECISION 32
+
+MixingHistory::MixingHistory(size_t Nsize, int nslots, int storage)
+{
+    this->Nsize = Nsize;
+    this->storage = storage;
+    // Slots are allocated when first stored
+    if(storage == MIXING_HISTORY_DOUBLE) this->dstore.resize(nslots);
+    if(storage == MIXING_HISTORY_FLOAT) this->fstore.resize(nslots);
+    if(storage == MIXING_HISTORY_ZFP)
+    {
+        size_t nchunks = (Nsize + MIXING_HISTORY_CHUNK - 1) / MIXING_HISTORY_CHUNK;
+        this->zstore.resize(nslots);
+        for(auto &z : this->zstore) z.resize(nchunks);
+        this->zbuf.resize(2*MIXING_HISTORY_CHUNK + 1024);
+    }
+    if(storage != MIXING_HISTORY_DOUBLE) this->chunk.resize(MIXING_HISTORY_CHUNK);
+}
+
+// Returns a pointer to the values of chunk ichunk of slot in double precision
+double *MixingHistory::get_chunk(int slot, size_t ichunk, size_t &len)
+{
+    size_t offset = ichunk * MIXING_HISTORY_CHUNK;
+    len = std::min((size_t)MIXING_HISTORY_CHUNK, this->Nsize - offset);
+
+    if(this->storage == MIXING_HISTORY_DOUBLE) return &this->dstore[slot][offset];
+
+    if(this->storage == MIXING_HISTORY_FLOAT)
+    {
+        float *f = &this->fstore[slot][offset];
+        for(size_t i = 0;i < len;i++) this->chunk[i] = (double)f[i];
+        return this->chunk.data();
+    }
+
+    // ZFP compressed values followed by any tail that is not a multiple of 256
+    std::vector<double> &z = this->zstore[slot][ichunk];
+    size_t nx = len / 256;
+    size_t ntail = len - nx * 256;
+    size_t zwords = z.size() - ntail;
+    if(nx)
+    {
+        std::copy(z.begin(), z.begin() + zwords, this->zbuf.begin());
+        ZfpCompress C;
+        C.decompress_buffer(this->chunk.data(), this->zbuf.data(), (int)nx, 16, 16,
+                            MIXING_HISTORY_ZFP_PRECISION, this->zbuf.size()*sizeof(double));
+    }
+    std::copy(z.begin() + zwords, z.end(), this->chunk.begin() + nx * 256);
+    return this->chunk.data();
+}
+
+void MixingHistory::put_chunk(int slot, size_t ichunk, double *x, size_t len)
+{
+    size_t offset = ichunk * MIXING_HISTORY_CHUNK;
+
+    if(this->storage == MIXING_HISTORY_DOUBLE)
+    {
+        std::copy(x, x + len, &this->dstore[slot][offset]);
+        return;
+    }
+
+    if(this->storage == MIXING_HISTORY_FLOAT)
+    {
+        float *f = &this->fstore[slot][offset];
+        for(size_t i = 0;i < len;i++) f[i] = (float)x[i];
+        return;
+    }
+
+    size_t nx = len / 256;
+    size_t ntail = len - nx * 256;
+    size_t zwords = 0;
+    if(nx)
+    {
+        ZfpCompress C;
+        size_t csize = C.compress_buffer(x, this->zbuf.data(), (int)nx, 16, 16,
+                                         MIXING_HISTORY_ZFP_PRECISION, this->zbuf.size()*sizeof(double));
+        zwords = (csize + sizeof(double) - 1) / sizeof(double);
+    }
+    std::vector<double> &z = this->zstore[slot][ichunk];
+    z.resize(zwords + ntail);
+    z.shrink_to_fit();
+    std::copy(this->zbuf.begin(), this->zbuf.begin() + zwords, z.begin());
+    std::copy(x + nx * 256, x + len, z.begin() + zwords);
+}
+
+void MixingHistory::store(int slot, double *x)
+{
+    if(this->storage == MIXING_HISTORY_DOUBLE && this->dstore[slot].size() == 0) this->dstore[slot].resize(this->Nsize);
+    if(this->storage == MIXING_HISTORY_FLOAT && this->fstore[slot].size() == 0) this->fstore[slot].resize(this->Nsize);
+
+    for(size_t offset = 0;offset < this->Nsize;offset += MIXING_HISTORY_CHUNK)
+    {
+        size_t len = std::min((size_t)MIXING_HISTORY_CHUNK, this->Nsize - offset);
+        this->put_chunk(slot, offset / MIXING_HISTORY_CHUNK, &x[offset], len);
+    }
+}
+
+void MixingHistory::visit(int slot, std::function<void(double *, size_t, size_t)> f)
+{
+    for(size_t offset = 0;offset < this->Nsize;offset += MIXING_HISTORY_CHUNK)
+    {
+        size_t len;
+        double *c = this->get_chunk(slot, offset / MIXING_HISTORY_CHUNK, len);
+        f(c, offset, len);
+    }
+}
+
+double MixingHistory::dot(int slot, double *y)
+{
+    int ione = 1;
+    if(this->storage == MIXING_HISTORY_DOUBLE)
+    {
+        int N = (int)this->Nsize;
+        return ddot(&N, this->dstore[slot].data(), &ione, y, &ione);
+    }
+
+    double sum = 0.0;
+    this->visit(slot, [&](double *c, size_t offset, size_t len) {
+        int n = (int)len;
+        sum += ddot(&n, c, &ione, &y[offset], &ione);
+    });
+    return sum;
+}
+
+void MixingHistory::axpy(int slot, double alpha, double *y)
+{
+    int ione = 1;
+    this->visit(slot, [&](double *c, size_t offset, size_t len) {
+        int n = (int)len;
+        daxpy(&n, &alpha, c, &ione, &y[offset], &ione);
+    });
+}
+
+void MixingHistory::update(int slot, double alpha, double *x)
+{
+    int ione = 1;
+    for(size_t offset = 0;offset < this->Nsize;offset += MIXING_HISTORY_CHUNK)
+    {
+        size_t len;
+        size_t ichunk = offset / MIXING_HISTORY_CHUNK;
+        double *c = this->get_chunk(slot, ichunk, len);
+        int n = (int)len;
+        daxpy(&n, &alpha, &x[offset], &ione, c, &ione);
+        if(this->storage != MIXING_HISTORY_DOUBLE) this->put_chunk(slot, ichunk, c, len);
+    }
+}
+
 
 PulayMixing::PulayMixing(size_t Nsize, int pulay_order, int refresh_steps, double mix_first, 
         double beta, MPI_Comm comm)
@@ -26,14 +178,14 @@ PulayMixing::PulayMixing(size_t Nsize, int pulay_order, int refresh_steps, doubl
     this->mix_first = mix_first;
     this->beta = beta;
     this->comm = comm;
-    this->hist = new double[Nsize * (size_t)(pulay_order) +1024];
-    this->res_hist = new double[Nsize * (size_t)(pulay_order) + 1024];
+    this->xhist = new MixingHistory(Nsize, pulay_order, MIXING_HISTORY_DOUBLE);
+    this->fhist = new MixingHistory(Nsize, pulay_order, MIXING_HISTORY_DOUBLE);
     this->A_mat = new double[(this->max_order+1)*(this->max_order+1)];
 
     for(int i = 0; i < this->pulay_order;i++)
     {
-        this->hist_ptr.push_back(&this->hist[Nsize * i]);
-        this->res_hist_ptr.push_back(&this->res_hist[Nsize * (size_t)i]);
+        this->hist_slot.push_back(i);
+        this->res_hist_slot.push_back(i);
     }
 
     this->step = 0;
@@ -43,15 +195,12 @@ PulayMixing::PulayMixing(size_t Nsize, int pulay_order, int refresh_steps, doubl
 
 PulayMixing::~PulayMixing(void)
 {
-    delete [] this->hist;
+    delete this->xhist;
+    delete this->fhist;
     if(this->Gspace)
     {
         delete [] this->res_histG;
     }
-    else
-    {
-        delete [] this->res_hist;
-    }
     if(c_fm != NULL) delete [] c_fm;
 }
 
@@ -63,6 +212,20 @@ void PulayMixing::SetPrecond(std::function<void(double*, int)> precond)
 
 void PulayMixing::Refresh(){ this->step = 0;}
 
+// Selects how the history vectors are stored. Reduced precision or compressed
+// storage lowers the memory needed for deep histories at the cost of a small
+// perturbation of the extrapolation coefficients. Must be called before the
+// first mixing step. Only the density history is affected for G-space mixing.
+void PulayMixing::SetHistoryStorage(int storage)
+{
+    if(this->step != 0)
+        throw RmgFatalException() << "Error! History storage must be set before mixing starts in " << __FILE__ << " at line " << __LINE__ << "\n";
+    delete this->xhist;
+    delete this->fhist;
+    this->xhist = new MixingHistory(this->Nsize, this->pulay_order, storage);
+    this->fhist = new MixingHistory(this->Nsize, this->pulay_order, storage);
+}
+
 void PulayMixing::Mixing(double *xm, double *fm)
 {
     if(this->Gspace) 
@@ -89,7 +252,7 @@ void PulayMixing::Mixing(double *xm, double *fm)
 
         if(this->drho_pre)
         {
-            Precond_drho(fm);
+            Precond_drho(fm, xm);
         }
         daxpy(&N, &this->mix_first, fm, &ione, xm, &ione);
 
@@ -98,8 +261,8 @@ void PulayMixing::Mixing(double *xm, double *fm)
 
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
-    dcopy(&N, fm, &ione, this->res_hist_ptr[current_pos], &ione);
+    this->xhist->store(this->hist_slot[current_pos], xm);
+    this->fhist->store(this->res_hist_slot[current_pos], fm);
     if (this->step == 0)
     {
         A_mat[this->step * lda + this->step] = ddot(&N, fm, &ione, fm, &ione);
@@ -107,7 +270,7 @@ void PulayMixing::Mixing(double *xm, double *fm)
 
         if(this->drho_pre)
         {
-            Precond_drho(fm);
+            Precond_drho(fm, xm);
         }
         daxpy(&N, &this->mix_first, fm, &ione, xm, &ione);
 
@@ -130,8 +293,7 @@ void PulayMixing::Mixing(double *xm, double *fm)
     int num_prev_steps = std::min(this->step, this->pulay_order-1);
     for(int i = 0; i < num_prev_steps; i++)
     {
-        double *fi = this->res_hist_ptr[i];
-        A_mat[i * lda + num_prev_steps] = ddot(&N, fi, &ione, fm, &ione);
+        A_mat[i * lda + num_prev_steps] = this->fhist->dot(this->res_hist_slot[i], fm);
 
         A_mat[num_prev_steps * lda + i] = 
             A_mat[i * lda + num_prev_steps] ;
@@ -172,18 +334,18 @@ void PulayMixing::Mixing(double *xm, double *fm)
     dscal(&N, &b[size-1], xm, &ione);
     for (int i = 0; i < size - 1; i++)
     {
-        daxpy(&N, &b[i], this->hist_ptr[i], &ione, xm, &ione);
+        this->xhist->axpy(this->hist_slot[i], b[i], xm);
     }
 
     dscal(&N, &b[size-1], fm, &ione);
     for (int i = 0; i < size - 1; i++)
     {
-        daxpy(&N, &b[i], this->res_hist_ptr[i], &ione, fm, &ione);
+        this->fhist->axpy(this->res_hist_slot[i], b[i], fm);
     }
 
     if(this->drho_pre)
     {
-        Precond_drho(fm);
+        Precond_drho(fm, xm);
     }
     daxpy(&N, &this->beta, fm, &ione, xm, &ione);
 
@@ -192,8 +354,8 @@ void PulayMixing::Mixing(double *xm, double *fm)
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
-        std::rotate(this->res_hist_ptr.begin(),this->res_hist_ptr.begin()+1,this->res_hist_ptr.end());
+        std::rotate(this->hist_slot.begin(),this->hist_slot.begin()+1,this->hist_slot.end());
+        std::rotate(this->res_hist_slot.begin(),this->res_hist_slot.begin()+1,this->res_hist_slot.end());
     }
 
     this->step++;
@@ -212,12 +374,22 @@ void PulayMixing::SetGspace(bool drho_pre_in, bool Gspace_in, double q0_in)
     if(Gspace_in) {
         this->drho_pre = true;
         this->Gspace = true;
-        delete [] this->res_hist;
-        this->res_histG = new std::complex<double>[Nsize * (size_t)(pulay_order) + 1024];
+        delete this->fhist;
+        this->fhist = NULL;
+
+        // Only coefficients inside the density cutoff sphere enter the Pulay
+        // extrapolation. The remaining high frequency part is mixed linearly.
+        for(size_t ig = 0;ig < fine_pwaves->pbasis;ig++)
+        {
+            if(fine_pwaves->gmask[ig]) this->gsphere.push_back(ig);
+        }
+        size_t nspin = Nsize / fine_pwaves->pbasis;
+        size_t ngs = nspin * this->gsphere.size();
+        this->res_histG = new std::complex<double>[ngs * (size_t)(pulay_order) + 1024];
 
         for(int i = 0; i < this->pulay_order;i++)
         {
-            this->res_histG_ptr.push_back(&this->res_histG[Nsize * (size_t)i]);
+            this->res_histG_ptr.push_back(&this->res_histG[ngs * (size_t)i]);
         }
         // seet q1 for scalar product
         double qmin = 2.0 * PI / Rmg_L.celldm[0];
@@ -272,7 +444,7 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     if(this->pulay_order <=1)
     {
 
-        Precond_drho(fm);
+        Precond_drho(fm, xm);
         daxpy(&N, &this->mix_first, fm, &ione, xm, &ione);
 
         return;
@@ -280,16 +452,32 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
 
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
+    this->xhist->store(this->hist_slot[current_pos], xm);
 
     int nspin = N/pbasis;
+    size_t ng = this->gsphere.size();
+    int ngs = (int)(nspin * ng);
     for(int ig=0; ig < N; ig++) c_fm[ig] = std::complex<double>(fm[ig], 0.0);
     for(int is = 0; is < nspin; is++)
     {
         fine_pwaves->FftForward(&c_fm[is*pbasis], &c_fm[is*pbasis] );
     }
 
-    zcopy(&N, c_fm, &ione, this->res_histG_ptr[current_pos], &ione);
+    // Keep the part of the residual inside the cutoff sphere
+    std::complex<double> *c_fs = this->res_histG_ptr[current_pos];
+    for(int is = 0; is < nspin; is++)
+    {
+        for(size_t k = 0; k < ng; k++) c_fs[is*ng + k] = c_fm[is*pbasis + this->gsphere[k]];
+    }
+
+    // Metric weights of the scalar product
+    std::vector<double> f_q(ng);
+    for(size_t k = 0; k < ng; k++)
+    {
+        double g2 = fine_pwaves->gmags[this->gsphere[k]] * tpiba2;
+        if( g2 < 1.0e-5) g2 =  tpiba2;
+        f_q[k] = (g2 + q1*q1)/g2;
+    }
 
     int num_prev_steps = std::min(this->step, this->pulay_order-1);
 
@@ -311,15 +499,8 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     {
         std::complex<double> *c_fi = this->res_histG_ptr[i];
         A_mat[i * lda + num_prev_steps] = 0.0;
-        for(int idx = 0; idx < N; idx++) {
-            int ig = idx%pbasis;
-            double g2 = fine_pwaves->gmags[ig] * tpiba2;
-            if( g2 < 1.0e-5) g2 =  tpiba2;
-
-            double f_q = (g2 + q1*q1)/g2;
-
-            A_mat[i * lda + num_prev_steps] += f_q * std::real(std::conj(c_fi[idx]) * c_fm[idx]);
-
+        for(int idx = 0; idx < ngs; idx++) {
+            A_mat[i * lda + num_prev_steps] += f_q[idx%ng] * std::real(std::conj(c_fi[idx]) * c_fs[idx]);
         }
 
         A_mat[num_prev_steps * lda + i] = 
@@ -330,14 +511,8 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
 
     A_mat[num_prev_steps * lda + num_prev_steps] = 0.0;
 
-    for(int idx = 0; idx < N; idx++) {
-        int ig = idx%pbasis;
-        double g2 = fine_pwaves->gmags[ig] * tpiba2;
-        if( g2 < 1.0e-5) g2 =  tpiba2;
-
-        double f_q = (g2 + q1*q1)/g2;
-
-        A_mat[num_prev_steps * lda + num_prev_steps] += f_q * std::real(std::conj(c_fm[idx]) * c_fm[idx]);
+    for(int idx = 0; idx < ngs; idx++) {
+        A_mat[num_prev_steps * lda + num_prev_steps] += f_q[idx%ng] * std::real(std::conj(c_fs[idx]) * c_fs[idx]);
     }
 
     int s2 = (this->max_order+1)*(this->max_order+1);
@@ -372,23 +547,33 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     dscal(&N, &b[size-1], xm, &ione);
     for (int i = 0; i < size - 1; i++)
     {
-        daxpy(&N, &b[i], this->hist_ptr[i], &ione, xm, &ione);
+        this->xhist->axpy(this->hist_slot[i], b[i], xm);
     }
 
+    // Optimal residual inside the sphere. Outside it the current residual is used
+    // unchanged since the coefficients sum to one.
+    std::vector<std::complex<double>> c_opt(ngs);
     std::complex<double> b_c = b[size-1];
-    zscal(&N, &b_c, c_fm, &ione);
+    for(int idx = 0; idx < ngs; idx++) c_opt[idx] = b_c * c_fs[idx];
     for (int i = 0; i < size - 1; i++)
     {
         b_c = b[i];
-        zaxpy(&N, &b_c, this->res_histG_ptr[i], &ione, c_fm, &ione);
+        zaxpy(&ngs, &b_c, this->res_histG_ptr[i], &ione, c_opt.data(), &ione);
+    }
+    for(int is = 0; is < nspin; is++)
+    {
+        for(size_t k = 0; k < ng; k++) c_fm[is*pbasis + this->gsphere[k]] = c_opt[is*ng + k];
     }
 
-    for(int idx = 0; idx < N; idx++) {
-        int ig = idx%pbasis;
-        double g2 = fine_pwaves->gmags[ig] * tpiba2;
-        if( g2 < 1.0e-5) g2 =  tpiba2;
-        double alpha = g2/(g2+ q0 * q0);
-        c_fm[idx] = c_fm[idx] * alpha;
+    if(ct.drho_precond_type == DRHO_PRECOND_KERKER)
+    {
+        for(int idx = 0; idx < N; idx++) {
+            int ig = idx%pbasis;
+            double g2 = fine_pwaves->gmags[ig] * tpiba2;
+            if( g2 < 1.0e-5) g2 =  tpiba2;
+            double alpha = g2/(g2+ q0 * q0);
+            c_fm[idx] = c_fm[idx] * alpha;
+        }
     }
 
     for(int is = 0; is < nspin; is++)
@@ -398,6 +583,9 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
 
     for(int i = 0; i < N; i++) fm[i] = std::real(c_fm[i])/(double)fine_pwaves->global_basis;
 
+    // The Thomas-Fermi preconditioner needs the extrapolated input density
+    if(ct.drho_precond_type == DRHO_PRECOND_TF) Precond_drho(fm, xm);
+
     daxpy(&N, &this->beta, fm, &ione, xm, &ione);
 
     // if the this->step larger than pulay_order, rotate the hist_ptr so that 
@@ -405,7 +593,7 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
+        std::rotate(this->hist_slot.begin(),this->hist_slot.begin()+1,this->hist_slot.end());
         std::rotate(this->res_histG_ptr.begin(),this->res_histG_ptr.begin()+1,this->res_histG_ptr.end());
     }
 
@@ -448,8 +636,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
     int iter_used = current_pos;
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
-    dcopy(&N, fm, &ione, this->res_hist_ptr[current_pos], &ione);
+    this->xhist->store(this->hist_slot[current_pos], xm);
+    this->fhist->store(this->res_hist_slot[current_pos], fm);
     for(int idx = 0; idx < this->pbasis; idx++)
     {
         this->dvh_hist_ptr[current_pos][idx] = vh_out[idx] - vh_in[idx];
@@ -461,11 +649,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
         return;
     }
 
-    for(size_t idx = 0; idx < this->Nsize; idx++)
-    {
-        this->hist_ptr[current_pos -1][idx] -= this->hist_ptr[current_pos][idx];
-        this->res_hist_ptr[current_pos -1][idx] -= this->res_hist_ptr[current_pos][idx];
-    }
+    this->xhist->update(this->hist_slot[current_pos -1], -1.0, xm);
+    this->fhist->update(this->res_hist_slot[current_pos -1], -1.0, fm);
 
     for(int idx = 0; idx < this->pbasis; idx++)
     {
@@ -474,13 +659,21 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
 
 
     for(int i = 0;i < iter_used;i++) {
-        for(int j = 0;j < iter_used;j++) {
-            betamix[j][i] = 0.0;
-            for(int is = 0; is < this->nstates; is++)
-            {
-                for(int k = 0;k < pbasis;k++) betamix[j][i] += this->res_hist_ptr[i][k + is * pbasis] * dvh_hist_ptr[j][k];
+        for(int j = 0;j < iter_used;j++) betamix[j][i] = 0.0;
+        this->fhist->visit(this->res_hist_slot[i], [&](double *fi, size_t offset, size_t len) {
+            for(int j = 0;j < iter_used;j++) {
+                double *dvh = dvh_hist_ptr[j];
+                // dvh has pbasis entries and wraps around for each spin component of fi
+                for(size_t k = 0;k < len;) {
+                    size_t p = (offset + k) % this->pbasis;
+                    size_t seg = std::min(len - k, (size_t)this->pbasis - p);
+                    double sum = 0.0;
+                    for(size_t m = 0;m < seg;m++) sum += fi[k + m] * dvh[p + m];
+                    betamix[j][i] += sum;
+                    k += seg;
+                }
             }
-        }
+        });
     }
 
     MPI_Allreduce(MPI_IN_PLACE, betamix, this->max_order*this->max_order, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
@@ -532,8 +725,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
         if(ct.verbose && pct.gridpe == 0) 
             std::cout<< "\nITER " << i << " gamma = "  << gamma << std::endl;
 
-        for(size_t k=0;k < this->Nsize;k++) fm[k] -= gamma * res_hist_ptr[i][k];
-        for(size_t k=0;k < this->Nsize;k++) xm[k] -= gamma * hist_ptr[i][k];
+        this->fhist->axpy(this->res_hist_slot[i], -gamma, fm);
+        this->xhist->axpy(this->hist_slot[i], -gamma, xm);
 
     }
 
@@ -543,8 +736,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
-        std::rotate(this->res_hist_ptr.begin(),this->res_hist_ptr.begin()+1,this->res_hist_ptr.end());
+        std::rotate(this->hist_slot.begin(),this->hist_slot.begin()+1,this->hist_slot.end());
+        std::rotate(this->res_hist_slot.begin(),this->res_hist_slot.begin()+1,this->res_hist_slot.end());
         std::rotate(this->dvh_hist_ptr.begin(),this->dvh_hist_ptr.begin()+1,this->dvh_hist_ptr.end());
     }
 
@@ -21,6 +21,8 @@
  */
 
 #include <cstdint>
+#include <algorithm>
+#include <climits>
 #include "const.h"
 #include "rmgtypedefs.h"
 #include "typedefs.h"
@@ -510,60 +512,266 @@ Symmetry::Symmetry ( Lattice &L_in, int NX, int NY, int NZ, int density) : L(L_i
     delete [] ityp;
 }
 
-void Symmetry::init_symm_ijk()
+// Global coordinates of the images of the points (ix, iy, 0...pz_grid-1) under
+// symmetry operation isy. Along z the image advances by a fixed column of the
+// rotation so only the first point of the row needs the full transformation.
+void Symmetry::image_row_coords(int isy, int ix, int iy, int *gx, int *gy, int *gz)
 {
-    int incx = py_grid * pz_grid;
-    int incy = pz_grid;
+    int *sr = &sym_rotate[isy*9];
+    int ix1 = ix + xoff;
+    int iy1 = iy + yoff;
+    int iz1 = zoff;
+    int ixx, iyy, izz;
+    symm_ijk(sr, &ftau[isy*3], ix1, iy1, iz1, ixx, iyy, izz, nx_grid, ny_grid, nz_grid);
+
+    int dx = sr[2], dy = sr[5], dz = sr[8];
+    for(int iz = 0;iz < pz_grid;iz++)
+    {
+        gx[iz] = ixx;
+        gy[iz] = iyy;
+        gz[iz] = izz;
+        ixx += dx;
+        iyy += dy;
+        izz += dz;
+        while(ixx < 0) ixx += nx_grid;
+        while(ixx >= nx_grid) ixx -= nx_grid;
+        while(iyy < 0) iyy += ny_grid;
+        while(iyy >= ny_grid) iyy -= ny_grid;
+        while(izz < 0) izz += nz_grid;
+        while(izz >= nz_grid) izz -= nz_grid;
+    }
+}
 
-    int incx1 = ny_grid * nz_grid;
-    int incy1 = nz_grid;
-    int incz1 = 1;
+// Returns the positions in the exchange buffer of the images of the row (ix, iy, *)
+// under symmetry operation isy. Work must hold 4*pz_grid entries.
+const uint32_t *Symmetry::image_row(int isy, int ix, int iy, uint32_t *work)
+{
+    if(sym_idx.size()) return &sym_idx[isy * pbasis + ix * py_grid * pz_grid + iy * pz_grid];
 
-    int ixx, iyy, izz;
+    int *gx = (int *)&work[pz_grid];
+    int *gy = gx + pz_grid;
+    int *gz = gy + pz_grid;
+    image_row_coords(isy, ix, iy, gx, gy, gz);
+    for(int iz = 0;iz < pz_grid;iz++)
+    {
+        int pe = (xpe[gx[iz]] * pe_y + ype[gy[iz]]) * pe_z + zpe[gz[iz]];
+        int *lo = &box_lo[3*pe], *dim = &box_dim[3*pe];
+        work[iz] = box_offset[pe] +
+                   ((xloc[gx[iz]] - lo[0]) * dim[1] + (yloc[gy[iz]] - lo[1])) * dim[2] + (zloc[gz[iz]] - lo[2]);
+    }
+    return work;
+}
+
+void Symmetry::init_symm_ijk(BaseGrid &G)
+{
+    int npes = G.get_NPES();
+    int pe_x = G.get_PE_X();
+    pe_y = G.get_PE_Y();
+    pe_z = G.get_PE_Z();
+
+    // Tables mapping a global grid coordinate to the processor coordinate that owns
+    // it and to the local coordinate on that processor.
+    xpe.resize(nx_grid); ype.resize(ny_grid); zpe.resize(nz_grid);
+    xloc.resize(nx_grid); yloc.resize(ny_grid); zloc.resize(nz_grid);
+    int offx, offy, offz, sizex, sizey, sizez;
+    for(int i = 0;i < pe_x;i++)
+    {
+        int pe = G.xyz2pe(i, 0, 0);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &offx, &offy, &offz);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sizex, &sizey, &sizez);
+        for(int ix = offx;ix < offx + sizex;ix++) { xpe[ix] = i; xloc[ix] = ix - offx; }
+    }
+    for(int j = 0;j < pe_y;j++)
+    {
+        int pe = G.xyz2pe(0, j, 0);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &offx, &offy, &offz);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sizex, &sizey, &sizez);
+        for(int iy = offy;iy < offy + sizey;iy++) { ype[iy] = j; yloc[iy] = iy - offy; }
+    }
+    for(int k = 0;k < pe_z;k++)
+    {
+        int pe = G.xyz2pe(0, 0, k);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &offx, &offy, &offz);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sizex, &sizey, &sizez);
+        for(int iz = offz;iz < offz + sizez;iz++) { zpe[iz] = k; zloc[iz] = iz - offz; }
+    }
+
+    // Bounding box on each owning processor of all image points we reference.
+    // Boxes are exact for operations that map grid boxes onto boxes and
+    // otherwise never exceed the owners subdomain.
+    std::vector<int> box_hi(3*npes, -1);
+    box_lo.assign(3*npes, INT_MAX);
+    std::vector<int> gx(pz_grid), gy(pz_grid), gz(pz_grid);
     for(int isy = 0; isy < nsym; isy++)
     {
         for (int ix = 0; ix < px_grid; ix++) {
             for (int iy = 0; iy < py_grid; iy++) {
+                image_row_coords(isy, ix, iy, gx.data(), gy.data(), gz.data());
                 for (int iz = 0; iz < pz_grid; iz++) {
-                    int ix1 = ix + xoff;
-                    int iy1 = iy + yoff;
-                    int iz1 = iz + zoff;
+                    int pe = (xpe[gx[iz]] * pe_y + ype[gy[iz]]) * pe_z + zpe[gz[iz]];
+                    box_lo[3*pe] = std::min(box_lo[3*pe], xloc[gx[iz]]);
+                    box_lo[3*pe+1] = std::min(box_lo[3*pe+1], yloc[gy[iz]]);
+                    box_lo[3*pe+2] = std::min(box_lo[3*pe+2], zloc[gz[iz]]);
+                    box_hi[3*pe] = std::max(box_hi[3*pe], xloc[gx[iz]]);
+                    box_hi[3*pe+1] = std::max(box_hi[3*pe+1], yloc[gy[iz]]);
+                    box_hi[3*pe+2] = std::max(box_hi[3*pe+2], zloc[gz[iz]]);
+                }
+            }
+        }
+    }
 
-                    symm_ijk(&sym_rotate[isy *9], &ftau[isy*3], ix1, iy1, iz1, ixx, iyy, izz, nx_grid, ny_grid, nz_grid);
-                    int idx = izz *incz1 + iyy *incy1 + ixx *incx1;
-                    sym_idx[isy * pbasis + ix * incx + iy * incy + iz] = idx;
+    recv_peers.clear();
+    recv_counts.clear();
+    recv_offsets.clear();
+    box_dim.assign(3*npes, 0);
+    box_offset.assign(npes, -1);
+    std::vector<int> all_recv_counts(npes, 0);
+    std::vector<std::vector<int>> requests(npes);
+    nimages = 0;
+    for(int ipe = 0;ipe < npes;ipe++)
+    {
+        if(box_hi[3*ipe] < 0) continue;
+        for(int i = 0;i < 3;i++) box_dim[3*ipe+i] = box_hi[3*ipe+i] - box_lo[3*ipe+i] + 1;
+        int count = box_dim[3*ipe] * box_dim[3*ipe+1] * box_dim[3*ipe+2];
+        recv_peers.push_back(ipe);
+        recv_counts.push_back(count);
+        recv_offsets.push_back(nimages);
+        all_recv_counts[ipe] = count;
+        box_offset[ipe] = nimages;
+        nimages += count;
+
+        // Local indices on the owner of the points in the box
+        G.find_node_sizes(ipe, nx_grid, ny_grid, nz_grid, &sizex, &sizey, &sizez);
+        int *lo = &box_lo[3*ipe], *dim = &box_dim[3*ipe];
+        requests[ipe].reserve(count);
+        for(int i = 0;i < dim[0];i++)
+            for(int j = 0;j < dim[1];j++)
+                for(int k = 0;k < dim[2];k++)
+                    requests[ipe].push_back(((lo[0] + i) * sizey + lo[1] + j) * sizez + lo[2] + k);
+    }
+
+    // Optionally cache the buffer positions for every operation and point
+    sym_idx.clear();
+    if(!ct.compact_symmetry_indices)
+    {
+        std::vector<uint32_t> table(nsym * pbasis);
+        std::vector<uint32_t> work(4*pz_grid);
+        for(int isy = 0; isy < nsym; isy++)
+        {
+            for (int ix = 0; ix < px_grid; ix++) {
+                for (int iy = 0; iy < py_grid; iy++) {
+                    const uint32_t *row = image_row(isy, ix, iy, work.data());
+                    std::copy(row, row + pz_grid, &table[isy * pbasis + ix * py_grid * pz_grid + iy * pz_grid]);
                 }
             }
         }
+        sym_idx.swap(table);
+    }
+    sym_idx.shrink_to_fit();
+
+    // Tell every owner which of its points we need
+    std::vector<int> all_send_counts(npes, 0);
+    MPI_Alltoall(all_recv_counts.data(), 1, MPI_INT, all_send_counts.data(), 1, MPI_INT, pct.grid_comm);
+
+    send_peers.clear();
+    send_counts.clear();
+    send_offsets.clear();
+    int nsend = 0;
+    for(int ipe = 0;ipe < npes;ipe++)
+    {
+        if(all_send_counts[ipe] == 0) continue;
+        send_peers.push_back(ipe);
+        send_counts.push_back(all_send_counts[ipe]);
+        send_offsets.push_back(nsend);
+        nsend += all_send_counts[ipe];
+    }
+    send_idx.resize(nsend);
+
+    std::vector<MPI_Request> reqs;
+    for(size_t i = 0;i < send_peers.size();i++)
+    {
+        if(send_peers[i] == pct.gridpe) continue;
+        reqs.emplace_back();
+        MPI_Irecv(&send_idx[send_offsets[i]], send_counts[i], MPI_INT, send_peers[i], 200, pct.grid_comm, &reqs.back());
+    }
+    for(size_t i = 0;i < recv_peers.size();i++)
+    {
+        int ipe = recv_peers[i];
+        if(ipe == pct.gridpe)
+        {
+            auto it = std::find(send_peers.begin(), send_peers.end(), ipe);
+            int ioff = send_offsets[it - send_peers.begin()];
+            std::copy(requests[ipe].begin(), requests[ipe].end(), send_idx.begin() + ioff);
+            continue;
+        }
+        reqs.emplace_back();
+        MPI_Isend(requests[ipe].data(), recv_counts[i], MPI_INT, ipe, 200, pct.grid_comm, &reqs.back());
     }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
 }
-void Symmetry::symmetrize_grid_vector(double *object)
-{
-    int incx = py_grid * pz_grid;
-    int incy = pz_grid;
 
-    int incx1 = ny_grid * nz_grid;
-    int incy1 = nz_grid;
-    int incz1 = 1;
+// Fills images with the ncomp components of object at every point referenced
+// through image_row. Only the points in the exchange plan are communicated so
+// traffic and storage scale with the local subdomain rather than the global grid.
+void Symmetry::exchange_images(double *object, int ncomp, double *images)
+{
+    size_t nsend = send_idx.size();
+    std::vector<double> sendbuf(ncomp * nsend);
+    std::vector<double> recvbuf(ncomp * nimages);
 
-    // Allocate a global array object and put this processors object into the correct location
-    double *da = new double[nbasis*3]();
+    for(size_t i = 0;i < send_peers.size();i++)
+    {
+        double *sbuf = &sendbuf[ncomp * send_offsets[i]];
+        int *sidx = &send_idx[send_offsets[i]];
+        for(int ic = 0;ic < ncomp;ic++)
+            for(int k = 0;k < send_counts[i];k++)
+                sbuf[ic * send_counts[i] + k] = object[ic * pbasis + sidx[k]];
+    }
 
-    for(int is = 0; is < 3; is++)
+    std::vector<MPI_Request> reqs;
+    for(size_t i = 0;i < recv_peers.size();i++)
     {
-        for (int ix = 0; ix < px_grid; ix++) {
-            for (int iy = 0; iy < py_grid; iy++) {
-                for (int iz = 0; iz < pz_grid; iz++) {
-                    da[is * nbasis + (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
-                        = object[is * pbasis + ix * incx + iy*incy + iz];
-                }
-            }
+        if(recv_peers[i] == pct.gridpe) continue;
+        reqs.emplace_back();
+        MPI_Irecv(&recvbuf[ncomp * recv_offsets[i]], ncomp * recv_counts[i], MPI_DOUBLE,
+                  recv_peers[i], 201, pct.grid_comm, &reqs.back());
+    }
+    for(size_t i = 0;i < send_peers.size();i++)
+    {
+        if(send_peers[i] == pct.gridpe)
+        {
+            auto it = std::find(recv_peers.begin(), recv_peers.end(), pct.gridpe);
+            int ioff = recv_offsets[it - recv_peers.begin()];
+            std::copy(&sendbuf[ncomp * send_offsets[i]], &sendbuf[ncomp * send_offsets[i]] + ncomp * send_counts[i],
+                      &recvbuf[ncomp * ioff]);
+            continue;
         }
+        reqs.emplace_back();
+        MPI_Isend(&sendbuf[ncomp * send_offsets[i]], ncomp * send_counts[i], MPI_DOUBLE,
+                  send_peers[i], 201, pct.grid_comm, &reqs.back());
+    }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+    // Unpack into component major order so that images[ic*nimages + image_row(...)[iz]] is
+    // component ic of the image point.
+    for(size_t i = 0;i < recv_peers.size();i++)
+    {
+        double *rbuf = &recvbuf[ncomp * recv_offsets[i]];
+        for(int ic = 0;ic < ncomp;ic++)
+            for(int k = 0;k < recv_counts[i];k++)
+                images[ic * nimages + recv_offsets[i] + k] = rbuf[ic * recv_counts[i] + k];
     }
+}
+
+void Symmetry::symmetrize_grid_vector(double *object)
+{
+    int incx = py_grid * pz_grid;
+    int incy = pz_grid;
 
-    /* Call global sums to give everyone the full array */
-    size_t length = (size_t)nbasis * 3;
-    BlockAllreduce(da, length, pct.grid_comm);
+    // Collect the image points of this processors grid points
+    double *da = new double[nimages*3];
+    std::vector<uint32_t> work(4*pz_grid);
+    exchange_images(object, 3, da);
 
     for(int ix=0;ix < 3 * pbasis;ix++) object[ix] = 0.0;
 
@@ -572,13 +780,14 @@ void Symmetry::symmetrize_grid_vector(double *object)
     {
         for (int ix = 0; ix < px_grid; ix++) {
             for (int iy = 0; iy < py_grid; iy++) {
+                const uint32_t *row = image_row(isy, ix, iy, work.data());
                 for (int iz = 0; iz < pz_grid; iz++) {
 
-                    int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                    int idx = row[iz];
 
-                    vec[0] = da[idx + 0 * nbasis];
-                    vec[1] = da[idx + 1 * nbasis];
-                    vec[2] = da[idx + 2 * nbasis];
+                    vec[0] = da[idx + 0 * nimages];
+                    vec[1] = da[idx + 1 * nimages];
+                    vec[2] = da[idx + 2 * nimages];
                     symm_vec(isy, vec);
                     if(time_rev[isy]) 
                     {
@@ -630,24 +839,10 @@ void Symmetry::symmetrize_grid_object(double *object)
     int incx = py_grid * pz_grid;
     int incy = pz_grid;
 
-    int incx1 = ny_grid * nz_grid;
-    int incy1 = nz_grid;
-    int incz1 = 1;
-
-    // Allocate a global array object and put this processors object into the correct location
-    double *da = new double[nbasis]();
-
-    for (int ix = 0; ix < px_grid; ix++) {
-        for (int iy = 0; iy < py_grid; iy++) {
-            for (int iz = 0; iz < pz_grid; iz++) {
-                da[(iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] = object[ix * incx + iy*incy + iz];
-            }
-        }
-    }
-
-    /* Call global sums to give everyone the full array */
-    int length = nbasis;
-    GlobalSums ((double *)da, length, pct.grid_comm);
+    // Collect the image points of this processors grid points
+    double *da = new double[nimages];
+    std::vector<uint32_t> work(4*pz_grid);
+    exchange_images(object, 1, da);
 
     for(int ix=0;ix < pbasis;ix++) object[ix] = 0.0;
 
@@ -658,9 +853,10 @@ void Symmetry::symmetrize_grid_object(double *object)
         nsym_rho++;
         for (int ix = 0; ix < px_grid; ix++) {
             for (int iy = 0; iy < py_grid; iy++) {
+                const uint32_t *row = image_row(isy, ix, iy, work.data());
                 for (int iz = 0; iz < pz_grid; iz++) {
 
-                    int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                    int idx = row[iz];
 
                     object[ix * incx + iy*incy + iz] += da[idx];
                 }
@@ -1320,9 +1516,7 @@ void Symmetry::setgrid(BaseGrid &G, int density)
 
     pbasis = px_grid * py_grid * pz_grid;
     nbasis = nx_grid * ny_grid * nz_grid;
-    // sym index arrays dimensioned to size of smallest possible integer type
-    sym_idx.resize(nsym * pbasis);
-    init_symm_ijk();
+    init_symm_ijk(G);
 
     ct.nsym = nsym;
 }
@@ -1336,25 +1530,10 @@ void Symmetry::symmetrize_rho_AFM(double *rho,double *rho_oppo)
     int incx = py_grid * pz_grid;
     int incy = pz_grid;
 
-    int incx1 = ny_grid * nz_grid;
-    int incy1 = nz_grid;
-    int incz1 = 1;
-
-    // Allocate a global array object and put this processors object into the correct location
-    double *da1 = new double[nbasis]();
-
-    for (int ix = 0; ix < px_grid; ix++) {
-        for (int iy = 0; iy < py_grid; iy++) {
-            for (int iz = 0; iz < pz_grid; iz++) {
-                da1[ (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
-                    = rho[ ix * incx + iy*incy + iz];
-            }
-        }
-    }
-
-    /* Call global sums to give everyone the full array */
-    size_t length = (size_t)nbasis;
-    BlockAllreduce(da1, length, pct.grid_comm);
+    // Collect the image points of this processors grid points
+    double *da1 = new double[nimages];
+    std::vector<uint32_t> work(4*pz_grid);
+    exchange_images(rho, 1, da1);
 
     for(int idx = 0; idx < px_grid * py_grid * pz_grid; idx++) rho_oppo[idx] = 0.0;
     for(int isy = 0; isy < nsym; isy++)
@@ -1363,9 +1542,10 @@ void Symmetry::symmetrize_rho_AFM(double *rho,double *rho_oppo)
         {
             for (int ix = 0; ix < px_grid; ix++) {
                 for (int iy = 0; iy < py_grid; iy++) {
+                    const uint32_t *row = image_row(isy, ix, iy, work.data());
                     for (int iz = 0; iz < pz_grid; iz++) {
 
-                        int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                        int idx = row[iz];
                         rho_oppo[ix * incx + iy*incy + iz] += da1[idx];
                     }
                 }
@@ -23,6 +23,7 @@
 #include "blas.h"
 #include "RmgParallelFft.h"
 #include "BaseGrid.h"
+#include "DensityTiles.h"
 
 extern std::vector<ORBITAL_PAIR> OrbitalPairs;
 
@@ -50,9 +51,15 @@ void GetNewRho_on(STATE * states, double *rho, double *rho_matrix)
         rho_global[idx] = 0.;
 
     RmgTimer *RT1 = new RmgTimer("3-get_new_rho: states in this proc");
+    // Orbital pairs scatter into arbitrary regions of the global grid so each
+    // thread keeps a private copy. These are combined with a tile parallel
+    // reduction rather than one thread at a time.
+    std::vector<double *> private_rho;
 #pragma omp parallel private(pair)
     {
         double *rho_global_private = new double[global_basis]();
+#pragma omp critical
+        private_rho.push_back(rho_global_private);
 #pragma omp barrier
 #pragma omp for schedule(dynamic) nowait
         for(pair = 0; pair < (int)OrbitalPairs.size(); pair++)
@@ -73,11 +80,9 @@ void GetNewRho_on(STATE * states, double *rho, double *rho_matrix)
                         rho_global_private, 0, states, onepair);
 
         }
-#pragma omp critical
-        for(int idx = 0;idx < global_basis;idx++)rho_global[idx] += rho_global_private[idx];
-
-        delete [] rho_global_private;
     }
+    ReduceThreadBuffers(private_rho, rho_global, global_basis);
+    for(auto buf : private_rho) delete [] buf;
 
     delete(RT1);
 
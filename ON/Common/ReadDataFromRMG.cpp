@@ -196,6 +196,16 @@ void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     if(wsize != sizeof(csize))
         rmg_error_handler (__FILE__,__LINE__,"error reading");
 
+    // Orbital buffers store the tolerance used to compress them
+    double tol = RESTART_TOLERANCE;
+    if(csize & RESTART_TOLERANCE_FLAG)
+    {
+        csize &= ~RESTART_TOLERANCE_FLAG;
+        wsize = read (fh, &tol, sizeof(tol));
+        if(wsize != sizeof(tol))
+            rmg_error_handler (__FILE__,__LINE__,"error reading");
+    }
+
     if(csize > sizeof(double)*nx*ny*nz)
         rmg_error_handler (__FILE__,__LINE__,"error reading input buffer too small");
 
@@ -203,7 +213,7 @@ void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     if(wsize != csize)
         rmg_error_handler (__FILE__,__LINE__,"error reading");
 
-    csize = C.decompress_buffer(array, in, nx, ny, nz, RESTART_TOLERANCE, 2*nx*ny*nz*sizeof(double));
+    csize = C.decompress_buffer(array, in, nx, ny, nz, tol, 2*nx*ny*nz*sizeof(double));
     delete [] in;
 
 }
@@ -72,11 +72,13 @@ vxc_old, double * rho, double * rho_oppo, double * rhoc, double * rhocore)
         int nfp0 = Rmg_G->get_P0_BASIS(Rmg_G->default_FG_RATIO);
         Pulay_rho = new PulayMixing(nfp0, ct.charge_pulay_order, ct.charge_pulay_refresh, 
                 ct.mix, ct.mix, pct.grid_comm); 
+        Pulay_rho->SetHistoryStorage(ct.mixing_history_storage);
         Pulay_rho->SetGspace(ct.drho_precond, ct.charge_pulay_Gspace, ct.drho_q0);
 
         int tot_size = LocalOrbital->num_thispe * pbasis;
         Pulay_orbital = new PulayMixing(tot_size, ct.orbital_pulay_order, ct.orbital_pulay_refresh, 
                 ct.orbital_pulay_mixfirst, ct.orbital_pulay_scale, pct.grid_comm); 
+        Pulay_orbital->SetHistoryStorage(ct.mixing_history_storage);
         Pulay_orbital->SetPrecond(Preconditioner);
         Pulay_orbital->SetNstates(LocalOrbital->num_thispe);
         Pulay_orbital->SetBroyden(pbasis);
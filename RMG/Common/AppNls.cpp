@@ -89,8 +89,10 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
         if(need_ns) for(size_t idx = 0;idx < stop;idx++) ns[idx] = psi[idx];
         if(ct.xc_is_hybrid && Functional::is_exx_active())
         {
-            for(size_t i = 0; i < stop; i++) nv[i] = ct.exx_fraction * kpoint->vexx[(size_t)first_state*(size_t)P0_BASIS + i];
-            //AppExx(kpoint, psi, num_states, kpoint->vexx, &nv[(size_t)first_state*(size_t)P0_BASIS]);
+            if(ct.exx_ace)
+                AppExx(kpoint, psi, num_states, kpoint->vexx, nv);
+            else
+                for(size_t i = 0; i < stop; i++) nv[i] = ct.exx_fraction * kpoint->vexx[(size_t)first_state*(size_t)P0_BASIS + i];
         }
         else
         {
@@ -108,7 +110,11 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
     size_t alloc1 = (size_t)ct.max_nl * (size_t)M_cols * ct.noncoll_factor;
 
     KpointType *sint_compack = (KpointType *)RmgMallocHost(sizeof(KpointType) * alloc);
-    KpointType *nwork = (KpointType *)RmgMallocHost(sizeof(KpointType) * alloc);
+    // For ultrasoft potentials nwork holds the Dnm and qqq products side by side so that
+    // nv and ns can be generated with a single pass over the projector weights.
+    size_t nwork_alloc = alloc;
+    if(!ct.norm_conserving_pp) nwork_alloc = 2 * alloc;
+    KpointType *nwork = (KpointType *)RmgMallocHost(sizeof(KpointType) * nwork_alloc);
     KpointType *nwork_ion = (KpointType *)RmgMallocHost(sizeof(KpointType) * alloc);
     KpointType *M_dnm = (KpointType *)RmgMallocHost(sizeof(KpointType) * alloc1);
     KpointType *M_qqq = (KpointType *)RmgMallocHost(sizeof(KpointType) * alloc1);
@@ -259,20 +265,20 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
 
 
     delete RT1;
-    RT1 = new RmgTimer("AppNls: nv");
     int tot_states = num_states * ct.noncoll_factor;
 
     //nwork: num_tot_proj * (ct.noncoll_factor * num_states)
-
-    RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj,
-            ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
-            ZERO_t,  nv, P0_BASIS);
-
-    delete RT1;
-    if(! (ct.norm_conserving_pp && ct.is_gamma) ) 
-        memcpy(ns, psi, stop*sizeof(KpointType));
-    if(!ct.norm_conserving_pp) {
-
+    if(ct.norm_conserving_pp)
+    {
+        RT1 = new RmgTimer("AppNls: nv");
+        RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj,
+                ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
+                ZERO_t,  nv, P0_BASIS);
+        delete RT1;
+        if(!ct.is_gamma) memcpy(ns, psi, stop*sizeof(KpointType));
+    }
+    else
+    {
         RT1 = new RmgTimer("AppNls: ns_work");
         int dim_a = ct.max_nl * ct.noncoll_factor;
         int strideA = dim_a * dim_a;
@@ -284,38 +290,43 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
                 nwork_ion, dim_a, strideC, num_nonloc_ions); 
 
         //      nvwork_ion: (ct.max_nl, noncoll, num_states, ion)
-        // rotate it to nwork (ct.max_nl, ion, noncoll, num_states)`
-
+        // rotate it to the second half of nwork (ct.max_nl, ion, noncoll, num_states)`
+        KpointType *nwork_s = nwork + alloc;
         for(int st = 0; st < num_states * ct.noncoll_factor; st++)
         {
             for(int ion = 0; ion < num_nonloc_ions; ion++) 
             {
                 for(int ih = 0; ih < ct.max_nl; ih++)
                 {
-                    nwork[st*num_nonloc_ions * ct.max_nl + ion * ct.max_nl + ih]=
+                    nwork_s[st*num_nonloc_ions * ct.max_nl + ion * ct.max_nl + ih]=
                         nwork_ion[ion * strideC + st * ct.max_nl + ih];
 
                 }
             }
 
         }
-
-
         delete RT1;
-        RT1 = new RmgTimer("AppNls: ns");
-        RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj, 
+
+        // Both halves of nwork go through one gemm so the weights are only streamed once.
+        RT1 = new RmgTimer("AppNls: nv and ns");
+        KpointType *nvns = kpoint->nvns;
+        RmgGemm (transa, transa, P0_BASIS, 2*tot_states, num_tot_proj,
                 ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
-                ONE_t,  ns, P0_BASIS);
-        delete RT1;
+                ZERO_t,  nvns, P0_BASIS);
 
+        memcpy(nv, nvns, stop*sizeof(KpointType));
+        for(size_t idx = 0;idx < stop;idx++) ns[idx] = psi[idx] + nvns[stop + idx];
+        delete RT1;
     }
 
 
 
     if(ct.xc_is_hybrid && Functional::is_exx_active())
     {
-        for(size_t i = 0; i < stop; i++) nv[i] += ct.exx_fraction * kpoint->vexx[(size_t)first_state*(size_t)P0_BASIS + i];
-        //AppExx(kpoint, psi, num_states, kpoint->vexx, &nv[(size_t)first_state*(size_t)P0_BASIS]);
+        if(ct.exx_ace)
+            AppExx(kpoint, psi, num_states, kpoint->vexx, nv);
+        else
+            for(size_t i = 0; i < stop; i++) nv[i] += ct.exx_fraction * kpoint->vexx[(size_t)first_state*(size_t)P0_BASIS + i];
 
     }
 
@@ -337,6 +348,33 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
 }
 
 
+template void BetaxpsiAppNls<double>(Kpoint<double> *, double *, double *, double *, double *, int, int);
+template void BetaxpsiAppNls<std::complex<double> >(Kpoint<std::complex<double>> *, std::complex<double> *, 
+        std::complex<double> *, std::complex<double> *, std::complex<double> *, int, int);
+
+// Fused non-local operator for a block of states. Computes <beta|psi> for the block,
+// including the ion ownership reduction, and then applies dnm/qqq to generate nv and ns
+// while the block of orbitals is still resident. The projections are written into sintR
+// at the block offset so they remain available to later users of newsint_local.
+    template <typename KpointType>
+void BetaxpsiAppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
+        KpointType *psi, KpointType *nv, KpointType *ns,
+        int first_state, int num_states)
+{
+    KpointType *weight = kpoint->nl_weight;
+#if HIP_ENABLED || CUDA_ENABLED
+    weight = kpoint->nl_weight_gpu;
+#endif
+
+    size_t sindex = (size_t)first_state * (size_t)ct.noncoll_factor * (size_t)kpoint->BetaProjector->get_num_tot_proj();
+    RmgTimer *RT1 = new RmgTimer("AppNls: Betaxpsi");
+    kpoint->BetaProjector->project(kpoint, &sintR[sindex], first_state*ct.noncoll_factor, num_states*ct.noncoll_factor, weight);
+    delete RT1;
+
+    AppNls(kpoint, sintR, psi, nv, ns, first_state, num_states);
+}
+
+
 template void AppS<double>(Kpoint<double> *, double *, double *, double *, int, int);
 template void AppS<std::complex<double> >(Kpoint<std::complex<double>> *, std::complex<double> *, 
         std::complex<double> *, std::complex<double> *, int, int);
@@ -498,16 +536,20 @@ void AppS(Kpoint<KpointType> *kpoint, KpointType *sintR,
 
 }
 
-template <typename T> void AppExx(Kpoint<double> *, double *, int, double *, double);
-template <typename T> void AppExx(Kpoint<std::complex<double>> *, std::complex<double> *, int, std::complex<double> *, std::complex<double> *);
+template void AppExx<double>(Kpoint<double> *, double *, int, double *, double *);
+template void AppExx<std::complex<double>>(Kpoint<std::complex<double>> *, std::complex<double> *, int, std::complex<double> *, std::complex<double> *);
 
-template <typename T> void AppExx(Kpoint<T> *kptr, T *psi, int N, T *vexx, T *nv)
+// Applies the ACE exchange operator -|xi><xi| to N orbitals in psi and adds the
+// result scaled by exx_fraction to nv. xi holds the projection vectors built by
+// Exxbase::BuildAce for all states of the kpoint.
+template <typename T> void AppExx(Kpoint<T> *kptr, T *psi, int N, T *xi, T *nv)
 {
+    RmgTimer RT0("AppNls: ACE exchange");
     char *trans_t = "t";
     char *trans_n = "n";
     char *trans_c = "c";
     char *trans_a = trans_t;
-    int pbasis = kptr->pbasis;
+    int pbasis = kptr->pbasis * ct.noncoll_factor;
     int factor=1;
     if(typeid(T) == typeid(std::complex<double>)) factor = 2;
     if(typeid(T) == typeid(std::complex<double>)) trans_a = trans_c;
@@ -515,20 +557,19 @@ template <typename T> void AppExx(Kpoint<T> *kptr, T *psi, int N, T *vexx, T *nv
     T alpha(1.0);
     T alphavel(vel);
     T beta(0.0);
-    T exx_fraction(ct.exx_fraction);
+    T exx_fraction(-ct.exx_fraction);
 
-    // Compute the overlap matrix
+    // Compute <xi|psi>
     T *overlaps = new T[kptr->nstates * N];
 
-    RmgGemm(trans_a, trans_n, N, kptr->nstates, pbasis, alphavel, kptr->prev_orbitals, pbasis,
-            psi, pbasis, beta, overlaps, N);
+    RmgGemm(trans_a, trans_n, kptr->nstates, N, pbasis, alphavel, xi, pbasis,
+            psi, pbasis, beta, overlaps, kptr->nstates);
 
     BlockAllreduce((double *)overlaps, (size_t)(kptr->nstates)*(size_t)N * (size_t)factor, kptr->grid_comm);
 
     // Update nv
-    RmgGemm(trans_n, trans_n, pbasis, N, kptr->nstates, exx_fraction, vexx, pbasis,
+    RmgGemm(trans_n, trans_n, pbasis, N, kptr->nstates, exx_fraction, xi, pbasis,
             overlaps, kptr->nstates, alpha, nv, pbasis);
 
     delete [] overlaps;
 }
-
@@ -43,7 +43,7 @@ template double ApplyHamiltonianBlock<std::complex<double> >(Kpoint<std::complex
 
 
 // Threaded routine that applies Hamiltonian operator to a block of orbitals of size num_states
-// starting from first_state. 
+// starting from first_state. The <beta|psi> projections for the block are also updated.
 
 template <typename KpointType>
 double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num_states, KpointType *h_psi, double *vtot, double *vxc_psi)
@@ -60,7 +60,7 @@ double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num
     istop = istop * active_threads;
 
     // Apply the non-local operators to this block of orbitals
-    AppNls(kptr, kptr->newsint_local, kptr->Kstates[first_state].psi, kptr->nv, &kptr->ns[first_state*pbasis_noncoll],
+    BetaxpsiAppNls(kptr, kptr->newsint_local, kptr->Kstates[first_state].psi, kptr->nv, &kptr->ns[first_state*pbasis_noncoll],
            first_state, std::min(ct.non_local_block_size, num_states));
 
     int first_nls = 0;
@@ -75,7 +75,7 @@ double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num
         // Make sure the non-local operators are applied for the next block if needed
         int check = first_nls + active_threads;
         if(check > ct.non_local_block_size) {
-            AppNls(kptr, kptr->newsint_local, kptr->Kstates[st1].psi, kptr->nv, &kptr->ns[st1 * pbasis_noncoll],
+            BetaxpsiAppNls(kptr, kptr->newsint_local, kptr->Kstates[st1].psi, kptr->nv, &kptr->ns[st1 * pbasis_noncoll],
                    st1, std::min(ct.non_local_block_size, num_states + first_state - st1));
             first_nls = 0;
         }
@@ -113,7 +113,7 @@ double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num
         // Make sure the non-local operators are applied for the next state if needed
         int check = first_nls + 1;
         if(check > ct.non_local_block_size) {
-            AppNls(kptr, kptr->newsint_local, kptr->Kstates[st1].psi, kptr->nv, &kptr->ns[st1 * pbasis_noncoll],
+            BetaxpsiAppNls(kptr, kptr->newsint_local, kptr->Kstates[st1].psi, kptr->nv, &kptr->ns[st1 * pbasis_noncoll],
                    st1, std::min(ct.non_local_block_size, num_states + first_state - st1));
             first_nls = 0;
         }
@@ -28,6 +28,7 @@
 #include "rmg_error.h"
 #include "rmgthreads.h"
 #include "RmgTimer.h"
+#include "OrbitalPager.h"
 #include "RmgThread.h"
 #include "GlobalSums.h"
 #include "Kpoint.h"
@@ -89,6 +90,14 @@ template <class KpointType> void Kpoint<KpointType>::ComputeHpsi (double *vtot_e
     for(int ib = 0;ib < nblocks;ib++)
     {
         int bofs = ib * block_size;
+
+        // Read the next block ahead while this one is processed
+        if(this->orbital_pager)
+        {
+            if(ib == 0) this->orbital_pager->Prefetch(0, block_size);
+            this->orbital_pager->Prefetch(bofs + block_size, block_size);
+        }
+
         RmgTimer *RT3 = new RmgTimer("Compute Hpsi: AppNls");
         AppNls(this, this->newsint_local, this->Kstates[bofs].psi, this->nv, 
                &this->ns[bofs * pbasis_noncoll],
@@ -134,11 +134,8 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
     KpointType *psi = this->orbital_storage;
 
     // Apply Hamiltonian to current set of eigenvectors. At the current time
-    // this->ns is also computed in ApplyHamiltonianBlock by AppNls and stored in this->ns
-    RT1 = new RmgTimer("6-Davidson: Betaxpsi");
-    this->BetaProjector->project(this, this->newsint_local, 0, nstates*ct.noncoll_factor, weight);
-    delete RT1;
-
+    // this->ns and newsint_local are also computed in ApplyHamiltonianBlock by
+    // BetaxpsiAppNls and stored in this->ns
     if(ct.ldaU_mode != LDA_PLUS_U_NONE)
     {   
         RmgTimer RTL("6-Davidson: ldaUop x psi"); 
@@ -258,11 +255,6 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
 
 
         // Apply Hamiltonian to the new vectors
-        RT1 = new RmgTimer("6-Davidson: Betaxpsi");
-        newsint = this->newsint_local + nbase * this->BetaProjector->get_num_nonloc_ions() * ct.max_nl * ct.noncoll_factor;
-        this->BetaProjector->project(this, newsint, nbase*ct.noncoll_factor, notconv*ct.noncoll_factor, weight);
-        delete RT1;
-
         if(ct.ldaU_mode != LDA_PLUS_U_NONE)
         {   
             RmgTimer RTL("6-Davidson: ldaUop x psi"); 
@@ -39,6 +39,7 @@
 #include <complex>
 #include "RmgParallelFft.h"
 #include "GlobalSums.h"
+#include "RmgGemm.h"
 
 
 void transform_so(std::complex<double> *product, std::complex<double> *product_tem, SPECIES &sp);
@@ -65,7 +66,28 @@ template <typename KpointType> void GetAugRho(Kpoint<KpointType> **Kpts, double
 
     std::complex<double> *product = new std::complex<double>[max_product * factor];
     std::complex<double> *product_tem = new std::complex<double>[max_product * factor];
-    KpointType *sint = new KpointType[2 * ct.max_nl];
+
+    // Occupied states over all k-points on this node. Each contributes one column
+    // to the projection matrices used to form the products below.
+    std::vector<int> occ_kpt, occ_state;
+    std::vector<double> occ_weight;
+    for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
+    {
+        for (int istate = 0; istate < ct.num_states; istate++)
+        {
+            double t1 = Kpts[kpt]->Kstates[istate].occupation[0] * Kpts[kpt]->kp.kweight;
+            if(t1 == 0.0) continue;
+            occ_kpt.push_back(kpt);
+            occ_state.push_back(istate);
+            occ_weight.push_back(t1);
+        }
+    }
+    int nocc = occ_weight.size();
+    int ldp = ct.noncoll_factor * ct.max_nl;
+    KpointType *sint = new KpointType[(size_t)ldp * std::max(nocc, 1)];
+    KpointType *wsint = new KpointType[(size_t)ldp * std::max(nocc, 1)];
+    KpointType *pmat = new KpointType[ldp * ldp];
+    KpointType one(1.0), zero(0.0);
 
     for (int ion = 0; ion < num_nonloc_ions; ion++)
     {
@@ -78,6 +100,7 @@ template <typename KpointType> void GetAugRho(Kpoint<KpointType> **Kpts, double
 
             SPECIES &sp = Species[iptr->species];
             int nh = Species[iptr->species].nh;
+            int nhc = ct.noncoll_factor * nh;
 
             int *ivec = Atoms[gion].Qindex.data();
 
@@ -86,50 +109,50 @@ template <typename KpointType> void GetAugRho(Kpoint<KpointType> **Kpts, double
             for (int i=0; i < max_product * factor; i++)
                 product[i] = 0.0;
 
-            for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
+            // Gather <beta|psi> for this ion into an (ncf*nh x nocc) matrix with spinor
+            // components stacked along the rows, and a copy scaled by the occupations.
+            for (int io = 0; io < nocc; io++)
             {
-
-                /* Loop over states and accumulate charge */
-                for (int istate = 0; istate < ct.num_states; istate++)
+                KpointType *nsint = Kpts[occ_kpt[io]]->newsint_local;
+                for(int is = 0; is < ct.noncoll_factor; is++)
                 {
-                    double t1 = Kpts[kpt]->Kstates[istate].occupation[0] * Kpts[kpt]->kp.kweight;
-
-                    for(int is = 0; is < ct.noncoll_factor; is++)
-                    {    
-                        for (int i = 0; i < ct.max_nl; i++)
-                        {
-                            sint[i + is * ct.max_nl] = Kpts[kpt]->newsint_local[(ct.noncoll_factor * istate + is)*num_nonloc_ions*ct.max_nl + ion * ct.max_nl + i];
-                        }               /*end for i */
+                    size_t offset = (size_t)(ct.noncoll_factor * occ_state[io] + is)*num_nonloc_ions*ct.max_nl + ion * ct.max_nl;
+                    for (int i = 0; i < nh; i++)
+                    {
+                        sint[io*nhc + is*nh + i] = nsint[offset + i];
+                        wsint[io*nhc + is*nh + i] = occ_weight[io] * nsint[offset + i];
                     }
+                }
+            }
 
+            // product_ij = sum_occ w * <beta_i|psi> conj(<beta_j|psi>) for all states
+            // and k-points at once. A general multiply is used rather than a rank-k
+            // update since smearing can produce negative occupations.
+            if(nocc)
+                RmgGemm("N", "C", nhc, nhc, nocc, one, sint, nhc, wsint, nhc, zero, pmat, nhc);
+            else
+                for(int idx = 0;idx < nhc*nhc;idx++) pmat[idx] = zero;
 
-                    int idx = 0;
+            for(int is = 0; is < ct.noncoll_factor; is++)
+            {
+                for(int isp = 0; isp < ct.noncoll_factor; isp++)
+                {
                     for (int i = 0; i < nh; i++)
                     {
                         for (int j = 0; j < nh; j++)
                         {
-
-                            double t2 = t1;
-                            //if(i != j) t2 = 2.0 * t1;
-
-                            product[idx] += t2 * sint[i] * std::conj(sint[j]);
-
-                            if(ct.noncoll)
-                            {
-                                product[idx + 1 * max_product] += t2 * sint[i] * std::conj(sint[j+ct.max_nl]);
-                                product[idx + 2 * max_product] += t2 * sint[i+ct.max_nl] * std::conj(sint[j]);
-                                product[idx + 3 * max_product] += t2 * sint[i+ct.max_nl] * std::conj(sint[j+ct.max_nl]);
-                            }
-
-                            idx++;
-
-                        }           /*end for j */
-                    }               /*end for i */
-                }                   /*end for istate */
-            }                       /*end for kpt */
+                            product[i*nh + j + (is*ct.noncoll_factor + isp) * max_product] =
+                                pmat[(i + is*nh) + (j + isp*nh)*nhc];
+                        }
+                    }
+                }
+            }
 
             if(sp.is_spinorb) transform_so(product, product_tem, sp);
 
+                // The augmentation charge is a sparse matrix-vector product. Each
+                // augfunc_desc entry is a column of Q(r) values on the ion's grid points
+                // weighted by coefficients that depend only on the (i,j) pair.
                 double *cgarray = ct.cg_coeff.data();
                 for (auto& aug: Atoms[gion].augfunc_desc)
                 {
@@ -137,27 +160,34 @@ template <typename KpointType> void GetAugRho(Kpoint<KpointType> **Kpts, double
                     int j = aug.second.jval;
                     float *radial = Atoms[gion].grid_qr[qnm_key(aug.second.nb, aug.second.mb, aug.second.lval)].data();
                     double *grid_ylm = Atoms[gion].grid_ylm[aug.second.ylm_idx].data();
-                    for (int icount = 0; icount < ncount; icount++)
+                    double cg = cgarray[aug.second.cg_idx];
+
+                    double coef[4];
+                    coef[0] = std::real(product[i * nh+j]);
+                    if(i != j) coef[0] += std::real(product[j * nh+i]);
+                    if(ct.noncoll)
                     {
-                        double Qr = cgarray[aug.second.cg_idx] * (double)radial[icount] * (double)grid_ylm[icount];
-                        taugrho[icount] += Qr * std::real(product[i * nh+j]);
-                        if(i != j) taugrho[icount] += Qr * std::real(product[j * nh+i]);
-                        if(ct.noncoll)
+                        coef[0] += std::real(product[i*nh+j + 3 * max_product]);
+                        coef[1] = std::real( product[i*nh+j + 1 * max_product]+product[i*nh+j + 2 * max_product]);
+                        coef[2] = std::imag( product[i*nh+j + 1 * max_product]-product[i*nh+j + 2 * max_product]);
+                        coef[3] = std::real(product[i*nh+j] - product[i*nh+j + 3 * max_product]);
+                        if(i != j)
                         {
-                            taugrho[icount] += Qr * std::real(product[i*nh+j + 3 * max_product]);
-                            taugrho[icount + 1 * pbasis ] += Qr * std::real( product[i*nh+j + 1 * max_product]+product[i*nh+j + 2 * max_product]);
-                            taugrho[icount + 2 * pbasis ] += Qr * std::imag( product[i*nh+j + 1 * max_product]-product[i*nh+j + 2 * max_product]);
-                            taugrho[icount + 3 * pbasis ] += Qr * std::real(product[i*nh+j] - product[i*nh+j + 3 * max_product]);
-                            if(i != j)
-                            {
-                                taugrho[icount] += Qr *std::real( product[j*nh+i + 3 * max_product]);
-                                taugrho[icount + 1 * pbasis ] += Qr * std::real( product[j*nh+i + 1 * max_product]+product[j*nh+i + 2 * max_product]);
-                                taugrho[icount + 2 * pbasis ] += Qr * std::imag( product[j*nh+i + 1 * max_product]-product[j*nh+i + 2 * max_product]);
-                                taugrho[icount + 3 * pbasis ] += Qr * std::real(product[j*nh+i] - product[j*nh+i + 3 * max_product]);
-                            }
-
+                            coef[0] += std::real( product[j*nh+i + 3 * max_product]);
+                            coef[1] += std::real( product[j*nh+i + 1 * max_product]+product[j*nh+i + 2 * max_product]);
+                            coef[2] += std::imag( product[j*nh+i + 1 * max_product]-product[j*nh+i + 2 * max_product]);
+                            coef[3] += std::real(product[j*nh+i] - product[j*nh+i + 3 * max_product]);
                         }
-                    }           /*end for icount */
+                    }
+
+                    for(int ispin = 0; ispin < factor; ispin++)
+                    {
+                        double c = cg * coef[ispin];
+                        double *tr = &taugrho[ispin * pbasis];
+#pragma omp simd
+                        for (int icount = 0; icount < ncount; icount++)
+                            tr[icount] += c * (double)radial[icount] * grid_ylm[icount];
+                    }
                 }
 
                 // Scatter back
@@ -173,6 +203,8 @@ template <typename KpointType> void GetAugRho(Kpoint<KpointType> **Kpts, double
 
     GlobalSums(augrho, pbasis * factor, pct.kpsub_comm);
 
+    delete [] pmat;
+    delete [] wsint;
     delete [] sint;
     delete [] product;
     delete [] product_tem;
@@ -65,6 +65,15 @@ template <class KpointType> void Kpoint<KpointType>::GetDelocalizedWeight (void)
     Projector<KpointType> *P = BetaProjector;
     size_t stride = P->get_pstride();
 
+    // Real-space Bloch phase for species that store only the k=0 transform
+    std::complex<double> *bloch = ct.is_gamma ? NULL : new std::complex<double>[pbasis];
+    double kzero[3] = {0.0, 0.0, 0.0};
+
+    // When the forward transforms are not stored they are generated for this k-point
+    // once per species and shared by all ions of that species.
+    std::vector<std::complex<double> *> sp_beta(Species.size(), NULL);
+    std::vector<std::complex<double> *> sp_beta_r(3*Species.size(), NULL);
+
     /* Loop over ions */
     for (size_t ion = 0, i_end = Atoms.size(); ion < i_end; ++ion)
     {
@@ -79,8 +88,63 @@ template <class KpointType> void Kpoint<KpointType>::GetDelocalizedWeight (void)
         int nlzdim = get_NZ_GRID();
 
         /*Calculate the phase factor for delocalized case */
+        bool kindep = AtomType.forward_beta_k_independent;
+        double *nlcrds = P->nlcrds[ion].data();
+        FindPhaseKpoint (kindep ? kzero : kvec, nlxdim, nlydim, nlzdim, nlcrds, fftw_phase, false);
+
+        // The k=0 projector shifted to nlcrds is centred half a cell away from nlcrds. With
+        // d the minimum image displacement from that centre the weight for this k-point is
+        // the k=0 weight times exp(-ik.(d+nlcrds)).
+        bool use_bloch = kindep && bloch;
+        if(use_bloch)
+        {
+            double nlxtal[3];
+            Rmg_L.to_crystal(nlxtal, nlcrds);
+            int dimx = get_PX0_GRID(), dimy = get_PY0_GRID(), dimz = get_PZ0_GRID();
+            int ixstart = get_PX_OFFSET(), iystart = get_PY_OFFSET(), izstart = get_PZ_OFFSET();
+            for(int ix = 0;ix < dimx;ix++)
+            {
+                for(int iy = 0;iy < dimy;iy++)
+                {
+                    for(int iz = 0;iz < dimz;iz++)
+                    {
+                        double xtal[3], d[3];
+                        xtal[0] = (double)(ix + ixstart) / (double)nlxdim - nlxtal[0] + 0.5;
+                        xtal[1] = (double)(iy + iystart) / (double)nlydim - nlxtal[1] + 0.5;
+                        xtal[2] = (double)(iz + izstart) / (double)nlzdim - nlxtal[2] + 0.5;
+                        for(int i = 0;i < 3;i++) xtal[i] -= std::round(xtal[i]);
+                        Rmg_L.to_cartesian(xtal, d);
+                        double kdd = kvec[0] * (d[0] + nlcrds[0]) + kvec[1] * (d[1] + nlcrds[1]) +
+                                     kvec[2] * (d[2] + nlcrds[2]);
+                        bloch[ix * dimy * dimz + iy * dimz + iz] = std::exp(std::complex<double>(0.0, -kdd));
+                    }
+                }
+            }
+        }
 
-        FindPhaseKpoint (kvec, nlxdim, nlydim, nlzdim, P->nlcrds[ion].data(), fftw_phase, false);
+        std::complex<double> *fbeta, *fbeta_r[3] = {NULL, NULL, NULL};
+        if(AtomType.forward_beta)
+        {
+            size_t kofs = kindep ? 0 : (size_t)kidx * (size_t)AtomType.num_projectors * (size_t)pbasis;
+            fbeta = (std::complex<double> *)&AtomType.forward_beta[kofs];
+            if(ct.stress)
+                for(int ixyz = 0;ixyz < 3;ixyz++) fbeta_r[ixyz] = (std::complex<double> *)&AtomType.forward_beta_r[ixyz][kofs];
+        }
+        else
+        {
+            int isp = Atoms[ion].species;
+            if(!sp_beta[isp])
+            {
+                RmgTimer RT1("Weight: generate beta");
+                size_t length = (size_t)AtomType.num_projectors * (size_t)pbasis;
+                sp_beta[isp] = new std::complex<double>[length];
+                if(ct.stress)
+                    for(int ixyz = 0;ixyz < 3;ixyz++) sp_beta_r[3*isp + ixyz] = new std::complex<double>[length];
+                AtomType.GetDelocalizedBeta(kvec, sp_beta[isp], &sp_beta_r[3*isp]);
+            }
+            fbeta = sp_beta[isp];
+            for(int ixyz = 0;ixyz < 3;ixyz++) fbeta_r[ixyz] = sp_beta_r[3*isp + ixyz];
+        }
 
         /* Loop over radial projectors */
         for (int ip = 0; ip < AtomType.num_projectors; ip++)
@@ -88,13 +152,14 @@ template <class KpointType> void Kpoint<KpointType>::GetDelocalizedWeight (void)
             Nlweight = &nl_weight[offset + ip * pbasis];
 
             /*Temporary pointer to the already calculated forward transform */
-            fptr = (std::complex<double> *)AtomType.forward_beta[kidx * AtomType.num_projectors * pbasis + ip*pbasis];
+            fptr = &fbeta[ip*pbasis];
 
             /*Apply the phase factor */
             for (int idx = 0; idx < pbasis; idx++) gbptr[idx] =  fptr[idx] * std::conj(fftw_phase[idx]);
 
             /*Do the backwards transform */
             coarse_pwaves->FftInverse(gbptr, beptr);
+            if(use_bloch) for (int idx = 0; idx < pbasis; idx++) beptr[idx] *= bloch[idx];
 
             std::complex<double> *Nlweight_C = (std::complex<double> *)Nlweight;
             double *Nlweight_R = (double *)Nlweight;
@@ -120,13 +185,14 @@ template <class KpointType> void Kpoint<KpointType>::GetDelocalizedWeight (void)
                 Nlweight = &nl_weight[nl_weight_size * (ixyz+1) + offset + ip * pbasis];
 
                 /*Temporary pointer to the already calculated forward transform */
-                fptr = (std::complex<double> *)AtomType.forward_beta_r[ixyz][kidx * AtomType.num_projectors * pbasis + ip*pbasis];
+                fptr = &fbeta_r[ixyz][ip*pbasis];
 
                 /*Apply the phase factor */
                 for (int idx = 0; idx < pbasis; idx++) gbptr[idx] =  fptr[idx] * std::conj(fftw_phase[idx]);
 
                 /*Do the backwards transform */
                 coarse_pwaves->FftInverse(gbptr, beptr);
+                if(use_bloch) for (int idx = 0; idx < pbasis; idx++) beptr[idx] *= bloch[idx];
 
                 std::complex<double> *Nlweight_C = (std::complex<double> *)Nlweight;
                 double *Nlweight_R = (double *)Nlweight;
@@ -149,6 +215,9 @@ template <class KpointType> void Kpoint<KpointType>::GetDelocalizedWeight (void)
 
 
 
+    for(auto ptr : sp_beta_r) delete [] ptr;
+    for(auto ptr : sp_beta) delete [] ptr;
+    delete [] bloch;
     delete [] fftw_phase;
     fftw_free (gbptr);
     fftw_free (beptr);
@@ -34,12 +34,22 @@
 #include "GpuAlloc.h"
 
 // Used for localizing projectors in real space
-template void Kpoint<double>::GetLocalizedWeight(void);
-template void Kpoint<std::complex<double>>::GetLocalizedWeight(void);
+template void Kpoint<double>::GetLocalizedWeight(std::vector<bool> *);
+template void Kpoint<std::complex<double>>::GetLocalizedWeight(std::vector<bool> *);
 
-template <class KpointType> void Kpoint<KpointType>::GetLocalizedWeight (void)
+// If skip is non-NULL ions with (*skip)[ion] set are assumed to already have valid
+// weights in nl_weight and are not regenerated.
+template <class KpointType> void Kpoint<KpointType>::GetLocalizedWeight (std::vector<bool> *skip)
 {
 
+    // Only the k-independent forward transform is stored in this case
+    if(ct.batched_kpoint_weights)
+    {
+        Kpoint<KpointType> *kptr = this;
+        GetLocalizedWeightBatched(&kptr, 1, skip);
+        return;
+    }
+
     int max_size;
     KpointType *Nlweight;
     std::complex<double> I_t(0.0, 1.0);
@@ -80,6 +90,8 @@ template <class KpointType> void Kpoint<KpointType>::GetLocalizedWeight (void)
     {
 
         int ion = nonloc_ions_list[ion1];
+        if(skip && (*skip)[ion]) continue;
+
         /* Generate ion pointer */
         iptr = &Atoms[ion];
 
@@ -0,0 +1,164 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+
+
+#include "const.h"
+
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include <complex>
+#include "Kpoint.h"
+#include "common_prototypes.h"
+#include "common_prototypes1.h"
+#include "transition.h"
+#include "GpuAlloc.h"
+
+// Generates localized projector weights for a set of k-points. The shifted real-space
+// projector for each ion is computed once from the k-independent forward transform
+// (stored when ct.batched_kpoint_weights is set) and the weights for every k-point
+// are then obtained by applying the Bloch phase exp(-ik.(r-d)) on the projector box.
+// Ions with (*skip)[ion] set are left untouched when skip is non-NULL.
+template void GetLocalizedWeightBatched<double>(Kpoint<double> **, int, std::vector<bool> *);
+template void GetLocalizedWeightBatched<std::complex<double>>(Kpoint<std::complex<double>> **, int, std::vector<bool> *);
+
+template <typename KpointType>
+void GetLocalizedWeightBatched (Kpoint<KpointType> **Kptr, int nkpts, std::vector<bool> *skip)
+{
+    RmgTimer RT0("Weight: batched");
+
+    Kpoint<KpointType> *kptr0 = Kptr[0];
+    int num_nonloc_ions = kptr0->BetaProjector->get_num_nonloc_ions();
+    int *nonloc_ions_list = kptr0->BetaProjector->get_nonloc_ions_list();
+    Projector<KpointType> *P = kptr0->BetaProjector;
+
+    int P0_BASIS = kptr0->pbasis;
+    double hxgrid = Rmg_G->get_hxgrid(1);
+    double hygrid = Rmg_G->get_hygrid(1);
+    double hzgrid = Rmg_G->get_hzgrid(1);
+
+    /*maximum of nldim^3 for any species */
+    int max_size = ct.max_nldim * ct.max_nldim * ct.max_nldim;
+
+    std::complex<double> *beptr = (std::complex<double> *)fftw_malloc(sizeof(std::complex<double>) * 2 * max_size);
+    if (beptr == NULL)
+        rmg_error_handler (__FILE__, __LINE__, "can't allocate memory\n");
+    std::complex<double> *gbptr = beptr + max_size;
+    std::complex<double> *phase_fftw = new std::complex<double>[max_size];
+    std::complex<double> *kbptr = new std::complex<double>[max_size];
+
+    // Bloch phase on the projector box for each k-point and species. These only depend
+    // on the box dimensions so they are shared by all ions of a species.
+    std::vector<std::complex<double> *> box_phase(Species.size() * nkpts, NULL);
+    for(size_t isp = 0;isp < Species.size();isp++)
+    {
+        int nldim = P->get_nldim(isp);
+        int size = nldim * nldim * nldim;
+        for(int kpt = 0;kpt < nkpts;kpt++)
+        {
+            std::complex<double> *kphase = new std::complex<double>[size];
+            double *kvec = Kptr[kpt]->kp.kvec;
+            for (int ix = 0; ix < nldim; ix++)
+            {
+                for (int iy = 0; iy < nldim; iy++)
+                {
+                    for (int iz = 0; iz < nldim; iz++)
+                    {
+                        double ax[3], bx[3];
+                        ax[0] = (ix-nldim/2) * hxgrid;
+                        ax[1] = (iy-nldim/2) * hygrid;
+                        ax[2] = (iz-nldim/2) * hzgrid;
+                        to_cartesian (ax, bx);
+                        double kdr = kvec[0] * bx[0] + kvec[1] * bx[1] + kvec[2] * bx[2];
+                        if(ct.proj_nophase) kdr = 0.0;
+                        kphase[ix * nldim * nldim + iy * nldim + iz] = std::exp(std::complex<double>(0.0, -kdr));
+                    }
+                }
+            }
+            box_phase[isp * nkpts + kpt] = kphase;
+        }
+    }
+
+    /* Loop over ions */
+    for (int ion1 = 0; ion1 < num_nonloc_ions; ion1++)
+    {
+
+        int ion = nonloc_ions_list[ion1];
+        if(skip && (*skip)[ion]) continue;
+        ION *iptr = &Atoms[ion];
+        SPECIES *sp = &Species[iptr->species];
+
+        int nlxdim = P->get_nldim(iptr->species);
+        int nlydim = P->get_nldim(iptr->species);
+        int nlzdim = P->get_nldim(iptr->species);
+        int coarse_size = nlxdim * nlydim * nlzdim;
+
+        /*Calculate the phase factor for the sub-grid shift of the ion */
+        double *nlcrds = P->nlcrds[ion].data();
+        FindPhase(sp, nlxdim, nlydim, nlzdim, nlcrds, phase_fftw);
+
+        /*The k-independent forward transform */
+        std::complex<double> *fptr = (std::complex<double> *)sp->forward_beta;
+
+        for (int ip = 0; ip < sp->num_projectors; ip++)
+        {
+            /*Shift the projector to the ion position and transform back to real space */
+            for (int idx = 0; idx < coarse_size; idx++)
+            {
+                gbptr[idx] = fptr[idx] * std::conj(phase_fftw[idx]);
+            }
+            sp->prj_pwave->FftInverse(gbptr, beptr);
+
+            /*Apply the Bloch phase for each k-point and store the weights */
+            for(int kpt = 0;kpt < nkpts;kpt++)
+            {
+                double *kvec = Kptr[kpt]->kp.kvec;
+                double kdd = kvec[0] * nlcrds[0] + kvec[1] * nlcrds[1] + kvec[2] * nlcrds[2];
+                if(ct.proj_nophase) kdd = 0.0;
+                std::complex<double> dphase = std::exp(std::complex<double>(0.0, kdd));
+                std::complex<double> *kphase = box_phase[iptr->species * nkpts + kpt];
+                for (int idx = 0; idx < coarse_size; idx++)
+                {
+                    kbptr[idx] = beptr[idx] * kphase[idx] * dphase;
+                }
+
+                KpointType *Nlweight = &Kptr[kpt]->nl_weight[(size_t)ion1 * ct.max_nl * P0_BASIS + (size_t)ip * P0_BASIS];
+                AssignWeight (Kptr[kpt], sp, ion, reinterpret_cast<fftw_complex*>(kbptr), Nlweight);
+            }
+
+            fptr += coarse_size;
+
+        }                   /*end for(ip = 0;ip < sp->num_projectors;ip++) */
+
+    }                           /* end for */
+
+    for(auto ptr : box_phase) delete [] ptr;
+    delete [] kbptr;
+    delete [] phase_fftw;
+    fftw_free (beptr);
+
+#if HIP_ENABLED || CUDA_ENABLED
+    for(int kpt = 0;kpt < nkpts;kpt++)
+        gpuMemcpy(Kptr[kpt]->nl_weight_gpu, Kptr[kpt]->nl_weight, Kptr[kpt]->nl_weight_size*sizeof(KpointType), gpuMemcpyHostToDevice);
+#endif
+
+}                               /* end GetLocalizedWeightBatched */
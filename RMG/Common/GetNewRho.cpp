@@ -44,6 +44,7 @@
 #include "RmgThread.h"
 #include "Symmetry.h"
 #include "Voronoi.h"
+#include "DensityTiles.h"
 
 
 
@@ -71,12 +72,25 @@ template <typename OrbitalType> void GetNewRho(Kpoint<OrbitalType> **Kpts, doubl
     else
         GetNewRhoPre(Kpts, rho);
         
+    // The total charge is summed while the augmentation charge is added since
+    // symmetrization only averages over permutations of the grid and does not
+    // change it.
+    double tcharge = 0.0;
     if(!ct.norm_conserving_pp) {
         double *augrho = new double[FP0_BASIS*factor]();
         GetAugRho(Kpts, augrho);
-        for(int idx = 0;idx < FP0_BASIS*factor;idx++) rho[idx] += augrho[idx];
+        for(int idx = 0;idx < FP0_BASIS;idx++)
+        {
+            rho[idx] += augrho[idx];
+            tcharge += rho[idx];
+        }
+        for(int idx = FP0_BASIS;idx < FP0_BASIS*factor;idx++) rho[idx] += augrho[idx];
         delete [] augrho;
     }
+    else
+    {
+        for (int idx = 0; idx < FP0_BASIS; idx++) tcharge += rho[idx];
+    }
 
     if(ct.is_use_symmetry)
     {
@@ -89,9 +103,7 @@ template <typename OrbitalType> void GetNewRho(Kpoint<OrbitalType> **Kpts, doubl
 
 
     /* Check total charge. */
-    ct.tcharge = ZERO;
-    for (int idx = 0; idx < FP0_BASIS; idx++)
-        ct.tcharge += rho[idx];
+    ct.tcharge = tcharge;
 
     if(ct.AFM) ct.tcharge *=2.0;
     /* ct.tcharge = real_sum_all (ct.tcharge); */
@@ -252,41 +264,43 @@ template <typename OrbitalType> void GetNewRhoPost(Kpoint<OrbitalType> **Kpts, d
     for(int idx = 0;idx < pbasis * factor;idx++)
         work[idx] = 0.0;
 
-    for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
+    // Each thread owns a set of grid tiles and streams every state and k-point
+    // through them, so no per-thread copies of the density or reduction are needed.
+    int tsize = DensityTileSize(pbasis);
+    int ntiles = (pbasis + tsize - 1) / tsize;
+#pragma omp parallel for schedule(static)
+    for(int tile = 0;tile < ntiles;tile++)
     {
-#pragma omp parallel
-        {
-            double *tarr = new double[pbasis * factor]();
-            std::complex<double> psiud;
-#pragma omp barrier
+        int start = tile * tsize;
+        int stop = std::min(start + tsize, pbasis);
+        std::complex<double> psiud;
 
+        for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
+        {
             /* Loop over states and accumulate charge */
-#pragma omp for schedule(static, 1) nowait
             for (int istate = 0; istate < nstates; istate++)
             {
 
                 double scale = Kpts[kpt]->Kstates[istate].occupation[0] * Kpts[kpt]->kp.kweight;
+                if(scale == 0.0) continue;
 
                 OrbitalType *psi = Kpts[kpt]->Kstates[istate].psi;
 
-                for (int idx = 0; idx < pbasis; idx++)
+                for (int idx = start; idx < stop; idx++)
                 {
-                    tarr[idx] += scale * std::norm(psi[idx]);
+                    work[idx] += scale * std::norm(psi[idx]);
                     if(ct.noncoll)
                     {
                         psiud = 2.0 * psi[idx] * std::conj(psi[idx + pbasis]);
-                        tarr[idx + 1 * pbasis] += scale * std::real(psiud);
-                        tarr[idx + 2 * pbasis] += scale * std::imag(psiud);
-                        tarr[idx + 3 * pbasis] += scale * std::norm(psi[idx + pbasis]);
+                        work[idx + 1 * pbasis] += scale * std::real(psiud);
+                        work[idx + 2 * pbasis] += scale * std::imag(psiud);
+                        work[idx + 3 * pbasis] += scale * std::norm(psi[idx + pbasis]);
                     }
                 }                   /* end for */
 
             }                       /*end for istate */
-#pragma omp critical
-            for(int idx = 0; idx < pbasis * factor; idx++) work[idx] += tarr[idx];
-            delete [] tarr;
-        }
-    }                           /*end for kpt */
+        }                           /*end for kpt */
+    }
 
     MPI_Allreduce(MPI_IN_PLACE, (double *)work, pbasis * factor, MPI_DOUBLE, MPI_SUM, pct.kpsub_comm);
     if(ct.noncoll)
@@ -35,6 +35,7 @@
 #include "transition.h"
 #include "const.h"
 #include "RmgTimer.h"
+#include "OrbitalPager.h"
 #include "rmgtypedefs.h"
 #include "params.h"
 #include "typedefs.h"
@@ -78,7 +79,7 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
     ct.nvme_orbital_fd = -1;
     ct.nvme_work_fd = -1;
 
-    OrbitalType *rptr = NULL, *nv, *ns = NULL;
+    OrbitalType *rptr = NULL, *nv, *ns = NULL, *nvns = NULL;
     double *vtot;
     double fac;
     bool need_ns = true;
@@ -281,6 +282,9 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
     nv = new OrbitalType[(size_t)ct.non_local_block_size * (size_t)P0_BASIS * ct.noncoll_factor]();
 #endif
 
+    if(!ct.norm_conserving_pp)
+        nvns = (OrbitalType *)RmgMallocHost(2 * (size_t)ct.non_local_block_size * (size_t)P0_BASIS * ct.noncoll_factor * sizeof(OrbitalType));
+
     ct.psi_alloc[0] = sizeof(OrbitalType) * (size_t)kpt_storage * (size_t)ct.alloc_states * (size_t)P0_BASIS * ct.noncoll_factor + (size_t)1024;
     MPI_Allreduce(&ct.psi_alloc[0], &ct.psi_alloc[1], 1, MPI_LONG, MPI_MIN, pct.grid_comm);
     MPI_Allreduce(&ct.psi_alloc[0], &ct.psi_alloc[2], 1, MPI_LONG, MPI_MAX, pct.grid_comm);
@@ -319,6 +323,7 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
         Kptr[kpt]->set_pool(rptr_k);
         Kptr[kpt]->nv = nv;
         Kptr[kpt]->ns = ns;
+        Kptr[kpt]->nvns = nvns;
 
         for (int st1 = 0; st1 < ct.max_states; st1++)
         {
@@ -332,6 +337,28 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
             rptr_k +=P0_BASIS * ct.noncoll_factor;
         }
 
+#if !(HIP_ENABLED || CUDA_ENABLED || SYCL_ENABLED)
+        // Orbitals mapped to disk are paged in blocks by the solvers
+        if(ct.nvme_orbitals && (ct.nvme_orbital_cache > 0))
+        {
+            // The block being processed and the one read ahead have to fit or the
+            // current block is evicted by every prefetch.
+            size_t orbital_bytes = (size_t)P0_BASIS * ct.noncoll_factor * sizeof(OrbitalType);
+            size_t min_cache = 2 * (size_t)ct.non_local_block_size * orbital_bytes;
+            size_t cache_bytes = (size_t)ct.nvme_orbital_cache * 1024 * 1024;
+            if(cache_bytes < min_cache)
+            {
+                if(kpt == 0)
+                    rmg_printf("WARNING: nvme_orbital_cache is smaller than two blocks of orbitals. Using %zu MB.\n",
+                            (min_cache + 1024*1024 - 1) / (1024*1024));
+                cache_bytes = min_cache;
+            }
+            if(Kptr[kpt]->orbital_pager) delete Kptr[kpt]->orbital_pager;
+            Kptr[kpt]->orbital_pager = new OrbitalPager(ct.nvme_orbital_fd, rptr, Kptr[kpt]->Kstates[0].psi,
+                    orbital_bytes, ct.max_states, cache_bytes);
+        }
+#endif
+
     }
 
 
@@ -344,6 +371,8 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
         std::string serial_name(ct.infile);
         if(ct.read_serial_restart)
             ReadSerialData (serial_name, vh, rho, vxc, Kptr);
+        else if(ct.read_hdf5_restart)
+            ReadHdf5Data (serial_name, vh, rho, vxc, Kptr);
         else
             ReadData (ct.infile, vh, rho, vxc, Kptr);
 
@@ -599,25 +628,45 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
 
     }
 
+    // Orbitals from a compressed restart file are reorthogonalized. With norm conserving
+    // pseudopotentials this is done before the projections below are generated. The
+    // ultrasoft case needs the projections for the S operator so those orbitals are
+    // orthogonalized afterwards and then projected again.
+    bool check_restart = (ct.runflag == RESTART) && ct.compressed_infile && !ct.read_hdf5_restart &&
+                         (ct.forceflag != BAND_STRUCTURE) && (ct.forceflag != NSCF);
+    if(check_restart && ct.norm_conserving_pp)
+    {
+        for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++) CheckRestartOrbitals(Kptr[kpt]);
+    }
+
     // Generate initial Betaxpsi
-    for (int kpt =0; kpt < ct.num_kpts_pe; kpt++)
+    int betaxpsi_passes = (check_restart && !ct.norm_conserving_pp) ? 2 : 1;
+    for (int pass = 0; pass < betaxpsi_passes; pass++)
     {
+        if(pass == 1)
+        {
+            for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++) CheckRestartOrbitals(Kptr[kpt]);
+        }
+
+        for (int kpt =0; kpt < ct.num_kpts_pe; kpt++)
+        {
 
-        RmgTimer *RT3 = new RmgTimer("2-Init: betaxpsi");
-        //Betaxpsi (Kptr[kpt], 0, Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->newsint_local);
+            RmgTimer *RT3 = new RmgTimer("2-Init: betaxpsi");
+            //Betaxpsi (Kptr[kpt], 0, Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->newsint_local);
 #if HIP_ENABLED || CUDA_ENABLED
-        Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, 
-                Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->nl_weight_gpu);
+            Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, 
+                    Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->nl_weight_gpu);
 #else
-        Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, 
-                Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->nl_weight);
+            Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, 
+                    Kptr[kpt]->nstates * ct.noncoll_factor, Kptr[kpt]->nl_weight);
 
 #endif
-        if(ct.ldaU_mode != LDA_PLUS_U_NONE)
-        {
-            LdaplusUxpsi(Kptr[kpt], 0, Kptr[kpt]->nstates, Kptr[kpt]->orbitalsint_local);
+            if(ct.ldaU_mode != LDA_PLUS_U_NONE)
+            {
+                LdaplusUxpsi(Kptr[kpt], 0, Kptr[kpt]->nstates, Kptr[kpt]->orbitalsint_local);
+            }
+            delete RT3;
         }
-        delete RT3;
     }
 
     if(ct.runflag == RESTART )
@@ -50,6 +50,7 @@
 #include "blas.h"
 #include "ErrorFuncs.h"
 #include "GpuAlloc.h"
+#include "OrbitalPager.h"
 
 extern "C" void zaxpy(int *n, std::complex<double> *alpha, std::complex<double> *x, int *incx, std::complex<double> *y, int *incy);
 
@@ -94,8 +95,10 @@ template <class KpointType> Kpoint<KpointType>::Kpoint(KSTRUCT &kpin, int kindex
     this->nl_weight_gpu = NULL;
 #endif
     this->orbital_weight = NULL;
+    this->nvns = NULL;
     this->BetaProjector = NULL;
     this->OrbitalProjector = NULL;
+    this->orbital_pager = NULL;
     this->ldaU = NULL;
     this->newsint_local = NULL;
     this->orbitalsint_local = NULL;
@@ -1308,6 +1311,11 @@ template <class KpointType> void Kpoint<KpointType>::get_ldaUop(int projector_ty
 // Cleans up nvme arrays if they have been used
 template <class KpointType> void Kpoint<KpointType>::DeleteNvmeArrays(void)
 {
+    if(this->orbital_pager)
+    {
+        delete this->orbital_pager;
+        this->orbital_pager = NULL;
+    }
     reset_beta_arrays();
     reset_orbital_arrays();
     if(nvme_weight_fd > 0)
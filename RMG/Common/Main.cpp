@@ -435,6 +435,16 @@ template <typename OrbitalType> void run (Kpoint<OrbitalType> **Kptr)
 
 template <typename OrbitalType> void outcubes (Kpoint<OrbitalType> **Kptr, double *vh, double *rho)
 {
+    std::string ext = ".cube";
+    void (*output)(double *, int, std::string) = OutputCubeFile<double>;
+    void (*output_psi)(OrbitalType *, int, std::string) = OutputCubeFile<OrbitalType>;
+    if(ct.volumetric_output_format == VOLUMETRIC_NPY)
+    {
+        ext = ".npy";
+        output = OutputNpyFile<double>;
+        output_psi = OutputNpyFile<OrbitalType>;
+    }
+
     std::string spinindex = "";
     if(ct.nspin==2 || ct.nspin == 4)
     {
@@ -444,8 +454,8 @@ template <typename OrbitalType> void outcubes (Kpoint<OrbitalType> **Kptr, doubl
 
     if(ct.cube_rho)
     {
-        std::string filename = "density"+spinindex+".cube";
-        OutputCubeFile(rho, Rmg_G->default_FG_RATIO, filename);
+        std::string filename = "density"+spinindex+ext;
+        output(rho, Rmg_G->default_FG_RATIO, filename);
 
 
 
@@ -457,15 +467,15 @@ template <typename OrbitalType> void outcubes (Kpoint<OrbitalType> **Kptr, doubl
 
             for(int idx = 0; idx < FP0_BASIS; idx++) rho_atoms[idx] = rho[idx] - rho_atoms[idx];
 
-            filename = "dipole_density"+spinindex+".cube";
+            filename = "dipole_density"+spinindex+ext;
 
-            OutputCubeFile(rho_atoms, Rmg_G->default_FG_RATIO, filename);
+            output(rho_atoms, Rmg_G->default_FG_RATIO, filename);
         }
     }
     if(ct.cube_vh)
     {
-        std::string filename = "vh.cube";
-        OutputCubeFile(vh, Rmg_G->default_FG_RATIO, filename);
+        std::string filename = "vh"+ext;
+        output(vh, Rmg_G->default_FG_RATIO, filename);
     }
 
     for(int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
@@ -475,14 +485,14 @@ template <typename OrbitalType> void outcubes (Kpoint<OrbitalType> **Kptr, doubl
         {
             int st = ct.cube_states_list[idx];
             std::string filename = "kpt"+std::to_string(kpt_glob);
-            filename += "_mo"+std::to_string(st)+ spinindex + ".cube";
-            OutputCubeFile(Kptr[kpt]->Kstates[st].psi, 1, filename);
+            filename += "_mo"+std::to_string(st)+ spinindex + ext;
+            output_psi(Kptr[kpt]->Kstates[st].psi, 1, filename);
 
             if(ct.nspin == 4)
             {
                 std::string filename = "kpt"+std::to_string(kpt_glob);
-                filename += "_mo"+std::to_string(st)+ "b.cube";
-                OutputCubeFile(Kptr[kpt]->Kstates[st].psi+Kptr[kpt]->pbasis, 1, filename);
+                filename += "_mo"+std::to_string(st)+ "b" + ext;
+                output_psi(Kptr[kpt]->Kstates[st].psi+Kptr[kpt]->pbasis, 1, filename);
             }
 
         }
@@ -538,6 +548,8 @@ void report ()
 void finish ()
 {
 
+    WaitRestartWrite();
+
     DeleteNvmeArrays();
     MPI_Barrier(MPI_COMM_WORLD);
     for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
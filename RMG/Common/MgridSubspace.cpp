@@ -33,6 +33,7 @@
 #include "BaseThread.h"
 #include "TradeImages.h"
 #include "RmgTimer.h"
+#include "OrbitalPager.h"
 #include "RmgThread.h"
 #include "GlobalSums.h"
 #include "Subdiag.h"
@@ -142,11 +143,6 @@ template <class KpointType> void Kpoint<KpointType>::MgridSubspace (double *vtot
            PotentialAccelerationReset(my_pe_offset*active_threads + this->dvh_skip/pct.coalesce_factor);
         }
 
-        // Update betaxpsi        
-        RT1 = new RmgTimer("3-MgridSubspace: Beta x psi");
-        this->BetaProjector->project(this, this->newsint_local, 0, mstates * ct.noncoll_factor, weight);
-        delete(RT1);
-
         if(ct.ldaU_mode != LDA_PLUS_U_NONE)
         {
             RmgTimer RTL("3-MgridSubspace: ldaUop x psi");
@@ -156,8 +152,17 @@ template <class KpointType> void Kpoint<KpointType>::MgridSubspace (double *vtot
         for(int ib = 0;ib < nblocks;ib++)
         {
             int bofs = ib * block_size;
+
+            // Read the next block ahead while this one is processed
+            if(this->orbital_pager)
+            {
+                if(ib == 0) this->orbital_pager->Prefetch(0, block_size);
+                this->orbital_pager->Prefetch(bofs + block_size, block_size);
+            }
+
+            // Betaxpsi for the block is computed together with the non-local operators
             RT1 = new RmgTimer("3-MgridSubspace: AppNls");
-            AppNls(this, this->newsint_local, this->Kstates[bofs].psi, this->nv, 
+            BetaxpsiAppNls(this, this->newsint_local, this->Kstates[bofs].psi, this->nv, 
                    &this->ns[bofs * pbasis_noncoll],
                    bofs, std::min(block_size, mstates - bofs));
             delete(RT1);
@@ -205,6 +210,8 @@ template <class KpointType> void Kpoint<KpointType>::MgridSubspace (double *vtot
             }
             if(ct.mpi_queue_mode) T->run_thread_tasks(active_threads, Rmg_Q);
 
+            if(this->orbital_pager) this->orbital_pager->WriteBehind(bofs, block_size);
+
         } // end for ib
 
         RT1 = new RmgTimer("3-MgridSubspace: Mg_eig");
@@ -71,7 +71,7 @@ void MixRho (double * new_rho, double * rho, double *rhocore, double *vh_in, dou
         std::vector<double> drho;
         drho.resize(pbasis_noncoll);
         for(int ix = 0;ix < pbasis_noncoll;ix++) drho[ix] = new_rho[ix] - rho[ix];
-        if(ct.drho_precond) Precond_drho(drho.data());
+        if(ct.drho_precond) Precond_drho(drho.data(), rho);
         t1 = ct.mix;
         int ione = 1;
         daxpy(&pbasis_noncoll, &t1, drho.data(), &ione, rho, &ione);
@@ -85,6 +85,7 @@ void MixRho (double * new_rho, double * rho, double *rhocore, double *vh_in, dou
         {
             Pulay_rho = new PulayMixing(pbasis_noncoll, ct.charge_pulay_order, ct.charge_pulay_refresh,
                     ct.mix, ct.mix, pct.grid_comm);
+            Pulay_rho->SetHistoryStorage(ct.mixing_history_storage);
             Pulay_rho->SetGspace(ct.drho_precond, ct.charge_pulay_Gspace, ct.drho_q0);
 
         }
@@ -99,13 +100,8 @@ void MixRho (double * new_rho, double * rho, double *rhocore, double *vh_in, dou
         daxpy(&pbasis_noncoll, &mone, rho, &ione, new_rho, &ione);
 
         // rho_new store thr rho resudyke,
-        if(ct.charge_pulay_Gspace) {
-            Pulay_rho->Mixing_rhoG(rho, new_rho);
-        }
-        else {
-
-            Pulay_rho->Mixing(rho, new_rho);
-        }
+        // Dispatches to the G-space engine when charge_pulay_Gspace is set
+        Pulay_rho->Mixing(rho, new_rho);
 
         rmg_printf("Charge density mixing: Pulay\n");
 
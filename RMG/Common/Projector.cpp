@@ -517,6 +517,13 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
     }
 
     // And now localized
+    int nchunks = std::min(ct.projector_pipeline_chunks, nstates);
+    if(nchunks > 1)
+    {
+        this->project_pipelined(kptr, orbitals, p, offset, nstates, weight, nchunks);
+        return;
+    }
+
     KpointType *own_buff = NULL, *nown_buff = NULL;
     KpointType *send_buff, *recv_buff;
     MPI_Request *req_send, *req_recv;
@@ -558,7 +565,7 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
 
     /*First post non-blocking receives for data about owned ions from cores who do not own the ions */
     betaxpsi_receive (recv_buff, this->num_owned_pe, this->owned_pe_list,
-            this->num_owned_ions_per_pe, req_recv, nstates);
+            this->num_owned_ions_per_pe, req_recv, nstates, 111);
 
 
     // Set sint array
@@ -576,7 +583,7 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
 
     /*Send <beta|psi> contributions  to the owning PE */
     betaxpsi_send (send_buff, this->num_owners, this->owners_list,
-            this->num_nonowned_ions_per_pe, req_send, nstates);
+            this->num_nonowned_ions_per_pe, req_send, nstates, 111);
 
     /*Wait until all data is received */
     if(this->num_owned_pe)
@@ -599,7 +606,7 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
 
     /*Receive summed data for non-owned ions from owners */
     betaxpsi_receive (recv_buff, this->num_owners, this->owners_list,
-            this->num_nonowned_ions_per_pe, req_recv, nstates);
+            this->num_nonowned_ions_per_pe, req_recv, nstates, 111);
 
     /*Pack summed data for owned ions to send to non-owners */
     betaxpsi_pack (sint, send_buff, this->num_owned_pe,
@@ -607,7 +614,7 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
 
     /*Send packed data for owned ions to non-owners */
     betaxpsi_send (send_buff, this->num_owned_pe, this->owned_pe_list,
-            this->num_owned_ions_per_pe, req_send, nstates);
+            this->num_owned_ions_per_pe, req_send, nstates, 111);
 
     /*Wait until all data is received */
     if(this->num_owned_pe)
@@ -643,6 +650,119 @@ template <class KpointType> void Projector<KpointType>::project(Kpoint<KpointTyp
 }
 
 
+// Localized projection with the states split into nchunks pieces. Each chunk has its
+// own sint, send and receive buffers and message tags so the ion ownership exchange
+// for chunk c proceeds while the gemm for chunk c+1 is running.
+    template <class KpointType>
+void Projector<KpointType>::project_pipelined(Kpoint<KpointType> *kptr, KpointType *orbitals, KpointType *p, int offset, int nstates, KpointType
+        *weight, int nchunks)
+{
+    std::vector<int> cstates(nchunks), cofs(nchunks);
+    int base = nstates / nchunks;
+    int rem = nstates % nchunks;
+    for(int c = 0, ofs = 0;c < nchunks;c++)
+    {
+        cstates[c] = base;
+        if(c < rem) cstates[c]++;
+        cofs[c] = ofs;
+        ofs += cstates[c];
+    }
+
+    size_t own_ions = 0;
+    for (int pe = 0; pe < this->num_owned_pe; pe++)
+        own_ions += this->num_owned_ions_per_pe[pe];
+    size_t nown_ions = 0;
+    for (int pe = 0; pe < this->num_owners; pe++)
+        nown_ions += this->num_nonowned_ions_per_pe[pe];
+
+    size_t pstates = (size_t)nstates * (size_t)this->pstride;
+    KpointType *own_buff = new KpointType[own_ions * pstates + 1]();
+    KpointType *nown_buff = new KpointType[nown_ions * pstates + 1]();
+    KpointType *sint = new KpointType[(size_t)this->num_nonloc_ions * pstates]();
+
+    std::vector<MPI_Request> req_own(nchunks * this->num_owned_pe + 1);
+    std::vector<MPI_Request> req_nown(nchunks * this->num_owners + 1);
+    std::vector<MPI_Request> req_own2(nchunks * this->num_owned_pe + 1);
+    std::vector<MPI_Request> req_nown2(nchunks * this->num_owners + 1);
+
+    // Tags for the two stages are kept distinct for each chunk
+    const int tag1 = 1000, tag2 = 1000 + nchunks;
+
+    auto chunk_sint = [&](int c) { return &sint[(size_t)this->num_nonloc_ions * (size_t)cofs[c] * this->pstride]; };
+    auto chunk_own = [&](int c) { return &own_buff[own_ions * (size_t)cofs[c] * this->pstride]; };
+    auto chunk_nown = [&](int c) { return &nown_buff[nown_ions * (size_t)cofs[c] * this->pstride]; };
+
+    /*Post non-blocking receives for data about owned ions for every chunk */
+    for(int c = 0;c < nchunks;c++)
+        betaxpsi_receive (chunk_own(c), this->num_owned_pe, this->owned_pe_list,
+                this->num_owned_ions_per_pe, &req_own[c*this->num_owned_pe], cstates[c], tag1 + c);
+
+    /*Compute each chunk and send contributions for non-owned ions as soon as it is done */
+    for(int c = 0;c < nchunks;c++)
+    {
+        betaxpsi_calculate (kptr, chunk_sint(c), &orbitals[(offset + cofs[c])*kptr->pbasis], cstates[c], weight);
+        betaxpsi_pack (chunk_sint(c), chunk_nown(c), this->num_owners,
+                this->num_nonowned_ions_per_pe, this->list_ions_per_owner, cstates[c]);
+        betaxpsi_send (chunk_nown(c), this->num_owners, this->owners_list,
+                this->num_nonowned_ions_per_pe, &req_nown[c*this->num_owners], cstates[c], tag1 + c);
+
+        // Give the progress engine a chance to move earlier chunks along
+        int flag;
+        if(this->num_owned_pe)
+            MPI_Testall (this->num_owned_pe, &req_own[c*this->num_owned_pe], &flag, MPI_STATUSES_IGNORE);
+    }
+
+    /*Once a chunk's send buffer is free reuse it to receive the summed data from the owners */
+    for(int c = 0;c < nchunks;c++)
+    {
+        if(this->num_owners)
+            MPI_Waitall (this->num_owners, &req_nown[c*this->num_owners], MPI_STATUSES_IGNORE);
+        betaxpsi_receive (chunk_nown(c), this->num_owners, this->owners_list,
+                this->num_nonowned_ions_per_pe, &req_nown2[c*this->num_owners], cstates[c], tag2 + c);
+    }
+
+    /*Sum owned ions chunk by chunk and return the results to the non-owners */
+    for(int c = 0;c < nchunks;c++)
+    {
+        if(this->num_owned_pe)
+            MPI_Waitall (this->num_owned_pe, &req_own[c*this->num_owned_pe], MPI_STATUSES_IGNORE);
+        betaxpsi_sum_owned (chunk_own(c), chunk_sint(c), this->num_owned_pe,
+                this->num_owned_ions_per_pe, this->list_owned_ions_per_pe, cstates[c]);
+        betaxpsi_pack (chunk_sint(c), chunk_own(c), this->num_owned_pe,
+                this->num_owned_ions_per_pe, this->list_owned_ions_per_pe, cstates[c]);
+        betaxpsi_send (chunk_own(c), this->num_owned_pe, this->owned_pe_list,
+                this->num_owned_ions_per_pe, &req_own2[c*this->num_owned_pe], cstates[c], tag2 + c);
+    }
+
+    /*Write received data about non-owned ions into sint and rearrange into p */
+    for(int c = 0;c < nchunks;c++)
+    {
+        if(this->num_owners)
+            MPI_Waitall (this->num_owners, &req_nown2[c*this->num_owners], MPI_STATUSES_IGNORE);
+        betaxpsi_write_non_owned (chunk_sint(c), chunk_nown(c), this->num_owners,
+                this->num_nonowned_ions_per_pe, this->list_ions_per_owner, cstates[c]);
+
+        KpointType *csint = chunk_sint(c);
+        for(int st = 0;st < cstates[c];st++) {
+            size_t idx = (size_t)(cofs[c] + st) * (size_t)this->num_tot_proj;
+            for(int ion = 0;ion < this->num_nonloc_ions;ion++) {
+                for(int ip = 0;ip < this->pstride;ip++) {
+                    p[idx] = csint[ion*cstates[c]*this->pstride + st*this->pstride + ip];
+                    idx++;
+                }
+            }
+        }
+    }
+
+    if(this->num_owned_pe)
+        MPI_Waitall (nchunks*this->num_owned_pe, req_own2.data(), MPI_STATUSES_IGNORE);
+
+    delete [] sint;
+    delete [] nown_buff;
+    delete [] own_buff;
+}
+
+
     template <class KpointType>
 void Projector<KpointType>::betaxpsi_calculate (Kpoint<KpointType> *kptr, KpointType * sint_ptr, KpointType *psi, int num_states, KpointType *weight)
 {
@@ -695,18 +815,16 @@ void Projector<KpointType>::betaxpsi_calculate (Kpoint<KpointType> *kptr, Kpoint
     template <class KpointType>
 void Projector<KpointType>::betaxpsi_receive (KpointType * recv_buff, int num_pes,
         int *pe_list, int *num_ions_per_pe,
-        MPI_Request * req_recv, int num_states)
+        MPI_Request * req_recv, int num_states, int tag)
 {
     KpointType *tpr;
-    int tag, pe, source, size;
+    int pe, source, size;
 
     tpr = recv_buff;
 
     for (pe = 0; pe < num_pes; pe++)
     {
         source = pe_list[pe];
-        /*Tag is sender_rank * pct.grid_npes + receiver_rank */
-        tag = 111;
         size = num_ions_per_pe[pe] * num_states * this->pstride;
         int transfer_size = size;
         if(!ct.is_gamma) transfer_size *= 2;
@@ -718,18 +836,16 @@ void Projector<KpointType>::betaxpsi_receive (KpointType * recv_buff, int num_pe
     template <class KpointType>
 void Projector<KpointType>::betaxpsi_send (KpointType * send_buff, int num_pes,
         int *pe_list, int *num_ions_per_pe,
-        MPI_Request * req_send, int num_states)
+        MPI_Request * req_send, int num_states, int tag)
 {
     KpointType *tpr;
-    int target, num_ions, size, tag, pe;
+    int target, num_ions, size, pe;
 
     tpr = send_buff;
 
     for (pe = 0; pe < num_pes; pe++)
     {
         target = pe_list[pe];
-        /*Tag is sender_rank * pct.grid_npes + receiver_rank */
-        tag = 111;
         num_ions = num_ions_per_pe[pe];
         size = num_ions * num_states * this->pstride;
         int transfer_size = size;
@@ -113,6 +113,7 @@ template <typename OrbitalType> bool Quench (double * vxc, double * vh, double *
             Exx_scf->Vexx(Kptr[0]->vexx, false);
             ct.FOCK = Exx_scf->Exxenergy(Kptr[0]->vexx);
             exxen = ct.FOCK;
+            if(ct.exx_ace) Exx_scf->BuildAce(Kptr[0]->vexx);
         }
     }
 
@@ -189,6 +190,7 @@ template <typename OrbitalType> bool Quench (double * vxc, double * vh, double *
             Exx_scf->Vexx(Kptr[0]->vexx, (fabs(ct.exx_delta) > ct.vexx_fft_threshold));
             // f2 is fock energy calculated using vexx from current orbitals and the current orbitals
             f2 = Exx_scf->Exxenergy(Kptr[0]->vexx);
+            if(ct.exx_ace) Exx_scf->BuildAce(Kptr[0]->vexx);
             ct.exx_delta = f1 - 0.5*(f2 + f0);
             f0 = f2;
             ct.FOCK = exxen + f2 - f1;
@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <complex>
+#include <vector>
+#include <algorithm>
+#include <typeinfo>
 #include "const.h"
 #include "params.h"
 #include "rmgtypedefs.h"
@@ -45,11 +48,20 @@ static void read_int (int fhand, int *ip, int count);
 template void ReadData(char *, double *, double *, double *, Kpoint<double> **);
 template void ReadData(char *, double *, double *, double *, Kpoint<std::complex<double> > **);
 
+template void RandomizeExtraStates(int, Kpoint<double> **);
+template void RandomizeExtraStates(int, Kpoint<std::complex<double> > **);
+
+template void CheckRestartOrbitals(Kpoint<double> *);
+template void CheckRestartOrbitals(Kpoint<std::complex<double> > *);
+
 template void ExtrapolateOrbitals(char *, Kpoint<double> **);
 template void ExtrapolateOrbitals(char *, Kpoint<std::complex<double> > **);
 
 void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz);
 
+template <typename KpointType>
+static void ReadDataRemap (char *name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+
 /* Reads the hartree potential, the wavefunctions, the */
 /* compensating charges and various other things from a file. */
 template <typename KpointType>
@@ -87,8 +99,9 @@ void ReadData (char *name, double * vh, double * rho, double * vxc, Kpoint<Kpoin
 
     int fhand = open(newname, O_RDWR, S_IREAD | S_IWRITE);
     if (fhand < 0) {
-        rmg_printf("Can't open data file %s", newname);
-        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+        // There may be no file for this rank if the restart was written on a different processor grid
+        ReadDataRemap(name, vh, rho, vxc, Kptr);
+        return;
     }
 
 
@@ -104,12 +117,12 @@ void ReadData (char *name, double * vh, double * rho, double * vxc, Kpoint<Kpoin
 
     /* read grid processor topology */
     read_int (fhand, pe, 3);
-    if (pe[0] != Kptr[0]->G->get_PE_X())
-        rmg_error_handler (__FILE__, __LINE__,"Wrong PE_X");
-    if (pe[1] != Kptr[0]->G->get_PE_Y())
-        rmg_error_handler (__FILE__, __LINE__,"Wrong PE_Y");
-    if (pe[2] != Kptr[0]->G->get_PE_Z())
-        rmg_error_handler (__FILE__, __LINE__,"Wrong PE_Z");
+    if ((pe[0] != Kptr[0]->G->get_PE_X()) || (pe[1] != Kptr[0]->G->get_PE_Y()) || (pe[2] != Kptr[0]->G->get_PE_Z()))
+    {
+        close(fhand);
+        ReadDataRemap(name, vh, rho, vxc, Kptr);
+        return;
+    }
 
     grid_size = Kptr[0]->pbasis;
 
@@ -139,7 +152,12 @@ void ReadData (char *name, double * vh, double * rho, double * vxc, Kpoint<Kpoin
 
     read_int (fhand, &nk, 1);
     if (nk != ct.num_kpts_pe && ct.forceflag != BAND_STRUCTURE && ct.forceflag != NSCF)    /* bandstructure calculation */
-        rmg_error_handler (__FILE__, __LINE__,"Wrong number of k points");
+    {
+        // Written with a different number of k-point groups
+        close(fhand);
+        ReadDataRemap(name, vh, rho, vxc, Kptr);
+        return;
+    }
 
     if(ct.verbose) rmg_printf ("read_data: gamma = %d\n", gamma);
     if(ct.verbose) rmg_printf ("read_data: nk = %d\n", ct.num_kpts_pe);
@@ -256,153 +274,410 @@ void ReadData (char *name, double * vh, double * rho, double * vxc, Kpoint<Kpoin
     }
 
     // If we have added unoccupied orbitals initialize them to a random state
-    if(ct.num_states > ns) {
+    RandomizeExtraStates(ns, Kptr);
 
-        if(ct.noncoll) 
-        {
-            printf("\n num_state %d != read %d\n", ct.num_states, ns);
-            rmg_error_handler (__FILE__, __LINE__,"noncollinear case: ct.num_state differenecec.");
-        }
-        for (ik = 0; ik < ct.num_kpts_pe; ik++){
 
-            int PX0_GRID = Kptr[0]->G->get_PX0_GRID(1);
-            int PY0_GRID = Kptr[0]->G->get_PY0_GRID(1);
-            int PZ0_GRID = Kptr[0]->G->get_PZ0_GRID(1);
+    if(ct.forceflag == BAND_STRUCTURE) return;
+    /* read state occupations */
+    {
+        double *occ = new double[nk * ct.num_states]();
 
-            int pbasis = PX0_GRID * PY0_GRID * PZ0_GRID;
-            double *tmp_psiR = new double[pbasis];
-            double *tmp_psiI = new double[pbasis];
+        read_double (fhand, occ, (nk * ns));
 
-            double *xrand = new double[2 * Kptr[0]->G->get_NX_GRID(1)];
-            double *yrand = new double[2 * Kptr[0]->G->get_NY_GRID(1)];
-            double *zrand = new double[2 * Kptr[0]->G->get_NZ_GRID(1)];
+        if(ct.verbose) rmg_printf ("read_data: read 'occupations'\n"); 
 
-            int factor = 2;
-            if(ct.is_gamma) factor = 1;
+        for (ik = 0; ik < nk; ik++)
+            for (is = 0; is < ns; is++)
+            {
+                Kptr[ik]->Kstates[is].occupation[0] = occ[ik * ns + is];
+            }
 
-            long int idum = 7493;
-            int xoff = Kptr[0]->G->get_PX_OFFSET(1);
-            int yoff = Kptr[0]->G->get_PY_OFFSET(1);
-            int zoff = Kptr[0]->G->get_PZ_OFFSET(1);
 
-            /* Initialize the random number generator */
-            rand0 (&idum);
+        delete [] occ;
+    }           /* end of read occupations */
+
 
-            for (int state = ns; state < ct.num_states; state++)
+
+
+    /* read state eigenvalues, needed for STM calc */
+    if (ct.forceflag != BAND_STRUCTURE && ct.forceflag != NSCF)
+    {
+
+        /* Read eigenvalue in pairwised case, while in polarized case, 
+         * it's the eigenvalue for proceesor's own spin  */ 
+        for (ik = 0; ik < nk; ik++)
+            for (is = 0; is < ns; is++)
             {
+                read_double (fhand, &Kptr[ik]->Kstates[is].eig[0], 1);
+            }
 
+        if(ct.verbose) rmg_printf ("read_data: read 'eigenvalues'\n");
 
-                /* Generate x, y, z random number sequences */
-                for (int idx = 0; idx < factor*Kptr[0]->G->get_NX_GRID(1); idx++)
-                    xrand[idx] = rand0 (&idum) - 0.5;
-                for (int idx = 0; idx < factor*Kptr[0]->G->get_NY_GRID(1); idx++)
-                    yrand[idx] = rand0 (&idum) - 0.5;
-                for (int idx = 0; idx < factor*Kptr[0]->G->get_NZ_GRID(1); idx++)
-                    zrand[idx] = rand0 (&idum) - 0.5;
+    }      /* end of read eigenvalues */
 
+    close (fhand);
 
-                int idx = 0;
-                for (int ix = 0; ix < PX0_GRID; ix++)
-                {
+}                               /* end read_data */
 
-                    for (int iy = 0; iy < PY0_GRID; iy++)
-                    {
 
-                        for (int iz = 0; iz < PZ0_GRID; iz++)
-                        {
+// Copies the part of a block of the global grid with dimensions sdim at offset soff
+// that overlaps the block with dimensions ddim at offset doff. Points have scomp
+// doubles in the source and dcomp >= scomp doubles in the destination, the extra
+// components are zeroed.
+static void copy_overlap(double *src, int *sdim, int *soff, int scomp, double *dst, int *ddim, int *doff, int dcomp)
+{
+    int lo[3], hi[3];
+    for(int i = 0;i < 3;i++)
+    {
+        lo[i] = std::max(soff[i], doff[i]);
+        hi[i] = std::min(soff[i] + sdim[i], doff[i] + ddim[i]);
+        if(hi[i] <= lo[i]) return;
+    }
 
+    for(int ix = lo[0];ix < hi[0];ix++)
+    {
+        for(int iy = lo[1];iy < hi[1];iy++)
+        {
+            size_t sidx = ((size_t)(ix - soff[0]) * sdim[1] + (iy - soff[1])) * sdim[2] + (lo[2] - soff[2]);
+            size_t didx = ((size_t)(ix - doff[0]) * ddim[1] + (iy - doff[1])) * ddim[2] + (lo[2] - doff[2]);
+            for(int iz = lo[2];iz < hi[2];iz++)
+            {
+                for(int c = 0;c < scomp;c++) dst[didx*dcomp + c] = src[sidx*scomp + c];
+                for(int c = scomp;c < dcomp;c++) dst[didx*dcomp + c] = 0.0;
+                sidx++;
+                didx++;
+            }
+        }
+    }
+}
+
+
+// Reads a restart written on a different processor grid or with a different number
+// of k-point groups. The layout of the old run is recovered from the file headers.
+// Files are named after the first k-point of the group that wrote them so the file
+// holding a given k-point is found by searching downward from it. Each rank then
+// opens only the files of the old ranks whose subdomains overlap its own and copies
+// the overlapping parts of the potentials and orbitals. Files are read sequentially
+// since compressed records can not be skipped without decoding them.
+template <typename KpointType>
+static void ReadDataRemap (char *name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    BaseGrid *G = Kptr[0]->G;
+    int ratio = G->default_FG_RATIO;
+    int nc = ct.noncoll_factor;
+    int run_comp = ct.is_gamma ? 1 : 2;
+    int NX = G->get_NX_GRID(1), NY = G->get_NY_GRID(1), NZ = G->get_NZ_GRID(1);
+    int pdim[3] = {G->get_PX0_GRID(1), G->get_PY0_GRID(1), G->get_PZ0_GRID(1)};
+    int poff[3] = {G->get_PX_OFFSET(1), G->get_PY_OFFSET(1), G->get_PZ_OFFSET(1)};
+    int fpdim[3] = {G->get_PX0_GRID(ratio), G->get_PY0_GRID(ratio), G->get_PZ0_GRID(ratio)};
+    int fpoff[3] = {G->get_PX_OFFSET(ratio), G->get_PY_OFFSET(ratio), G->get_PZ_OFFSET(ratio)};
+    size_t pbasis = (size_t)pdim[0] * pdim[1] * pdim[2];
+    size_t fpbasis = (size_t)fpdim[0] * fpdim[1] * fpdim[2];
+    char newname[MAX_PATH + 200];
+    int hdr[12];    // grid[3], pe[3], fine[3], gamma, nk, ns
 
-                            tmp_psiR[idx] = xrand[xoff + ix] * 
-                                yrand[yoff + iy] * 
-                                zrand[zoff + iz];
-                            tmp_psiR[idx] = tmp_psiR[idx] * tmp_psiR[idx];
+    int kstart = pct.kstart;
+    int nkread = ct.num_kpts_pe;
+    if (ct.forceflag == BAND_STRUCTURE || ct.forceflag == NSCF)
+    {
+        kstart = 0;
+        nkread = 1;
+    }
 
+    // Locate the file and the position within it of each local k-point
+    std::vector<int> kfile(nkread, -1), kindex(nkread, 0);
+    for(int ik = 0;ik < nkread;ik++)
+    {
+        int kt = kstart + ik;
+        for(int s = kt;s >= 0;s--)
+        {
+            sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, s, 0);
+            int fh = open(newname, O_RDONLY);
+            if(fh < 0) continue;
+            read_int (fh, hdr, 12);
+            close(fh);
+            // Groups hold consecutive k-points so no earlier file can contain kt
+            if(s + hdr[10] <= kt) break;
+            kfile[ik] = s;
+            kindex[ik] = kt - s;
+            break;
+        }
+        if(kfile[ik] < 0)
+        {
+            rmg_printf("No restart file %s_spin%d_* contains k-point %d", name, pct.spinpe, kt);
+            rmg_error_handler (__FILE__, __LINE__, "Terminating.");
+        }
+    }
 
-                            if(!ct.is_gamma) {
+    sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, kfile[0], 0);
+    int fh = open(newname, O_RDONLY);
+    read_int (fh, hdr, 12);
+    close(fh);
+    int *pe = &hdr[3];
+    int gamma = hdr[9];
+    int ns = hdr[11];
+    if ((hdr[0] != NX) || (hdr[1] != NY) || (hdr[2] != NZ))
+        rmg_error_handler (__FILE__, __LINE__,"Wrong wavefunction grid in restart file");
+    if ((hdr[6] != ratio) || (hdr[7] != ratio) || (hdr[8] != ratio))
+        rmg_error_handler (__FILE__, __LINE__,"Wrong fine grid info");
+    if (gamma < ct.is_gamma)
+        rmg_error_handler (__FILE__, __LINE__,"Can't convert complex wavefunctions to real.");
+    if (ns > ct.num_states) {
+        rmg_printf ("Wrong number of states: read %d from wave file, but ct.num_states is %d",ns, ct.num_states);
+        rmg_error_handler (__FILE__, __LINE__,"Terminating.");
+    }
 
-                                tmp_psiI[idx] = xrand[Kptr[0]->G->get_NX_GRID(1) + xoff + ix] * 
-                                    yrand[Kptr[0]->G->get_NY_GRID(1) + yoff + iy] * 
-                                    zrand[Kptr[0]->G->get_NZ_GRID(1) + zoff + iz];
-                                tmp_psiI[idx] = tmp_psiI[idx] * tmp_psiI[idx];
+    rmg_printf ("read_data: restart written on a %d %d %d processor grid, redistributing\n", pe[0], pe[1], pe[2]);
 
-                            }
+    std::vector<int> files(kfile);
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
 
-                            idx++;
+    BaseGrid OG(NX, NY, NZ, pe[0], pe[1], pe[2], 0, ratio);
+    int file_comp = gamma ? 1 : 2;
+    std::vector<double> fbuf, sbuf, rbuf, ibuf, vals;
 
-                        }               /* end for */
-                    }                   /* end for */
-                }                       /* end for */
+    for(int rank = 0;rank < pe[0]*pe[1]*pe[2];rank++)
+    {
+        int odim[3], ooff[3], fodim[3], fooff[3];
+        OG.find_node_sizes(rank, NX, NY, NZ, &odim[0], &odim[1], &odim[2]);
+        OG.find_node_offsets(rank, NX, NY, NZ, &ooff[0], &ooff[1], &ooff[2]);
+        OG.find_node_sizes(rank, NX*ratio, NY*ratio, NZ*ratio, &fodim[0], &fodim[1], &fodim[2]);
+        OG.find_node_offsets(rank, NX*ratio, NY*ratio, NZ*ratio, &fooff[0], &fooff[1], &fooff[2]);
+
+        bool overlap = true;
+        for(int i = 0;i < 3;i++)
+            overlap = overlap && (ooff[i] < poff[i] + pdim[i]) && (poff[i] < ooff[i] + odim[i]);
+        if(!overlap) continue;
+
+        size_t obasis = (size_t)odim[0] * odim[1] * odim[2];
+        size_t fobasis = (size_t)fodim[0] * fodim[1] * fodim[2];
+        fbuf.resize(fobasis);
+        sbuf.resize(file_comp * nc * obasis);
+        rbuf.resize(obasis);
+        ibuf.resize(obasis);
+
+        for(size_t f = 0;f < files.size();f++)
+        {
+            sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, files[f], rank);
+            int fhand = open(newname, O_RDONLY);
+            if (fhand < 0) {
+                rmg_printf("Can't open data file %s", newname);
+                rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+            }
+            read_int (fhand, hdr, 12);
+            int nk = hdr[10];
 
-                // Copy data from tmp_psi into orbital storage
-                for(idx = 0;idx < pbasis;idx++) {
-                    Kptr[ik]->Kstates[state].psi[idx] = tmp_psiR[idx];
+            /* the potentials are the same in every file of a spin so they are taken from the first */
+            double *pots[3] = {vh, rho, vxc};
+            int npots[3] = {1, nc*nc, nc*nc};
+            for(int ip = 0;ip < 3;ip++)
+            {
+                for(int ic = 0;ic < npots[ip];ic++)
+                {
+                    if(f > 0 && !ct.compressed_infile)
+                    {
+                        lseek(fhand, sizeof(double) * fobasis, SEEK_CUR);
+                        continue;
+                    }
+                    if(ct.compressed_infile)
+                        read_compressed_buffer(fhand, fbuf.data(), fodim[0], fodim[1], fodim[2]);
+                    else
+                        read_double (fhand, fbuf.data(), fobasis);
+                    if(f == 0)
+                        copy_overlap(fbuf.data(), fodim, fooff, 1, &pots[ip][ic*fpbasis], fpdim, fpoff, 1);
                 }
-                if(typeid(KpointType) == typeid(std::complex<double>)) {
-                    for(idx = 0;idx < pbasis;idx++) {
-                        double *a = (double *)&Kptr[ik]->Kstates[state].psi[idx];
-                        if(!ct.is_gamma)
-                            a[1] = tmp_psiI[idx];
+            }
+
+            if(ct.forceflag == NSCF)
+            {
+                close(fhand);
+                continue;
+            }
+
+            /* read wavefunctions */
+            for(int iko = 0;iko < nk;iko++)
+            {
+                int ik = -1;
+                for(int jk = 0;jk < nkread;jk++)
+                    if((kfile[jk] == files[f]) && (kindex[jk] == iko)) ik = jk;
 
+                for(int is = 0;is < ns;is++)
+                {
+                    if(!ct.compressed_infile)
+                    {
+                        if(ik < 0)
+                        {
+                            lseek(fhand, sizeof(double) * sbuf.size(), SEEK_CUR);
+                            continue;
+                        }
+                        read_double (fhand, sbuf.data(), sbuf.size());
+                    }
+                    else if(gamma)
+                    {
+                        read_compressed_buffer(fhand, sbuf.data(), odim[0], odim[1], odim[2]);
+                    }
+                    else
+                    {
+                        for(int ic = 0;ic < nc;ic++)
+                        {
+                            read_compressed_buffer(fhand, rbuf.data(), odim[0], odim[1], odim[2]);
+                            read_compressed_buffer(fhand, ibuf.data(), odim[0], odim[1], odim[2]);
+                            double *sptr = &sbuf[2*ic*obasis];
+                            for(size_t idx = 0;idx < obasis;idx++)
+                            {
+                                sptr[2*idx] = rbuf[idx];
+                                sptr[2*idx + 1] = ibuf[idx];
+                            }
+                        }
                     }
+                    if(ik < 0) continue;
 
+                    for(int ic = 0;ic < nc;ic++)
+                    {
+                        double *dptr = (double *)&Kptr[ik]->Kstates[is].psi[ic * pbasis];
+                        copy_overlap(&sbuf[file_comp*ic*obasis], odim, ooff, file_comp, dptr, pdim, poff, run_comp);
+                    }
                 }
+            }
 
-                // Hit the orbital with the right hand mehrstellen operator which should smooth it a bit
-                //        CPP_app_cir_driver (this->L, this->T, this->Kstates[state].psi, this->Kstates[state].psi, PX0_GRID, PY0_GRID, PZ0_GRID, APP_CI_FOURTH);
-
-            }                           /* end for */
+            /* read state occupations and eigenvalues */
+            if(ct.forceflag != BAND_STRUCTURE)
+            {
+                vals.resize(2 * nk * ns);
+                read_double (fhand, vals.data(), 2 * nk * ns);
+                for(int ik = 0;ik < nkread;ik++)
+                {
+                    if(kfile[ik] != files[f]) continue;
+                    for (int is = 0; is < ns; is++)
+                    {
+                        Kptr[ik]->Kstates[is].occupation[0] = vals[kindex[ik] * ns + is];
+                        Kptr[ik]->Kstates[is].eig[0] = vals[nk * ns + kindex[ik] * ns + is];
+                    }
+                }
+            }
 
-            delete [] zrand;
-            delete [] yrand;
-            delete [] xrand;
-            delete [] tmp_psiI;
-            delete [] tmp_psiR;
-        }                           /* end for */
-        if(ct.forceflag == BAND_STRUCTURE) return;
+            close(fhand);
+        }
     }
 
+    if(ct.forceflag == NSCF) return;
 
-    if(ct.forceflag == BAND_STRUCTURE) return;
-    /* read state occupations */
+    if(ct.verbose) rmg_printf ("read_data: read 'wfns'\n");
+
+    // If we have added unoccupied orbitals initialize them to a random state
+    RandomizeExtraStates(ns, Kptr);
+}
+
+
+// Initializes states ns through ct.num_states-1 to random functions. Used when a restart
+// was written with fewer states than the current run.
+template <typename KpointType>
+void RandomizeExtraStates (int ns, Kpoint<KpointType> ** Kptr)
+{
+    if(ct.num_states <= ns) return;
+
+    if(ct.noncoll) 
     {
-        double *occ = new double[nk * ct.num_states]();
+        printf("\n num_state %d != read %d\n", ct.num_states, ns);
+        rmg_error_handler (__FILE__, __LINE__,"noncollinear case: ct.num_state differenecec.");
+    }
+    for (int ik = 0; ik < ct.num_kpts_pe; ik++){
 
-        read_double (fhand, occ, (nk * ns));
+        int PX0_GRID = Kptr[0]->G->get_PX0_GRID(1);
+        int PY0_GRID = Kptr[0]->G->get_PY0_GRID(1);
+        int PZ0_GRID = Kptr[0]->G->get_PZ0_GRID(1);
 
-        if(ct.verbose) rmg_printf ("read_data: read 'occupations'\n"); 
+        int pbasis = PX0_GRID * PY0_GRID * PZ0_GRID;
+        double *tmp_psiR = new double[pbasis];
+        double *tmp_psiI = new double[pbasis];
 
-        for (ik = 0; ik < nk; ik++)
-            for (is = 0; is < ns; is++)
-            {
-                Kptr[ik]->Kstates[is].occupation[0] = occ[ik * ns + is];
-            }
+        double *xrand = new double[2 * Kptr[0]->G->get_NX_GRID(1)];
+        double *yrand = new double[2 * Kptr[0]->G->get_NY_GRID(1)];
+        double *zrand = new double[2 * Kptr[0]->G->get_NZ_GRID(1)];
 
+        int factor = 2;
+        if(ct.is_gamma) factor = 1;
 
-        delete [] occ;
-    }           /* end of read occupations */
+        long int idum = 7493;
+        int xoff = Kptr[0]->G->get_PX_OFFSET(1);
+        int yoff = Kptr[0]->G->get_PY_OFFSET(1);
+        int zoff = Kptr[0]->G->get_PZ_OFFSET(1);
 
+        /* Initialize the random number generator */
+        rand0 (&idum);
 
+        for (int state = ns; state < ct.num_states; state++)
+        {
 
 
-    /* read state eigenvalues, needed for STM calc */
-    if (ct.forceflag != BAND_STRUCTURE && ct.forceflag != NSCF)
-    {
+            /* Generate x, y, z random number sequences */
+            for (int idx = 0; idx < factor*Kptr[0]->G->get_NX_GRID(1); idx++)
+                xrand[idx] = rand0 (&idum) - 0.5;
+            for (int idx = 0; idx < factor*Kptr[0]->G->get_NY_GRID(1); idx++)
+                yrand[idx] = rand0 (&idum) - 0.5;
+            for (int idx = 0; idx < factor*Kptr[0]->G->get_NZ_GRID(1); idx++)
+                zrand[idx] = rand0 (&idum) - 0.5;
 
-        /* Read eigenvalue in pairwised case, while in polarized case, 
-         * it's the eigenvalue for proceesor's own spin  */ 
-        for (ik = 0; ik < nk; ik++)
-            for (is = 0; is < ns; is++)
+
+            int idx = 0;
+            for (int ix = 0; ix < PX0_GRID; ix++)
             {
-                read_double (fhand, &Kptr[ik]->Kstates[is].eig[0], 1);
+
+                for (int iy = 0; iy < PY0_GRID; iy++)
+                {
+
+                    for (int iz = 0; iz < PZ0_GRID; iz++)
+                    {
+
+
+                        tmp_psiR[idx] = xrand[xoff + ix] * 
+                            yrand[yoff + iy] * 
+                            zrand[zoff + iz];
+                        tmp_psiR[idx] = tmp_psiR[idx] * tmp_psiR[idx];
+
+
+                        if(!ct.is_gamma) {
+
+                            tmp_psiI[idx] = xrand[Kptr[0]->G->get_NX_GRID(1) + xoff + ix] * 
+                                yrand[Kptr[0]->G->get_NY_GRID(1) + yoff + iy] * 
+                                zrand[Kptr[0]->G->get_NZ_GRID(1) + zoff + iz];
+                            tmp_psiI[idx] = tmp_psiI[idx] * tmp_psiI[idx];
+
+                        }
+
+                        idx++;
+
+                    }               /* end for */
+                }                   /* end for */
+            }                       /* end for */
+
+            // Copy data from tmp_psi into orbital storage
+            for(idx = 0;idx < pbasis;idx++) {
+                Kptr[ik]->Kstates[state].psi[idx] = tmp_psiR[idx];
             }
+            if(typeid(KpointType) == typeid(std::complex<double>)) {
+                for(idx = 0;idx < pbasis;idx++) {
+                    double *a = (double *)&Kptr[ik]->Kstates[state].psi[idx];
+                    if(!ct.is_gamma)
+                        a[1] = tmp_psiI[idx];
 
-        if(ct.verbose) rmg_printf ("read_data: read 'eigenvalues'\n");
+                }
 
-    }      /* end of read eigenvalues */
+            }
 
-    close (fhand);
+            // Hit the orbital with the right hand mehrstellen operator which should smooth it a bit
+            //        CPP_app_cir_driver (this->L, this->T, this->Kstates[state].psi, this->Kstates[state].psi, PX0_GRID, PY0_GRID, PZ0_GRID, APP_CI_FOURTH);
 
-}                               /* end read_data */
+        }                           /* end for */
+
+        delete [] zrand;
+        delete [] yrand;
+        delete [] xrand;
+        delete [] tmp_psiI;
+        delete [] tmp_psiR;
+    }                           /* end for */
+}
 
 
 static void read_double (int fhand, double * rp, int count)
@@ -427,6 +702,51 @@ static void read_int (int fhand, int *ip, int count)
 
 
 
+// Orbitals read from a compressed restart file carry the ZFP error and are no longer
+// exactly orthonormal. With norm conserving pseudopotentials the deviation of the
+// overlap matrix from the identity is reported before orthonormality is restored.
+// With ultrasoft pseudopotentials the overlap involves the S operator, which the plain
+// inner product below does not include, so nothing is reported and the orbitals are
+// only orthogonalized. That uses the projections in newsint_local, which the caller
+// must have generated for the current orbitals.
+template <typename KpointType>
+void CheckRestartOrbitals (Kpoint<KpointType> *kptr)
+{
+    if(!ct.norm_conserving_pp)
+    {
+        kptr->orthogonalize(kptr->orbital_storage);
+        return;
+    }
+
+    int nstates = kptr->nstates;
+    int pbasis = kptr->pbasis * ct.noncoll_factor;
+    double vel = kptr->L->get_omega() / (double)kptr->G->get_GLOBAL_BASIS(1);
+    KpointType alpha(vel), beta(0.0);
+    char *trans = (typeid(KpointType) == typeid(double)) ? (char *)"t" : (char *)"c";
+
+    std::vector<KpointType> smat((size_t)nstates * nstates);
+    RmgGemm(trans, (char *)"n", nstates, nstates, pbasis, alpha, kptr->orbital_storage, pbasis,
+            kptr->orbital_storage, pbasis, beta, smat.data(), nstates);
+    int length = nstates * nstates * sizeof(KpointType) / sizeof(double);
+    MPI_Allreduce(MPI_IN_PLACE, (double *)smat.data(), length, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+
+    double norm_err = 0.0, ovl_err = 0.0;
+    for(int i = 0;i < nstates;i++)
+    {
+        for(int j = 0;j < nstates;j++)
+        {
+            if(i == j)
+                norm_err = std::max(norm_err, std::abs(smat[i * nstates + j] - 1.0));
+            else
+                ovl_err = std::max(ovl_err, std::abs(smat[i * nstates + j]));
+        }
+    }
+    rmg_printf ("read_data: restart orbital norm error = %.3e  overlap error = %.3e\n", norm_err, ovl_err);
+
+    kptr->orthogonalize(kptr->orbital_storage);
+}
+
+
 void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
 {
 
@@ -439,6 +759,16 @@ void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     if(wsize != sizeof(csize))
         rmg_error_handler (__FILE__,__LINE__,"error reading");
 
+    // Orbital buffers store the tolerance used to compress them
+    double tol = RESTART_TOLERANCE;
+    if(csize & RESTART_TOLERANCE_FLAG)
+    {
+        csize &= ~RESTART_TOLERANCE_FLAG;
+        wsize = read (fh, &tol, sizeof(tol));
+        if(wsize != sizeof(tol))
+            rmg_error_handler (__FILE__,__LINE__,"error reading");
+    }
+
     if(csize > sizeof(double)*nx*ny*nz)
         rmg_error_handler (__FILE__,__LINE__,"error reading input buffer too small");
 
@@ -446,7 +776,7 @@ void read_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     if(wsize != csize)
         rmg_error_handler (__FILE__,__LINE__,"error reading");
 
-    csize = C.decompress_buffer(array, in, nx, ny, nz, RESTART_TOLERANCE, 2*nx*ny*nz*sizeof(double));
+    csize = C.decompress_buffer(array, in, nx, ny, nz, tol, 2*nx*ny*nz*sizeof(double));
     delete [] in;
 
 }
@@ -467,6 +797,10 @@ void ExtrapolateOrbitals (char *name, Kpoint<KpointType> ** Kptr)
     int nk;
     int ns;
 
+    // The previous step is read from the _1 files which a background restart write
+    // only renames into place once it completes.
+    WaitRestartWrite();
+
     pgrid[0] = Kptr[0]->G->get_PX0_GRID(1);
     pgrid[1] = Kptr[0]->G->get_PY0_GRID(1);
     pgrid[2] = Kptr[0]->G->get_PZ0_GRID(1);
@@ -0,0 +1,203 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex>
+#include <string>
+#include <vector>
+#include "hdf5.h"
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "RmgException.h"
+#include "State.h"
+#include "Kpoint.h"
+#include "transition.h"
+
+
+/*
+
+  Reads a restart file written by WriteHdf5Data. Each rank selects the block of every
+  object that belongs to its part of the grid so the processor grid and the number of
+  k-point groups may differ from those of the run that wrote the file.
+
+*/
+
+template void ReadHdf5Data (std::string&, double *, double *, double *, Kpoint<double> **);
+template void ReadHdf5Data (std::string&, double *, double *, double *, Kpoint<std::complex<double> > **);
+
+static void read_attr(hid_t loc, const char *name, int *vals)
+{
+    hid_t attr = H5Aopen(loc, name, H5P_DEFAULT);
+    if((attr < 0) || (H5Aread(attr, H5T_NATIVE_INT, vals) < 0))
+        throw RmgFatalException() << "Error reading attribute " << name << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    H5Aclose(attr);
+}
+
+static void read_block(hid_t file, const char *name, int rank, hsize_t *offset, hsize_t *count, void *buf)
+{
+    hid_t dset = H5Dopen2(file, name, H5P_DEFAULT);
+    if(dset < 0)
+        throw RmgFatalException() << "Dataset " << name << " not found in " << __FILE__ << " at line " << __LINE__ << "\n";
+    hid_t fspace = H5Dget_space(dset);
+    hid_t mspace = H5Screate_simple(rank, count, NULL);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+    if(H5Dread(dset, H5T_NATIVE_DOUBLE, mspace, fspace, H5P_DEFAULT, buf) < 0)
+        throw RmgFatalException() << "Error reading dataset " << name << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    H5Dclose(dset);
+}
+
+
+template <typename KpointType>
+void ReadHdf5Data (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    BaseGrid *G = Kptr[0]->G;
+    int ratio = G->default_FG_RATIO;
+    int pbasis = G->get_P0_BASIS(1);
+    int nc = ct.noncoll_factor;
+    int grid[3], fgrid[3], gamma, ns, nspin, fnc, nkpts;
+    char dname[MAX_PATH];
+
+    std::string fname = name + ".h5";
+
+    MPI_Barrier(pct.img_comm);
+
+#ifdef H5_HAVE_PARALLEL
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(fapl, pct.img_comm, MPI_INFO_NULL);
+    hid_t file = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, fapl);
+    H5Pclose(fapl);
+#else
+    hid_t file = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+#endif
+    if(file < 0)
+        throw RmgFatalException() << "Unable to open restart file " << fname << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+
+    read_attr(file, "grid", grid);
+    read_attr(file, "fine_grid", fgrid);
+    read_attr(file, "gamma", &gamma);
+    read_attr(file, "num_states", &ns);
+    read_attr(file, "nspin", &nspin);
+    read_attr(file, "noncoll_factor", &fnc);
+    read_attr(file, "num_kpts", &nkpts);
+
+    if((grid[0] != G->get_NX_GRID(1)) || (grid[1] != G->get_NY_GRID(1)) || (grid[2] != G->get_NZ_GRID(1)))
+        rmg_error_handler (__FILE__, __LINE__,"Wrong wavefunction grid in restart file");
+    if((fgrid[0] != G->get_NX_GRID(ratio)) || (fgrid[1] != G->get_NY_GRID(ratio)) || (fgrid[2] != G->get_NZ_GRID(ratio)))
+        rmg_error_handler (__FILE__, __LINE__,"Wrong fine grid in restart file");
+    if(nspin != ct.nspin)
+        rmg_error_handler (__FILE__, __LINE__,"Wrong number of spins in restart file");
+    if(fnc != nc)
+        rmg_error_handler (__FILE__, __LINE__,"Wrong noncollinear setting in restart file");
+    if(gamma < ct.is_gamma)
+        rmg_error_handler (__FILE__, __LINE__,"Can't convert complex wavefunctions to real.");
+    if (ns > ct.num_states) {
+        rmg_printf ("Wrong number of states: read %d from restart file, but ct.num_states is %d",ns, ct.num_states);
+        rmg_error_handler (__FILE__, __LINE__,"Terminating.");
+    }
+
+    int kstart = pct.kstart;
+    if (ct.forceflag == BAND_STRUCTURE || ct.forceflag == NSCF) kstart = 0;
+    if ((kstart + ct.num_kpts_pe > nkpts) && ct.forceflag != BAND_STRUCTURE && ct.forceflag != NSCF)
+        rmg_error_handler (__FILE__, __LINE__,"Wrong number of k points");
+
+    if(ct.verbose) rmg_printf ("read_hdf5_data: psi grid = %d %d %d\n", grid[0], grid[1], grid[2]);
+    if(ct.verbose) rmg_printf ("read_hdf5_data: gamma = %d  ns = %d  nkpts = %d\n", gamma, ns, nkpts);
+
+    /* read the hartree potential, electronic density and xc potential */
+    hsize_t foff[4] = {0, (hsize_t)G->get_PX_OFFSET(ratio), (hsize_t)G->get_PY_OFFSET(ratio), (hsize_t)G->get_PZ_OFFSET(ratio)};
+    hsize_t fcnt[4] = {1, (hsize_t)G->get_PX0_GRID(ratio), (hsize_t)G->get_PY0_GRID(ratio), (hsize_t)G->get_PZ0_GRID(ratio)};
+    snprintf(dname, sizeof(dname), "spin%d/vh", pct.spinpe);
+    read_block(file, dname, 4, foff, fcnt, vh);
+    fcnt[0] = nc*nc;
+    snprintf(dname, sizeof(dname), "spin%d/rho", pct.spinpe);
+    read_block(file, dname, 4, foff, fcnt, rho);
+    snprintf(dname, sizeof(dname), "spin%d/vxc", pct.spinpe);
+    read_block(file, dname, 4, foff, fcnt, vxc);
+
+    if(ct.forceflag == NSCF)
+    {
+        H5Fclose(file);
+        return;
+    }
+
+    /* read wavefunctions */
+    int ncomp = gamma ? 1 : 2;
+    hsize_t poff[6] = {0, 0, (hsize_t)G->get_PX_OFFSET(1), (hsize_t)G->get_PY_OFFSET(1), (hsize_t)G->get_PZ_OFFSET(1), 0};
+    hsize_t pcnt[6] = {(hsize_t)ns, (hsize_t)nc, (hsize_t)G->get_PX0_GRID(1), (hsize_t)G->get_PY0_GRID(1), (hsize_t)G->get_PZ0_GRID(1), (hsize_t)ncomp};
+    std::vector<double> tbuf;
+    if(gamma != ct.is_gamma) tbuf.resize((size_t)ns * nc * pbasis);
+
+    for (int ik = 0; ik < ct.num_kpts_pe; ik++)
+    {
+        snprintf(dname, sizeof(dname), "spin%d/kpt%d/psi", pct.spinpe, kstart + ik);
+        if(gamma == ct.is_gamma)
+        {
+            read_block(file, dname, 6, poff, pcnt, Kptr[ik]->Kstates[0].psi);
+        }
+        else
+        {
+            // Wavefunctions on disk are real but current calc is complex so convert them
+            read_block(file, dname, 6, poff, pcnt, tbuf.data());
+            std::complex<double> *tptr = (std::complex<double> *)Kptr[ik]->Kstates[0].psi;
+            for(size_t idx = 0;idx < tbuf.size();idx++) tptr[idx] = std::complex<double>(tbuf[idx], 0.0);
+        }
+
+        // for band structure calculation, just read wave functions for first kpoints
+        if(ct.forceflag == BAND_STRUCTURE) break;
+    }
+
+    if(ct.verbose) rmg_printf ("read_hdf5_data: read 'wfns'\n");
+
+    // If we have added unoccupied orbitals initialize them to a random state
+    RandomizeExtraStates(ns, Kptr);
+
+    if(ct.forceflag == BAND_STRUCTURE)
+    {
+        H5Fclose(file);
+        return;
+    }
+
+    /* read state occupations and eigenvalues */
+    hsize_t soff = 0, scnt = ns;
+    std::vector<double> occ(ns), eig(ns);
+    for (int ik = 0; ik < ct.num_kpts_pe; ik++)
+    {
+        snprintf(dname, sizeof(dname), "spin%d/kpt%d/occupations", pct.spinpe, kstart + ik);
+        read_block(file, dname, 1, &soff, &scnt, occ.data());
+        snprintf(dname, sizeof(dname), "spin%d/kpt%d/eigenvalues", pct.spinpe, kstart + ik);
+        read_block(file, dname, 1, &soff, &scnt, eig.data());
+        for (int is = 0; is < ns; is++)
+        {
+            Kptr[ik]->Kstates[is].occupation[0] = occ[is];
+            Kptr[ik]->Kstates[is].eig[0] = eig[is];
+        }
+    }
+
+    H5Fclose(file);
+
+}
@@ -29,6 +29,9 @@
 #include "ErrorFuncs.h"
 #include "GpuAlloc.h"
 #include "transition.h"
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
 template void ReinitIonicPotentials<double>(Kpoint<double> **, double *, double *, double *);
 template void ReinitIonicPotentials<std::complex<double> >(Kpoint<std::complex<double>> **, double *, double *, double *);
@@ -40,12 +43,54 @@ void ReinitIonicPotentials (Kpoint<KpointType> **Kptr, double * vnuc, double * r
     RmgTimer RT0("3-ReinitIonicPotentials");
     int FP0_BASIS = Rmg_G->get_P0_BASIS(Rmg_G->default_FG_RATIO);
 
+    // When incremental updates are enabled only ions that have moved by more than
+    // ct.incremental_reinit_threshold, or whose fine grid cell has changed so that the
+    // set of grid points inside their spheres is different, since their contributions
+    // were last generated are recomputed. Everything is regenerated on the first call
+    // and whenever the lattice has changed, as in variable cell relaxations.
+    static bool reinit_initialized = false;
+    static double reinit_lattice[9];
+    double lattice[9];
+    for(int i = 0;i < 3;i++)
+    {
+        lattice[i] = Rmg_L.a0[i];
+        lattice[i+3] = Rmg_L.a1[i];
+        lattice[i+6] = Rmg_L.a2[i];
+    }
+    bool lattice_changed = !std::equal(lattice, lattice + 9, reinit_lattice);
+    bool incremental = (ct.incremental_reinit_threshold > 0.0) && reinit_initialized && !lattice_changed;
+
+    double h[3] = {get_hxxgrid(), get_hyygrid(), get_hzzgrid()};
+    std::vector<int> moved;
+    std::vector<bool> unmoved(ct.num_ions, false);
+    for (int ion = 0; ion < ct.num_ions; ion++)
+    {
+        ION *iptr = &Atoms[ion];
+        double dx[3];
+        bool crossed = false;
+        for(int i = 0;i < 3;i++)
+        {
+            dx[i] = iptr->xtal[i] - iptr->reinit_xtal[i];
+            crossed = crossed || (std::floor(iptr->xtal[i] / h[i]) != std::floor(iptr->reinit_xtal[i] / h[i]));
+        }
+        if(!incremental || crossed || (Rmg_L.metric(dx) > ct.incremental_reinit_threshold))
+            moved.push_back(ion);
+        else
+            unmoved[ion] = true;
+    }
+
 
     /* Update items that change when the ionic coordinates change */
     RT1= new RmgTimer("3-ReinitIonicPotentials: init_nuc");
     //init_nuc (vnuc, rhoc, rhocore);
     double *dum_array = NULL;
-    if(ct.localize_localpp) 
+    if(ct.localize_localpp && (ct.incremental_reinit_threshold > 0.0))
+    {
+        UpdateLocalObject (vnuc, ATOMIC_LOCAL_PP, moved, !incremental);
+        UpdateLocalObject (rhoc, ATOMIC_RHOCOMP, moved, !incremental);
+        UpdateLocalObject (rhocore, ATOMIC_RHOCORE, moved, !incremental);
+    }
+    else if(ct.localize_localpp) 
     {
         InitLocalObject (vnuc, dum_array, ATOMIC_LOCAL_PP, false);
         InitLocalObject (rhoc, dum_array, ATOMIC_RHOCOMP, false);
@@ -59,6 +104,14 @@ void ReinitIonicPotentials (Kpoint<KpointType> **Kptr, double * vnuc, double * r
         for(int ix=0;ix < FP0_BASIS;ix++) rhoc[ix] = 0.0;
     }
 
+
+    for(auto ion : moved)
+    {
+        for(int i = 0;i < 3;i++) Atoms[ion].reinit_xtal[i] = Atoms[ion].xtal[i];
+    }
+    reinit_initialized = true;
+    std::copy(lattice, lattice + 9, reinit_lattice);
+
     delete RT1;
     RT1= new RmgTimer("3-ReinitIonicPotentials: get_QI");
     GetQI ();
@@ -74,6 +127,31 @@ void ReinitIonicPotentials (Kpoint<KpointType> **Kptr, double * vnuc, double * r
     if(ct.localize_projectors) projector_type = LOCALIZED;
     RT1= new RmgTimer("3-ReinitIonicPotentials: GetNlop");
 
+    // Save the weights of the current projectors so that the ones belonging to
+    // ions that have not moved can be copied into the new projector layout.
+    bool reuse_weights = incremental && ct.localize_projectors;
+    std::vector<std::unordered_map<int, int>> old_index(ct.num_kpts_pe);
+    std::vector<KpointType *> old_weights(ct.num_kpts_pe, NULL);
+    size_t ion_stride = (size_t)ct.max_nl * (size_t)Kptr[0]->pbasis;
+    if(reuse_weights)
+    {
+        for(int kpt=0; kpt < ct.num_kpts_pe; kpt++)
+        {
+            Projector<KpointType> *P = Kptr[kpt]->BetaProjector;
+            if(!P || !Kptr[kpt]->nl_weight) continue;
+            int num_nonloc_ions = P->get_num_nonloc_ions();
+            int *nonloc_ions_list = P->get_nonloc_ions_list();
+            old_weights[kpt] = new KpointType[num_nonloc_ions * ion_stride + 1];
+            for(int ion1 = 0; ion1 < num_nonloc_ions; ion1++)
+            {
+                if(!unmoved[nonloc_ions_list[ion1]]) continue;
+                old_index[kpt][nonloc_ions_list[ion1]] = ion1;
+                std::copy(&Kptr[kpt]->nl_weight[ion1 * ion_stride], &Kptr[kpt]->nl_weight[(ion1 + 1) * ion_stride], 
+                          &old_weights[kpt][ion1 * ion_stride]);
+            }
+        }
+    }
+
 //  for band structure calculation,the NL projectors will be initialized in Band_tructure.cpp
     // Number of projectors required is computed when the Projector is created.
     // Beta function weights are created in the calls to get_nlop.
@@ -88,14 +166,44 @@ void ReinitIonicPotentials (Kpoint<KpointType> **Kptr, double * vnuc, double * r
     } // end loop over kpts
     delete RT1;
 
+    // Ions whose weights were copied are skipped when the weights are generated. The
+    // nonlocal ion lists are the same for all k-points.
+    std::vector<bool> have_weight(ct.num_ions, false);
+    std::vector<bool> *skip = NULL;
+    if(reuse_weights)
+    {
+        for(int kpt=0; kpt < ct.num_kpts_pe; kpt++)
+        {
+            if(!old_weights[kpt]) continue;
+            int num_nonloc_ions = Kptr[kpt]->BetaProjector->get_num_nonloc_ions();
+            int *nonloc_ions_list = Kptr[kpt]->BetaProjector->get_nonloc_ions_list();
+            for(int ion1 = 0; ion1 < num_nonloc_ions; ion1++)
+            {
+                int ion = nonloc_ions_list[ion1];
+                auto it = old_index[kpt].find(ion);
+                if(it == old_index[kpt].end()) continue;
+                std::copy(&old_weights[kpt][it->second * ion_stride], &old_weights[kpt][(it->second + 1) * ion_stride],
+                          &Kptr[kpt]->nl_weight[ion1 * ion_stride]);
+                if(kpt == 0) have_weight[ion] = true;
+            }
+            delete [] old_weights[kpt];
+        }
+        skip = &have_weight;
+    }
+
 
     /*Other things that need to be recalculated when ionic positions change */
     RT1= new RmgTimer("3-ReinitIonicPotentials: GetWeight");
+
+    // The real-space projectors are shared by all k-points in the batched case
+    if(ct.localize_projectors && ct.batched_kpoint_weights)
+        GetLocalizedWeightBatched (Kptr, ct.num_kpts_pe, skip);
+
     for(int kpt=0; kpt < ct.num_kpts_pe; kpt++)
     {
         if(ct.localize_projectors)
         {
-            Kptr[kpt]->GetLocalizedWeight ();
+            if(!ct.batched_kpoint_weights) Kptr[kpt]->GetLocalizedWeight (skip);
         }
         else
         {
@@ -30,7 +30,12 @@
 #else
     #include <io.h>
 #endif
+#include <cmath>
 #include <complex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
 #include "const.h"
 #include "params.h"
 #include "rmgtypedefs.h"
@@ -42,64 +47,194 @@
 #include "ZfpCompress.h"
 
 static size_t totalsize;
+static double max_wave_error;
 
 
 static void write_double (int fh, double * rp, int count);
 static void write_int (int fh, int *ip, int count);
+template <typename KpointType>
+static void write_data_core (int fhand, BaseGrid *G, int grid_size, double * vh, double * rho, double * vxc,
+                             KpointType **psi, double *occ, double *eig);
 
 
 template void WriteData (int, double *, double *, double *, Kpoint<double> **);
 template void WriteData (int, double *, double *, double *, Kpoint<std::complex<double> > **);
 
+template void WriteDataAsync (std::string, double *, double *, double *, Kpoint<double> **);
+template void WriteDataAsync (std::string, double *, double *, double *, Kpoint<std::complex<double> > **);
+
 void write_compressed_buffer(int fh, double *array, int nx, int ny, int nz);
+static void write_compressed_orbital(int fh, double *array, int nx, int ny, int nz);
 
 /* Writes the hartree potential, the wavefunctions, the */
 /* compensating charges and various other things to a file. */
 template <typename KpointType>
 void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    double time0, write_time;
+    int ns = ct.num_states;
+
+    time0 = my_crtc ();
+
+    std::vector<KpointType *> psi(ct.num_kpts_pe);
+    std::vector<double> occ(ct.num_kpts_pe * ns), eig(ct.num_kpts_pe * ns);
+    for (int ik = 0; ik < ct.num_kpts_pe; ik++)
+    {
+        psi[ik] = Kptr[ik]->Kstates[0].psi;
+        for (int is = 0; is < ns; is++)
+        {
+            occ[ik * ns + is] = Kptr[ik]->Kstates[is].occupation[0];
+            eig[ik * ns + is] = Kptr[ik]->Kstates[is].eig[0];
+        }
+    }
+
+    write_data_core (fhand, Kptr[0]->G, Kptr[0]->pbasis, vh, rho, vxc, psi.data(), occ.data(), eig.data());
+
+    write_time = my_crtc () - time0;
+
+    int npe = Kptr[0]->G->get_PE_X() * Kptr[0]->G->get_PE_Y() * Kptr[0]->G->get_PE_Z();
+    rmg_printf ("WriteData: total size of each of the %d files = %.1f Mb\n", npe,
+            ((double) totalsize) / (1024 * 1024));
+    rmg_printf ("WriteData: writing took %.1f seconds, writing speed %.3f Mbps \n", write_time,
+            ((double) totalsize) / (1024 * 1024) / write_time);
+    if(ct.compressed_outfile)
+        rmg_printf ("WriteData: max relative orbital compression error = %.3e\n", max_wave_error);
+
+}                               /* end write_data */
+
+
+/* Staging area for background restart writes. The state is copied here so the */
+/* calculation can continue while the I/O thread compresses and writes it. */
+static struct AsyncWriter
+{
+    std::thread io_thread;
+    std::vector<double> pot;
+    std::vector<double> states;
+    std::vector<double> psi;
+    ~AsyncWriter() { if(io_thread.joinable()) io_thread.join(); }
+} async_writer;
+
+
+/* Blocks until a background restart write started by WriteDataAsync is complete. */
+void WaitRestartWrite (void)
+{
+    if(!async_writer.io_thread.joinable()) return;
+
+    double time0 = my_crtc ();
+    async_writer.io_thread.join();
+    double wait_time = my_crtc () - time0;
+    if(wait_time > 0.1)
+        rmg_printf ("WriteData: waited %.1f seconds for previous restart write\n", wait_time);
+    if(ct.compressed_outfile)
+        rmg_printf ("WriteData: max relative orbital compression error = %.3e\n", max_wave_error);
+}
+
+
+/* Snapshots the data written by WriteData and writes it to name from a background */
+/* thread. The data is written to a temporary file that replaces name once complete */
+/* so an interrupted write never leaves a truncated restart file behind. */
+template <typename KpointType>
+void WriteDataAsync (std::string name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    WaitRestartWrite();
+
+    int ns = ct.num_states;
+    int nk = ct.num_kpts_pe;
+    size_t grid_size = Kptr[0]->pbasis;
+    size_t fgrid_size = Kptr[0]->G->get_P0_BASIS(Kptr[0]->G->default_FG_RATIO);
+    size_t ncomp = ct.noncoll_factor * ct.noncoll_factor;
+    size_t wvfn_size = grid_size * ct.noncoll_factor * sizeof(KpointType) / sizeof(double);
+
+    async_writer.pot.resize((1 + 2 * ncomp) * fgrid_size);
+    double *s_vh = async_writer.pot.data();
+    double *s_rho = s_vh + fgrid_size;
+    double *s_vxc = s_rho + ncomp * fgrid_size;
+    std::copy(vh, vh + fgrid_size, s_vh);
+    std::copy(rho, rho + ncomp * fgrid_size, s_rho);
+    std::copy(vxc, vxc + ncomp * fgrid_size, s_vxc);
+
+    async_writer.states.resize(2 * nk * ns);
+    double *occ = async_writer.states.data();
+    double *eig = occ + nk * ns;
+    async_writer.psi.resize(nk * ns * wvfn_size);
+    for (int ik = 0; ik < nk; ik++)
+    {
+        double *src = (double *)Kptr[ik]->Kstates[0].psi;
+        std::copy(src, src + ns * wvfn_size, &async_writer.psi[ik * ns * wvfn_size]);
+        for (int is = 0; is < ns; is++)
+        {
+            occ[ik * ns + is] = Kptr[ik]->Kstates[is].occupation[0];
+            eig[ik * ns + is] = Kptr[ik]->Kstates[is].eig[0];
+        }
+    }
+
+    BaseGrid *G = Kptr[0]->G;
+    async_writer.io_thread = std::thread([=]() {
+        std::vector<KpointType *> psi(nk);
+        for (int ik = 0; ik < nk; ik++)
+            psi[ik] = (KpointType *)&async_writer.psi[ik * ns * wvfn_size];
+
+        std::string tmpname = name + ".tmp";
+        int amode = S_IREAD | S_IWRITE;
+        int fhand = open(tmpname.c_str(), O_CREAT | O_TRUNC | O_RDWR, amode);
+        if (fhand < 0)
+            rmg_error_handler(__FILE__, __LINE__, "Can't open restart file. Terminating.");
+
+        write_data_core (fhand, G, (int)grid_size, s_vh, s_rho, s_vxc, psi.data(), occ, eig);
+        close (fhand);
+        chmod (tmpname.c_str(), amode);
+
+        // Save previous wavefunction file
+        std::string old_file = name + "_1";
+        rename (name.c_str(), old_file.c_str());
+        rename (tmpname.c_str(), name.c_str());
+    });
+
+}                               /* end WriteDataAsync */
+
+
+/* Writes the file contents for the psi, occupations and eigenvalues of each local */
+/* k-point. psi[ik] points to the num_states contiguous orbitals of that k-point. */
+template <typename KpointType>
+static void write_data_core (int fhand, BaseGrid *G, int grid_size, double * vh, double * rho, double * vxc,
+                             KpointType **psi, double *occ, double *eig)
 {
     int fine[3];
     int grid[3];
     int pgrid[3];
     int fpgrid[3];
     int pe[3];
-    int npe;
-    int grid_size;
     int fgrid_size;
     int gamma;
     int nk, ik;
     int ns, is;
-    double time0, write_time;
 
-    time0 = my_crtc ();
     totalsize = 0;
+    max_wave_error = 0.0;
 
-    pgrid[0] = Kptr[0]->G->get_PX0_GRID(1);
-    pgrid[1] = Kptr[0]->G->get_PY0_GRID(1);
-    pgrid[2] = Kptr[0]->G->get_PZ0_GRID(1);
-    fpgrid[0] = Kptr[0]->G->get_PX0_GRID(Kptr[0]->G->default_FG_RATIO);
-    fpgrid[1] = Kptr[0]->G->get_PY0_GRID(Kptr[0]->G->default_FG_RATIO);
-    fpgrid[2] = Kptr[0]->G->get_PZ0_GRID(Kptr[0]->G->default_FG_RATIO);
+    pgrid[0] = G->get_PX0_GRID(1);
+    pgrid[1] = G->get_PY0_GRID(1);
+    pgrid[2] = G->get_PZ0_GRID(1);
+    fpgrid[0] = G->get_PX0_GRID(G->default_FG_RATIO);
+    fpgrid[1] = G->get_PY0_GRID(G->default_FG_RATIO);
+    fpgrid[2] = G->get_PZ0_GRID(G->default_FG_RATIO);
 
     /* write grid info */
-    grid[0] = Kptr[0]->G->get_NX_GRID(1);
-    grid[1] = Kptr[0]->G->get_NY_GRID(1);
-    grid[2] = Kptr[0]->G->get_NZ_GRID(1);
+    grid[0] = G->get_NX_GRID(1);
+    grid[1] = G->get_NY_GRID(1);
+    grid[2] = G->get_NZ_GRID(1);
     write_int (fhand, grid, 3);
 
     /* write grid processor topology */
-    pe[0] = Kptr[0]->G->get_PE_X();
-    pe[1] = Kptr[0]->G->get_PE_Y();
-    pe[2] = Kptr[0]->G->get_PE_Z();
+    pe[0] = G->get_PE_X();
+    pe[1] = G->get_PE_Y();
+    pe[2] = G->get_PE_Z();
     write_int (fhand, pe, 3);
 
-    npe = (pe[0] * pe[1] * pe[2]);
-    grid_size = Kptr[0]->pbasis;
-
     /* write fine grid info */
-    fine[0] = Kptr[0]->G->get_PX0_GRID(Kptr[0]->G->default_FG_RATIO) / Kptr[0]->G->get_PX0_GRID(1);
-    fine[1] = Kptr[0]->G->get_PY0_GRID(Kptr[0]->G->default_FG_RATIO) / Kptr[0]->G->get_PY0_GRID(1);
-    fine[2] = Kptr[0]->G->get_PZ0_GRID(Kptr[0]->G->default_FG_RATIO) / Kptr[0]->G->get_PZ0_GRID(1);
+    fine[0] = G->get_PX0_GRID(G->default_FG_RATIO) / G->get_PX0_GRID(1);
+    fine[1] = G->get_PY0_GRID(G->default_FG_RATIO) / G->get_PY0_GRID(1);
+    fine[2] = G->get_PZ0_GRID(G->default_FG_RATIO) / G->get_PZ0_GRID(1);
     write_int (fhand, fine, 3);
     fgrid_size = grid_size * fine[0] * fine[1] * fine[2];
 
@@ -150,23 +285,23 @@ void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<Kpoin
                 {
                     if(gamma)
                     {
-                        write_compressed_buffer(fhand, (double *)Kptr[ik]->Kstates[is].psi, pgrid[0], pgrid[1], pgrid[2]);
+                        write_compressed_orbital(fhand, (double *)&psi[ik][(size_t)is * grid_size * ct.noncoll_factor], pgrid[0], pgrid[1], pgrid[2]);
                     }
                     else
                     {
 
                         for(int ic = 0; ic < ct.noncoll_factor; ic++)
                         {
-                            for(int idx=0;idx < grid_size;idx++) psi_R[idx] = std::real(Kptr[ik]->Kstates[is].psi[idx + ic * grid_size]);
-                            for(int idx=0;idx < grid_size;idx++) psi_I[idx] = std::imag(Kptr[ik]->Kstates[is].psi[idx + ic * grid_size]);
-                            write_compressed_buffer(fhand, psi_R, pgrid[0], pgrid[1], pgrid[2]);
-                            write_compressed_buffer(fhand, psi_I, pgrid[0], pgrid[1], pgrid[2]);
+                            for(int idx=0;idx < grid_size;idx++) psi_R[idx] = std::real(psi[ik][(size_t)is * grid_size * ct.noncoll_factor + idx + ic * grid_size]);
+                            for(int idx=0;idx < grid_size;idx++) psi_I[idx] = std::imag(psi[ik][(size_t)is * grid_size * ct.noncoll_factor + idx + ic * grid_size]);
+                            write_compressed_orbital(fhand, psi_R, pgrid[0], pgrid[1], pgrid[2]);
+                            write_compressed_orbital(fhand, psi_I, pgrid[0], pgrid[1], pgrid[2]);
                         }
                     }
                 }
                 else
                 {
-                    write_double (fhand, (double *)Kptr[ik]->Kstates[is].psi, wvfn_size);
+                    write_double (fhand, (double *)&psi[ik][(size_t)is * grid_size * ct.noncoll_factor], wvfn_size);
                 }
             }
         }
@@ -182,7 +317,7 @@ void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<Kpoin
         for (ik = 0; ik < ct.num_kpts_pe; ik++)
             for (is = 0; is < ns; is++)
             {
-                write_double (fhand, &Kptr[ik]->Kstates[is].occupation[0], 1); 
+                write_double (fhand, &occ[ik * ns + is], 1); 
             }
     }
 
@@ -193,23 +328,12 @@ void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<Kpoin
         for (ik = 0; ik < ct.num_kpts_pe; ik++)
             for (is = 0; is < ns; is++)
             {
-                write_double (fhand, &Kptr[ik]->Kstates[is].eig[0], 1);
+                write_double (fhand, &eig[ik * ns + is], 1);
             }
 
     }
 
-
-    write_time = my_crtc () - time0;
-
-    rmg_printf ("WriteData: total size of each of the %d files = %.1f Mb\n", npe,
-            ((double) totalsize) / (1024 * 1024));
-    rmg_printf ("WriteData: writing took %.1f seconds, writing speed %.3f Mbps \n", write_time,
-            ((double) totalsize) / (1024 * 1024) / write_time);
-
-
-
-
-}                               /* end write_data */
+}                               /* end write_data_core */
 
 
 
@@ -255,3 +379,42 @@ void write_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     delete [] out;
 
 }
+
+
+/* Orbitals are compressed with an error bound relative to the largest value in the */
+/* buffer. The relative tolerance is restart_wave_tolerance or if that is zero the rms */
+/* convergence criterion. The absolute tolerance is written after the compressed size */
+/* which is tagged with RESTART_TOLERANCE_FLAG. The buffer is decompressed again to */
+/* measure the relative L2 error that was actually introduced. */
+static void write_compressed_orbital(int fh, double *array, int nx, int ny, int nz)
+{
+
+    ZfpCompress C;
+    size_t n = (size_t)nx * ny * nz;
+    std::vector<double> out(2*n), back(n);
+
+    double amax = 0.0;
+    for(size_t idx = 0;idx < n;idx++) amax = std::max(amax, std::abs(array[idx]));
+    double rtol = (ct.restart_wave_tolerance > 0.0) ? ct.restart_wave_tolerance : std::max(ct.thr_rms, RESTART_TOLERANCE);
+    double tol = (amax > 0.0) ? rtol * amax : RESTART_TOLERANCE;
+
+    size_t csize = C.compress_buffer(array, out.data(), nx, ny, nz, tol, 2*n*sizeof(double));
+    size_t tsize = csize | RESTART_TOLERANCE_FLAG;
+    if(write (fh, &tsize, sizeof(tsize)) != sizeof(tsize))
+        rmg_error_handler (__FILE__,__LINE__,"error writing");
+    if(write (fh, &tol, sizeof(tol)) != sizeof(tol))
+        rmg_error_handler (__FILE__,__LINE__,"error writing");
+    if(write (fh, out.data(), csize) != (ssize_t)csize)
+        rmg_error_handler (__FILE__,__LINE__,"error writing");
+    totalsize += csize + sizeof(tsize) + sizeof(tol);
+
+    C.decompress_buffer(back.data(), out.data(), nx, ny, nz, tol, 2*n*sizeof(double));
+    double enorm = 0.0, anorm = 0.0;
+    for(size_t idx = 0;idx < n;idx++)
+    {
+        enorm += (back[idx] - array[idx]) * (back[idx] - array[idx]);
+        anorm += array[idx] * array[idx];
+    }
+    if(anorm > 0.0) max_wave_error = std::max(max_wave_error, std::sqrt(enorm / anorm));
+
+}
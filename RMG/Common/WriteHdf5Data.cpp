@@ -0,0 +1,255 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "hdf5.h"
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "RmgException.h"
+#include "State.h"
+#include "Kpoint.h"
+#include "transition.h"
+
+
+/*
+
+  Writes the hartree potential, charge density, exchange correlation potential and the
+  orbitals of every spin and k-point of an image to a single HDF5 file <name>.h5.
+
+  /                              attributes grid, fine_grid, gamma, num_states, nspin,
+                                 noncoll_factor, num_kpts
+  /spin%d/vh                     (1, FNX, FNY, FNZ)
+  /spin%d/rho, /spin%d/vxc       (noncoll_factor^2, FNX, FNY, FNZ)
+  /spin%d/kpt%d/psi              (num_states, noncoll_factor, NX, NY, NZ, ncomp)
+  /spin%d/kpt%d/occupations      (num_states)
+  /spin%d/kpt%d/eigenvalues      (num_states)
+
+  ncomp is 1 for gamma point runs and 2 (real, imaginary) otherwise. Every object is
+  stored in global grid order so ReadHdf5Data can select the block owned by a rank of
+  any processor grid. If HDF5 was built with MPI support the file is written
+  collectively with MPI-IO, otherwise the ranks write their blocks in turn.
+
+*/
+
+template void WriteHdf5Data (std::string&, double *, double *, double *, Kpoint<double> **);
+template void WriteHdf5Data (std::string&, double *, double *, double *, Kpoint<std::complex<double> > **);
+
+// Target size of a dataset chunk in bytes
+static const size_t hdf5_chunk_bytes = 4*1024*1024;
+
+static void write_attr(hid_t loc, const char *name, int *vals, int count)
+{
+    hsize_t dims = count;
+    hid_t space = H5Screate_simple(1, &dims, NULL);
+    hid_t attr = H5Acreate2(loc, name, H5T_NATIVE_INT, space, H5P_DEFAULT, H5P_DEFAULT);
+    if((attr < 0) || (H5Awrite(attr, H5T_NATIVE_INT, vals) < 0))
+        throw RmgFatalException() << "Error writing attribute " << name << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    H5Aclose(attr);
+    H5Sclose(space);
+}
+
+// Creates a chunked dataset whose chunks span the trailing dimensions and as many
+// slices of the dimension at chunk_dim as fit in hdf5_chunk_bytes.
+static void create_dataset(hid_t loc, const char *name, int rank, hsize_t *dims, int chunk_dim)
+{
+    hsize_t chunk[8];
+    size_t slice = sizeof(double);
+    for(int i = 0;i < rank;i++) chunk[i] = (i < chunk_dim) ? 1 : dims[i];
+    for(int i = chunk_dim + 1;i < rank;i++) slice *= dims[i];
+    chunk[chunk_dim] = std::max((hsize_t)1, std::min(dims[chunk_dim], (hsize_t)(hdf5_chunk_bytes / slice)));
+
+    hid_t space = H5Screate_simple(rank, dims, NULL);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, rank, chunk);
+    H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY);
+    H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER);
+    hid_t dset = H5Dcreate2(loc, name, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    if(dset < 0)
+        throw RmgFatalException() << "Error creating dataset " << name << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    H5Dclose(dset);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+}
+
+// Writes the block at offset with extent count. Ranks that do not own a block of this
+// dataset still take part in collective writes with an empty selection.
+static void write_block(hid_t file, const char *name, int rank, hsize_t *offset, hsize_t *count,
+                        void *buf, bool active, hid_t dxpl)
+{
+    hid_t dset = H5Dopen2(file, name, H5P_DEFAULT);
+    hid_t fspace = H5Dget_space(dset);
+    hid_t mspace = H5Screate_simple(rank, count, NULL);
+    if(active)
+    {
+        H5Sselect_hyperslab(fspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+    }
+    else
+    {
+        H5Sselect_none(fspace);
+        H5Sselect_none(mspace);
+    }
+    if(H5Dwrite(dset, H5T_NATIVE_DOUBLE, mspace, fspace, dxpl, buf) < 0)
+        throw RmgFatalException() << "Error writing dataset " << name << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    H5Dclose(dset);
+}
+
+
+template <typename KpointType>
+void WriteHdf5Data (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    BaseGrid *G = Kptr[0]->G;
+    int ratio = G->default_FG_RATIO;
+    int nc = ct.noncoll_factor;
+    int ncomp = ct.is_gamma ? 1 : 2;
+    int ns = ct.num_states;
+    char dname[MAX_PATH];
+    double time0 = my_crtc ();
+
+    std::string fname = name + ".h5";
+
+    hsize_t fdims[4] = {(hsize_t)nc*nc, (hsize_t)G->get_NX_GRID(ratio), (hsize_t)G->get_NY_GRID(ratio), (hsize_t)G->get_NZ_GRID(ratio)};
+    hsize_t foff[4] = {0, (hsize_t)G->get_PX_OFFSET(ratio), (hsize_t)G->get_PY_OFFSET(ratio), (hsize_t)G->get_PZ_OFFSET(ratio)};
+    hsize_t fcnt[4] = {(hsize_t)nc*nc, (hsize_t)G->get_PX0_GRID(ratio), (hsize_t)G->get_PY0_GRID(ratio), (hsize_t)G->get_PZ0_GRID(ratio)};
+
+    hsize_t pdims[6] = {(hsize_t)ns, (hsize_t)nc, (hsize_t)G->get_NX_GRID(1), (hsize_t)G->get_NY_GRID(1), (hsize_t)G->get_NZ_GRID(1), (hsize_t)ncomp};
+    hsize_t poff[6] = {0, 0, (hsize_t)G->get_PX_OFFSET(1), (hsize_t)G->get_PY_OFFSET(1), (hsize_t)G->get_PZ_OFFSET(1), 0};
+    hsize_t pcnt[6] = {(hsize_t)ns, (hsize_t)nc, (hsize_t)G->get_PX0_GRID(1), (hsize_t)G->get_PY0_GRID(1), (hsize_t)G->get_PZ0_GRID(1), (hsize_t)ncomp};
+
+    hsize_t sdims = ns, soff = 0;
+
+    // Creates all groups and datasets. With parallel HDF5 this is collective.
+    auto create_layout = [&](hid_t file) {
+        int grid[3] = {G->get_NX_GRID(1), G->get_NY_GRID(1), G->get_NZ_GRID(1)};
+        int fgrid[3] = {(int)fdims[1], (int)fdims[2], (int)fdims[3]};
+        int gamma = ct.is_gamma;
+        write_attr(file, "grid", grid, 3);
+        write_attr(file, "fine_grid", fgrid, 3);
+        write_attr(file, "gamma", &gamma, 1);
+        write_attr(file, "num_states", &ns, 1);
+        write_attr(file, "nspin", &ct.nspin, 1);
+        write_attr(file, "noncoll_factor", &nc, 1);
+        write_attr(file, "num_kpts", &ct.num_kpts, 1);
+
+        for(int is = 0;is < ct.nspin;is++)
+        {
+            snprintf(dname, sizeof(dname), "spin%d", is);
+            hid_t sgroup = H5Gcreate2(file, dname, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+            fdims[0] = 1;
+            create_dataset(sgroup, "vh", 4, fdims, 1);
+            fdims[0] = nc*nc;
+            create_dataset(sgroup, "rho", 4, fdims, 1);
+            create_dataset(sgroup, "vxc", 4, fdims, 1);
+            for(int ik = 0;ik < ct.num_kpts;ik++)
+            {
+                snprintf(dname, sizeof(dname), "kpt%d", ik);
+                hid_t kgroup = H5Gcreate2(sgroup, dname, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+                create_dataset(kgroup, "psi", 6, pdims, 2);
+                create_dataset(kgroup, "occupations", 1, &sdims, 0);
+                create_dataset(kgroup, "eigenvalues", 1, &sdims, 0);
+                H5Gclose(kgroup);
+            }
+            H5Gclose(sgroup);
+        }
+    };
+
+    // Writes the blocks owned by this rank. Potentials are the same for all k-point
+    // groups of a spin so only the first one writes them.
+    auto write_blocks = [&](hid_t file, hid_t dxpl, bool collective) {
+        std::vector<double> occ(ns), eig(ns);
+        for(int is = 0;is < ct.nspin;is++)
+        {
+            bool pot_owner = (is == pct.spinpe) && (pct.kstart == 0);
+            if(pot_owner || collective)
+            {
+                snprintf(dname, sizeof(dname), "spin%d/vh", is);
+                fcnt[0] = 1;
+                write_block(file, dname, 4, foff, fcnt, vh, pot_owner, dxpl);
+                fcnt[0] = nc*nc;
+                snprintf(dname, sizeof(dname), "spin%d/rho", is);
+                write_block(file, dname, 4, foff, fcnt, rho, pot_owner, dxpl);
+                snprintf(dname, sizeof(dname), "spin%d/vxc", is);
+                write_block(file, dname, 4, foff, fcnt, vxc, pot_owner, dxpl);
+            }
+
+            for(int kpt = 0;kpt < ct.num_kpts;kpt++)
+            {
+                int ik = kpt - pct.kstart;
+                bool owner = (is == pct.spinpe) && (ik >= 0) && (ik < ct.num_kpts_pe);
+                if(!owner && !collective) continue;
+                KpointType *psi = owner ? Kptr[ik]->Kstates[0].psi : NULL;
+                snprintf(dname, sizeof(dname), "spin%d/kpt%d/psi", is, kpt);
+                write_block(file, dname, 6, poff, pcnt, psi, owner, dxpl);
+
+                bool state_owner = owner && (pct.gridpe == 0);
+                if(state_owner)
+                {
+                    for(int st = 0;st < ns;st++) occ[st] = Kptr[ik]->Kstates[st].occupation[0];
+                    for(int st = 0;st < ns;st++) eig[st] = Kptr[ik]->Kstates[st].eig[0];
+                }
+                snprintf(dname, sizeof(dname), "spin%d/kpt%d/occupations", is, kpt);
+                write_block(file, dname, 1, &soff, &sdims, occ.data(), state_owner, dxpl);
+                snprintf(dname, sizeof(dname), "spin%d/kpt%d/eigenvalues", is, kpt);
+                write_block(file, dname, 1, &soff, &sdims, eig.data(), state_owner, dxpl);
+            }
+        }
+    };
+
+    MPI_Barrier(pct.img_comm);
+
+#ifdef H5_HAVE_PARALLEL
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(fapl, pct.img_comm, MPI_INFO_NULL);
+    hid_t file = H5Fcreate(fname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+    if(file < 0)
+        throw RmgFatalException() << "Unable to create " << fname << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    create_layout(file);
+
+    hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_COLLECTIVE);
+    write_blocks(file, dxpl, true);
+    H5Pclose(dxpl);
+    H5Fclose(file);
+    H5Pclose(fapl);
+#else
+    // ReadCommon rejects write_hdf5_restart without parallel HDF5
+    throw RmgFatalException() << "write_hdf5_restart requires an HDF5 library built with MPI support in " << __FILE__ << " at line " << __LINE__ << "\n";
+#endif
+
+    double write_time = my_crtc () - time0;
+    double fsize = (double)sizeof(double) * ct.nspin *
+                   ((double)ct.num_kpts * ns * (2 + nc * ncomp * G->get_GLOBAL_BASIS(1)) +
+                    (1 + 2*nc*nc) * G->get_GLOBAL_BASIS(ratio));
+    rmg_printf ("WriteHdf5Data: size of %s = %.1f Mb\n", fname.c_str(), fsize / (1024 * 1024));
+    rmg_printf ("WriteHdf5Data: writing took %.1f seconds, writing speed %.3f Mbps \n", write_time,
+            fsize / (1024 * 1024) / write_time);
+
+}
@@ -39,6 +39,7 @@
 #include "rmg_error.h"
 #include "State.h"
 #include "Kpoint.h"
+#include "OrbitalPager.h"
 #include "transition.h"
 #if QMCPACK_SUPPORT
     #include "WriteEshdf.h"
@@ -70,6 +71,11 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
 	return;
     }
 
+    // Orbitals mapped to disk are read directly from the mapping below so let queued
+    // read ahead and write behind finish first instead of competing for the same pages.
+    for(int kpt = 0;kpt < ct.num_kpts_pe;kpt++)
+        if(Kptr[kpt]->orbital_pager) Kptr[kpt]->orbital_pager->Wait();
+
     
     /*Only one processor will write restart file*/
     if (pct.imgpe == 0)
@@ -172,28 +178,52 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
     /* All processors should wait until 0 is done to make sure that directories are created*/
     MPI_Barrier(pct.img_comm);
 
-    sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, pct.kstart, pct.gridpe);
-
-    // Save previous wavefunction file
-    std::string new_file(newname);
-    std::string old_file(newname);
-    old_file = old_file + "_1";
-    try {
-        boost::filesystem::rename(new_file, old_file);
+    amode = S_IREAD | S_IWRITE;
+    if(ct.write_hdf5_restart)
+    {
+        // Save previous restart data file
+        std::string hdf_file(name);
+        if (pct.imgpe == 0)
+        {
+            try {
+                boost::filesystem::rename(hdf_file + ".h5", hdf_file + ".h5_1");
+            }
+            catch (std::exception &e) {
+                // This could be an error but it could just be the first step ...
+            }
+        }
+        WriteHdf5Data (hdf_file, vh, rho, vxc, Kptr);
+        sprintf (newname, "%s.h5", name);
     }
-    catch (std::exception &e) { 
-        // This could be an error but it could just be the first step ...
+    else if(ct.async_restart)
+    {
+        sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, pct.kstart, pct.gridpe);
+        WriteDataAsync (std::string(newname), vh, rho, vxc, Kptr);
     }
+    else
+    {
+        sprintf (newname, "%s_spin%d_kpt%d_gridpe%d", name, pct.spinpe, pct.kstart, pct.gridpe);
 
-    amode = S_IREAD | S_IWRITE;
-    fhand = open(newname, O_CREAT | O_TRUNC | O_RDWR, amode);
-    if (fhand < 0) {
-        rmg_printf("Can't open restart file %s", newname);
-        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
-    }
+        // Save previous wavefunction file
+        std::string new_file(newname);
+        std::string old_file(newname);
+        old_file = old_file + "_1";
+        try {
+            boost::filesystem::rename(new_file, old_file);
+        }
+        catch (std::exception &e) { 
+            // This could be an error but it could just be the first step ...
+        }
 
-    WriteData (fhand, vh, rho, vxc, Kptr);
-    close (fhand);
+        fhand = open(newname, O_CREAT | O_TRUNC | O_RDWR, amode);
+        if (fhand < 0) {
+            rmg_printf("Can't open restart file %s", newname);
+            rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+        }
+
+        WriteData (fhand, vh, rho, vxc, Kptr);
+        close (fhand);
+    }
 
 
     if((ct.ldaU_mode != LDA_PLUS_U_NONE) && (ct.num_ldaU_ions > 0))
@@ -230,8 +260,8 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
     rmg_printf ("WriteRestart: writing took %.1f seconds \n", write_time);
 
 
-    /* force change mode of output file */
-    chmod (newname, amode);
+    /* force change mode of output file, background writes do this when they finish */
+    if(ct.write_hdf5_restart || !ct.async_restart) chmod (newname, amode);
 
     if (pct.imgpe == 0)
     {
@@ -61,6 +61,8 @@ template <typename OrbitalType> bool Scf (double * vxc, double *vxc_correct, dou
           int boundaryflag, Kpoint<OrbitalType> **Kptr, std::vector<double>& RMSdV);
 template <typename KpointType> void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
             KpointType *psi, KpointType *nv, KpointType *ns, int first_state, int num_states);
+template <typename KpointType> void BetaxpsiAppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
+            KpointType *psi, KpointType *nv, KpointType *ns, int first_state, int num_states);
 template <typename KpointType> void AppS(Kpoint<KpointType> *kpoint, KpointType *sintR,
             KpointType *psi, KpointType *ns, int first_state, int num_states);
 template <typename OrbitalType> double EnergyCorrection (Kpoint<OrbitalType> **Kptr,
@@ -109,10 +111,21 @@ void WriteBGW_VxcEig (int kpt, double * vxc, Kpoint<KpointType> * Kptr);
 template <typename KpointType>
 void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
+void WriteDataAsync (std::string name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+void WaitRestartWrite (void);
+template <typename KpointType>
 void WriteSerialData (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
 void ReadSerialData (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
+void WriteHdf5Data (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+template <typename KpointType>
+void ReadHdf5Data (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+template <typename KpointType>
+void RandomizeExtraStates (int ns, Kpoint<KpointType> ** Kptr);
+template <typename KpointType>
+void CheckRestartOrbitals (Kpoint<KpointType> *kptr);
+template <typename KpointType>
 double Fill (Kpoint<KpointType> **Kptr, double width, double nel, double mix, int num_st, int occ_flag, int mp_order);
 template <typename KpointType>
 double FillTetra(Kpoint<KpointType> **Kptr);
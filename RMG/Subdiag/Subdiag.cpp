@@ -297,8 +297,8 @@ template <class KpointType> void Kpoint<KpointType>::Subdiag (double *vtot_eig,
 
     memcpy(&orbital_storage[istart], &tmp_arrayT[istart], tlen);
 
-    // Rotate EXX
-    if(ct.xc_is_hybrid && Functional::is_exx_active())
+    // Rotate EXX. ACE vectors do not depend on the orbitals.
+    if(ct.xc_is_hybrid && Functional::is_exx_active() && !ct.exx_ace)
     {
         tlen = nstates * pbasis_noncoll * sizeof(KpointType);
         // vexx is not in managed memory yet so that might create an issue
@@ -205,7 +205,7 @@ char * Subdiag_Scalapack (Kpoint<KpointType> *kptr, KpointType *hpsi)
 
     // And finally make sure they follow the same sign convention when using hybrid XC
     // Optimize this for GPUs!
-    if(ct.xc_is_hybrid && Functional::is_exx_active())
+    if(ct.xc_is_hybrid && Functional::is_exx_active() && !ct.exx_ace)
     {
         tlen = (size_t)nstates * (size_t)pbasis_noncoll * sizeof(KpointType);
 #if HIP_ENABLED || CUDA_ENABLED || SYCL_ENABLED
@@ -544,8 +544,8 @@ char * Subdiag_Scalapack1 (Kpoint<KpointType> *kptr, KpointType *hpsi)
 
     memcpy(&kptr->orbital_storage[istart], &tmp_arrayT[istart], tlen);
 
-    // Rotate EXX
-    if(ct.xc_is_hybrid && Functional::is_exx_active())
+    // Rotate EXX. ACE vectors do not depend on the orbitals.
+    if(ct.xc_is_hybrid && Functional::is_exx_active() && !ct.exx_ace)
     {
         tlen = nstates * pbasis_noncoll * sizeof(KpointType);
         // vexx is not in managed memory yet so that might create an issue
@@ -54,6 +54,8 @@ double CPP_app_cil_driver (Lattice *L, TradeImages *T, RmgType * a, RmgType * b,
 template <typename RmgType>
 void CPP_app_grad_driver (Lattice *L, TradeImages *T, RmgType * a, RmgType * bx, RmgType * by, RmgType * bz, int dimx, int dimy, int dimz, double gridhx, double gridhy, double gridhz, int order, bool alt_flag);
 template <typename RmgType>
+void CPP_app_div_driver (Lattice *L, TradeImages *T, RmgType * ax, RmgType * ay, RmgType * az, RmgType * div, int dimx, int dimy, int dimz, double gridhx, double gridhy, double gridhz, int order, bool alt_flag);
+template <typename RmgType>
 double CPP_app_del2_driver (Lattice *L, TradeImages *T, RmgType * a, RmgType * b, int dimx, int dimy, int dimz, double gridhx, double gridhy, double gridhz, int order);
 template <typename RmgType>
 double CPP_app_del2_driver (Lattice *L, TradeImages *T, RmgType * a, RmgType * b, int dimx, int dimy, int dimz, double gridhx, double gridhy, double gridhz, int order, bool alt_flag);
@@ -164,6 +166,14 @@ public:
                                 double hxgrid,
                                 int dimx, int dimy, int dimz);
 
+    template <typename RmgType, int order>
+    void fd_divergence_general (RmgType * __restrict__ ax,
+                                RmgType * __restrict__ ay,
+                                RmgType * __restrict__ az,
+                                RmgType * __restrict__ div,
+                                double hxgrid,
+                                int dimx, int dimy, int dimz);
+
     template <typename RmgType>
     void app_gradient_tenth (RmgType * rptr, RmgType * wxr, RmgType *wyr, RmgType *wzr, int dimx, int dimy, int dimz,
                                    double gridhx, double gridhy, double gridhz);
@@ -316,6 +316,15 @@ template void FiniteDiff::fd_gradient_general<double, 12> (double *, double *, d
 template void FiniteDiff::fd_gradient_general<std::complex<double>, 12> (std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, double, int, int, int);
 template void FiniteDiff::fd_gradient_general<std::complex<float>, 12> (std::complex<float>  *, std::complex<float>  *, std::complex<float>  *, std::complex<float>  *, double, int, int, int);
 
+template void FiniteDiff::fd_divergence_general<double, 6> (double *, double *, double *, double *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<std::complex<double>, 6> (std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<double, 8> (double *, double *, double *, double *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<std::complex<double>, 8> (std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<double, 10> (double *, double *, double *, double *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<std::complex<double>, 10> (std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<double, 12> (double *, double *, double *, double *, double, int, int, int);
+template void FiniteDiff::fd_divergence_general<std::complex<double>, 12> (std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, std::complex<double>  *, double, int, int, int);
+
 template double FiniteDiff::app_combined<float,2>(float *, float *, int, int, int, double, double, double, double *kvec, bool use_gpu);
 template double FiniteDiff::app_combined<double,2>(double *, double *, int, int, int, double, double, double, double *kvec, bool use_gpu);
 template double FiniteDiff::app_combined<std::complex <float>, 2>(std::complex<float> *, std::complex<float> *, int, int, int, double, double, double, double *kvec, bool use_gpu);
@@ -1439,6 +1448,60 @@ void FiniteDiff::fd_gradient_general (RmgType * __restrict__ a,
 } /* end app8_gradient_general */
 
 
+// Computes the divergence of the vector field (ax, ay, az) in a single pass over the
+// same stencils that fd_gradient_general uses. Axis offsets follow the ordering
+// 0=x,1=y,2=z,3=xy,4=xz,5=yz,6=nxy,7=nxz,8=nyz,9=xyz,10=nxnyz,11=xnyz,12=xnynz
+template <typename RmgType, int order>
+void FiniteDiff::fd_divergence_general (RmgType * __restrict__ ax,
+                                RmgType * __restrict__ ay,
+                                RmgType * __restrict__ az,
+                                RmgType * __restrict__ div,
+                                double gridhx,
+                                int dimx, int dimy, int dimz)
+{
+    int ibrav = L->get_ibrav_type();
+    RmgType cx[12], cy[12], cz[12];
+    int ixs = (dimy + order) * (dimz + order);
+    int iys = (dimz + order);
+    LaplacianCoeff *LC = FiniteDiff::FdCoeffs[FiniteDiff::LCkey(gridhx) + order];
+    bool orthogonal = (ibrav == ORTHORHOMBIC_PRIMITIVE || ibrav == CUBIC_PRIMITIVE || ibrav == TETRAGONAL_PRIMITIVE);
+    int stride[13] = {ixs, iys, 1, ixs + iys, ixs + 1, iys + 1, -ixs + iys, -ixs + 1, -iys + 1,
+                      ixs + iys + 1, -ixs - iys + 1, ixs - iys + 1, ixs - iys - 1};
+
+    for(int idx = 0;idx < dimx*dimy*dimz;idx++) div[idx] = 0.0;
+
+    for(int axis = 0;axis < 13;axis++)
+    {
+        if(axis > 2 && (orthogonal || !LC->include_axis[axis])) continue;
+
+        fd_gradient_coeffs(order, gridhx, axis, cx, cy, cz);
+        int s = stride[axis];
+
+        for (int ix = order/2; ix < dimx + order/2; ix++)
+        {
+            for (int iy = order/2; iy < dimy + order/2; iy++)
+            {
+                RmgType *Ax = &ax[iy*iys + ix*ixs];
+                RmgType *Ay = &ay[iy*iys + ix*ixs];
+                RmgType *Az = &az[iy*iys + ix*ixs];
+                RmgType *bd = &div[(iy - order/2)*dimz + (ix - order/2)*dimy*dimz - order/2];
+                for (int iz = order/2; iz < dimz + order/2; iz++)
+                {
+                    RmgType sum = 0.0;
+                    for(int k = 1;k <= order/2;k++)
+                    {
+                        sum += cx[k-1] * (Ax[iz - k*s] - Ax[iz + k*s]) +
+                               cy[k-1] * (Ay[iz - k*s] - Ay[iz + k*s]) +
+                               cz[k-1] * (Az[iz - k*s] - Az[iz + k*s]);
+                    }
+                    bd[iz] += sum;
+                }
+            }
+        }
+    }
+} /* end fd_divergence_general */
+
+
 
 // Gets the central coefficient
 double FiniteDiff::fd_coeff0(int order, double hxgrid)
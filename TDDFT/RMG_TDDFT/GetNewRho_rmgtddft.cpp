@@ -28,6 +28,7 @@
 #include "RmgParallelFft.h"
 #include "RmgGemm.h"
 #include "blas_driver.h"
+#include "DensityTiles.h"
 
 
 
@@ -55,9 +56,24 @@ void GetNewRho_rmgtddft (double *psi, double *xpsi, double *rho, double *rho_mat
                 psi, pbasis, rho_matrix, numst, zero, xpsi, pbasis);
 
         my_sync_device();
-        for(st1 = 0; st1 < numst; st1++)
-            for(idx = 0; idx < pbasis; idx++)
-                rho_temp[idx] += psi[st1 * pbasis + idx] * xpsi[st1 * pbasis + idx];
+
+        // Threads own disjoint grid tiles and stream all states through them
+        int tsize = DensityTileSize(pbasis);
+        int ntiles = (pbasis + tsize - 1) / tsize;
+#pragma omp parallel for schedule(static)
+        for(int tile = 0; tile < ntiles; tile++)
+        {
+            int start = tile * tsize;
+            int stop = std::min(start + tsize, pbasis);
+            for(int st = 0; st < numst; st++)
+            {
+                double *p1 = &psi[(size_t)st * pbasis];
+                double *p2 = &xpsi[(size_t)st * pbasis];
+#pragma omp simd
+                for(int ix = start; ix < stop; ix++)
+                    rho_temp[ix] += p1[ix] * p2[ix];
+            }
+        }
 
     }
 
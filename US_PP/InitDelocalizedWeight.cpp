@@ -24,48 +24,33 @@
 
 
 /*This sets loop over species does forward fourier transofrm, finds and stores whatever is needed so that
- * only backwards Fourier transform is needed in the calculation*/
+ * only backwards Fourier transform is needed in the calculation. When ct.delocalized_beta_on_the_fly
+ * is set only the k-independent (k=0) transform is stored and GetDelocalizedWeight applies the
+ * Bloch phase in real space. If the projector overlaps its own periodic images that is not
+ * accurate, so nothing is stored and the transforms are generated for one k-point at a time
+ * by GetDelocalizedBeta.*/
 void SPECIES::InitDelocalizedWeight (void)
 {
     RmgTimer RT0("Weight");
 
 
-    PROJ_INFO proj;
-    std::vector<PROJ_INFO> proj_iter;
-
     // get tot number of projectors and their information
-    
-
-    std::complex<double> I_t(0.0, 1.0);
-    std::complex<double> *IL =  new std::complex<double>[ct.max_l+2];
-    for(int L = 0; L <  ct.max_l+2; L++) IL[L] = std::pow(-I_t, L);
-    std::complex<double> phase = PI * I_t;
-    phase = std::exp(phase);
-    int max_pbasis = 0;
+    this->proj_ip.clear();
+    this->proj_l.clear();
+    this->proj_m.clear();
 
     int lmax = ct.max_l + 1;
     int num_lm = (lmax + 1) * (lmax + 1);
     int num_LM2 = (2*lmax + 1) * (2*lmax + 1);
 
-    std::vector<int> lpx(num_lm * num_lm);
-    std::vector<int> lpl(num_lm * num_lm  * num_LM2);
-    std::vector<double> ap(num_LM2 * num_lm * num_lm);
+    this->cg_lpx.resize(num_lm * num_lm);
+    this->cg_lpl.resize(num_lm * num_lm  * num_LM2);
+    this->cg_ap.resize(num_LM2 * num_lm * num_lm);
 
-    InitClebschGordan(lmax, ap.data(), lpx.data(), lpl.data());
+    InitClebschGordan(lmax, this->cg_ap.data(), this->cg_lpx.data(), this->cg_lpl.data());
 
     Pw *pwave = this->prj_pwave;
     int pbasis = pwave->Grid->get_P0_BASIS(1);
-    max_pbasis = std::max(max_pbasis, pbasis);
-    int dimx = pwave->Grid->get_PX0_GRID(1);
-    int dimy = pwave->Grid->get_PY0_GRID(1);
-    int dimz = pwave->Grid->get_PZ0_GRID(1);
-    int ixstart = pwave->Grid->get_PX_OFFSET(1);
-    int iystart = pwave->Grid->get_PY_OFFSET(1);
-    int izstart = pwave->Grid->get_PZ_OFFSET(1);
-    double vol = pwave->L->get_omega();
-    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
-    double tpiba2 = tpiba * tpiba;
-    double gcut = sqrt(pwave->gcut*tpiba2);
 
 
     /*Loop over all betas to calculate num of projectors for given species */
@@ -74,128 +59,193 @@ void SPECIES::InitDelocalizedWeight (void)
     {
         for(int m = 0; m < 2*this->llbeta[ip]+1; m++)
         {
-            proj.ip = ip;
-            proj.l = this->llbeta[ip];
-            proj.m = m;
-            proj.proj_index = prjcount;
-            proj_iter.push_back(proj);
+            this->proj_ip.push_back(ip);
+            this->proj_l.push_back(this->llbeta[ip]);
+            this->proj_m.push_back(m);
             prjcount++;
         }
     }
 
     this->num_projectors = prjcount;
+    this->forward_beta_k_independent = false;
 
+    if(this->forward_beta) fftw_free(this->forward_beta);
+    this->forward_beta = NULL;
+    for(int ixyz = 0;ixyz < 3;ixyz++)
+    {
+        if(this->forward_beta_r[ixyz]) fftw_free(this->forward_beta_r[ixyz]);
+        this->forward_beta_r[ixyz] = NULL;
+    }
+
+    int num_kcopies = ct.num_kpts_pe;
+    if(ct.delocalized_beta_on_the_fly)
+    {
+        // The real-space Bloch phase needs a single image of the projector in the cell and the
+        // half cell shift applied by GetDelocalizedBeta is only exact for even grids.
+        double *a[3] = {Rmg_L.a0, Rmg_L.a1, Rmg_L.a2};
+        double spacing = DBL_MAX;
+        for(int i = 0;i < 3;i++)
+        {
+            double *u = a[(i+1)%3], *v = a[(i+2)%3];
+            double cx = u[1]*v[2] - u[2]*v[1];
+            double cy = u[2]*v[0] - u[0]*v[2];
+            double cz = u[0]*v[1] - u[1]*v[0];
+            spacing = std::min(spacing, Rmg_L.get_omega() / sqrt(cx*cx + cy*cy + cz*cz));
+        }
+        bool even = !(pwave->Grid->get_NX_GRID(1) % 2) && !(pwave->Grid->get_NY_GRID(1) % 2) &&
+                    !(pwave->Grid->get_NZ_GRID(1) % 2);
+
+        // Otherwise the projectors are generated for each k-point on demand
+        if(!even || (2.0*this->nlradius >= spacing)) return;
+        this->forward_beta_k_independent = true;
+        num_kcopies = 1;
+    }
 
     /*This array will store forward fourier transform on the coarse grid for all betas of this species */
-    if(this->forward_beta) fftw_free(this->forward_beta);
-    this->forward_beta = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * pbasis * ct.num_kpts_pe);
+    size_t length = (size_t)this->num_projectors * (size_t)pbasis * (size_t)num_kcopies;
+    this->forward_beta = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * length);
     if(ct.stress)
     {
-        if(this->forward_beta_r[0]) fftw_free(this->forward_beta_r[0]); 
-        if(this->forward_beta_r[1]) fftw_free(this->forward_beta_r[1]); 
-        if(this->forward_beta_r[2]) fftw_free(this->forward_beta_r[2]); 
-        this->forward_beta_r[0] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * pbasis * ct.num_kpts_pe);
-        this->forward_beta_r[1] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * pbasis * ct.num_kpts_pe);
-        this->forward_beta_r[2] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * pbasis * ct.num_kpts_pe);
+        this->forward_beta_r[0] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * length);
+        this->forward_beta_r[1] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * length);
+        this->forward_beta_r[2] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * length);
     }
 
     if (this->forward_beta == NULL)
         throw RmgFatalException() << "cannot allocate mem "<< " at line " << __LINE__ << "\n";
 
+    double kzero[3] = {0.0, 0.0, 0.0};
+    for(int kpt = 0; kpt < num_kcopies; kpt++)
+    {
+        size_t index_ptr = (size_t)kpt * (size_t)this->num_projectors * (size_t)pbasis;
+        std::complex<double> *betaptr_r[3] = {NULL, NULL, NULL};
+        if(ct.stress)
+        {
+            for(int ixyz = 0;ixyz < 3;ixyz++)
+                betaptr_r[ixyz] = (std::complex<double> *)&this->forward_beta_r[ixyz][index_ptr];
+        }
+        double *kvec = this->forward_beta_k_independent ? kzero : ct.kp[kpt + pct.kstart].kvec;
+        this->GetDelocalizedBeta(kvec, (std::complex<double> *)&this->forward_beta[index_ptr], betaptr_r);
+    }
+
+} /* end InitDelocalizedWeight */
+
 
+// Generates the forward transform of all projectors of this species for the k-point
+// kvec. beta must hold num_projectors * pbasis values. If the entries of beta_r
+// are not NULL the x*beta, y*beta, z*beta projectors needed for the stress are also generated.
+void SPECIES::GetDelocalizedBeta (double *kvec, std::complex<double> *beta, std::complex<double> *beta_r[3])
+{
+    std::complex<double> I_t(0.0, 1.0);
+    std::complex<double> *IL =  new std::complex<double>[ct.max_l+2];
+    for(int L = 0; L <  ct.max_l+2; L++) IL[L] = std::pow(-I_t, L);
+    std::complex<double> phase = PI * I_t;
+    phase = std::exp(phase);
+
+    int lmax = ct.max_l + 1;
+    int num_lm = (lmax + 1) * (lmax + 1);
+    int num_LM2 = (2*lmax + 1) * (2*lmax + 1);
+    int *lpx = this->cg_lpx.data();
+    int *lpl = this->cg_lpl.data();
+    double *ap = this->cg_ap.data();
+
+    Pw *pwave = this->prj_pwave;
+    int pbasis = pwave->Grid->get_P0_BASIS(1);
+    int dimx = pwave->Grid->get_PX0_GRID(1);
+    int dimy = pwave->Grid->get_PY0_GRID(1);
+    int dimz = pwave->Grid->get_PZ0_GRID(1);
+    int ixstart = pwave->Grid->get_PX_OFFSET(1);
+    int iystart = pwave->Grid->get_PY_OFFSET(1);
+    int izstart = pwave->Grid->get_PZ_OFFSET(1);
+    double vol = pwave->L->get_omega();
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double tpiba2 = tpiba * tpiba;
+    double gcut = sqrt(pwave->gcut*tpiba2);
+    bool do_stress = (beta_r != NULL) && (beta_r[0] != NULL);
 
     for(int iproj = 0; iproj < this->num_projectors; iproj++)
     {
-        proj = proj_iter[iproj];
+        int pip = this->proj_ip[iproj];
+        int pl = this->proj_l[iproj];
+        int pm = this->proj_m[iproj];
         double ax[3];
 
-        for(int kpt = 0; kpt <ct.num_kpts_pe; kpt++)
+        std::complex<double> *betaptr = &beta[(size_t)iproj * (size_t)pbasis];
+        std::complex<double> *betaptr_r[3];
+
+        std::fill(betaptr, betaptr + pbasis, 0.0);
+        if(do_stress)
         {
-            int kpt1 = kpt + pct.kstart;
-            size_t index_ptr = kpt *this->num_projectors * pbasis + proj.proj_index * pbasis;
-            std::complex<double> *betaptr = (std::complex<double> *)&this->forward_beta[index_ptr];
-            std::complex<double> *betaptr_r[3];
-
-//            for(int idx = 0;idx < pbasis;idx++) betaptr[idx] = 0.0;
-            std::fill(betaptr, betaptr + pbasis, 0.0);
-            if(ct.stress)
+            for(int ixyz = 0;ixyz < 3;ixyz++)
             {
-                betaptr_r[0] = (std::complex<double> *)&this->forward_beta_r[0][index_ptr];
-                betaptr_r[1] = (std::complex<double> *)&this->forward_beta_r[1][index_ptr];
-                betaptr_r[2] = (std::complex<double> *)&this->forward_beta_r[2][index_ptr];
-                for(int idx = 0;idx < pbasis;idx++)
-                {
-                    betaptr_r[0][idx] = 0.0;
-                    betaptr_r[1][idx] = 0.0;
-                    betaptr_r[2][idx] = 0.0;
-                }
+                betaptr_r[ixyz] = &beta_r[ixyz][(size_t)iproj * (size_t)pbasis];
+                std::fill(betaptr_r[ixyz], betaptr_r[ixyz] + pbasis, 0.0);
             }
+        }
 
-            for(int idx = 0;idx < pbasis;idx++)
+        for(int idx = 0;idx < pbasis;idx++)
+        {
+            if(!pwave->gmask[idx]) continue;
+            ax[0] = pwave->g[idx].a[0] * tpiba;
+            ax[1] = pwave->g[idx].a[1] * tpiba;
+            ax[2] = pwave->g[idx].a[2] * tpiba;
+
+            ax[0] += kvec[0];
+            ax[1] += kvec[1];
+            ax[2] += kvec[2];
+
+            double gval = sqrt(ax[0]*ax[0] + ax[1]*ax[1] + ax[2]*ax[2]);
+            if(gval >= gcut) continue;
+            double t1 = AtomicInterpolateInline_Ggrid(this->beta_g[pip].get(), gval);
+            betaptr[idx] = IL[pl] * Ylm(pl, pm, ax) * t1;
+
+            // l2m_i: l*l + m for the first angular momentum
+            if(!do_stress) continue;
+            int l2mi = pl * pl + pm;
+            for(int l2mj = 1; l2mj < 4; l2mj++)     // index for cubic harmonics x, y, z
             {
-                if(!pwave->gmask[idx]) continue;
-                ax[0] = pwave->g[idx].a[0] * tpiba;
-                ax[1] = pwave->g[idx].a[1] * tpiba;
-                ax[2] = pwave->g[idx].a[2] * tpiba;
-
-                ax[0] += ct.kp[kpt1].kvec[0];
-                ax[1] += ct.kp[kpt1].kvec[1];
-                ax[2] += ct.kp[kpt1].kvec[2];
-
-                double gval = sqrt(ax[0]*ax[0] + ax[1]*ax[1] + ax[2]*ax[2]);
-                if(gval >= gcut) continue;
-                double t1 = AtomicInterpolateInline_Ggrid(this->beta_g[proj.ip].get(), gval);
-                betaptr[idx] = IL[proj.l] * Ylm(proj.l, proj.m, ax) * t1;
-
-                // l2m_i: l*l + m for the first angular momentum
-                if(!ct.stress) continue;
-                int l2mi = proj.l * proj.l + proj.m;
-                for(int l2mj = 1; l2mj < 4; l2mj++)     // index for cubic harmonics x, y, z
+                for (int LM = 0; LM < lpx[l2mi * num_lm + l2mj]; LM++)
                 {
-                    for (int LM = 0; LM < lpx[l2mi * num_lm + l2mj]; LM++)
-                    {
-                        int L2M = lpl[(l2mi * num_lm + l2mj) * num_LM2 + LM];   // L*L + M for one LM harmonic function 
-
-                        int L, M;
-                        if(L2M == 0)
-                            L = 0;
-                        else if (L2M < 4)
-                            L = 1;
-                        else if (L2M < 9)
-                            L = 2;
-                        else
-                            L = (int)sqrt(L2M + 0.1);
-
-                        M = L2M - L * L;
-                        double t2 = AtomicInterpolateInline_Ggrid(this->rbeta_g[proj.ip][L], gval);
-                        betaptr_r[l2mj-1][idx] += IL[L] * Ylm(L, M, ax) * t2 * ap[L2M * num_lm * num_lm + l2mi * num_lm + l2mj];
-                    }
+                    int L2M = lpl[(l2mi * num_lm + l2mj) * num_LM2 + LM];   // L*L + M for one LM harmonic function 
+
+                    int L, M;
+                    if(L2M == 0)
+                        L = 0;
+                    else if (L2M < 4)
+                        L = 1;
+                    else if (L2M < 9)
+                        L = 2;
+                    else
+                        L = (int)sqrt(L2M + 0.1);
+
+                    M = L2M - L * L;
+                    double t2 = AtomicInterpolateInline_Ggrid(this->rbeta_g[pip][L], gval);
+                    betaptr_r[l2mj-1][idx] += IL[L] * Ylm(L, M, ax) * t2 * ap[L2M * num_lm * num_lm + l2mi * num_lm + l2mj];
                 }
             }
-            // Shift atom to the center instead of corner.
-            for(int ix = 0; ix < dimx; ix++)
+        }
+        // Shift atom to the center instead of corner.
+        for(int ix = 0; ix < dimx; ix++)
+        {
+            for(int iy = 0; iy < dimy; iy++)
             {
-                for(int iy = 0; iy < dimy; iy++)
+                for(int iz = 0; iz < dimz; iz++)
                 {
-                    for(int iz = 0; iz < dimz; iz++)
-                    {
-                        int idx = ix * dimy * dimz + iy * dimz + iz;
-                        std::complex<double> phaseshift =std::pow(phase, ix + ixstart + iy + iystart + iz + izstart);
-                        betaptr[idx] *= phaseshift/vol;
-                        if(!ct.stress) continue;
-                        betaptr_r[0][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
-                        betaptr_r[1][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
-                        betaptr_r[2][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
-
-                        // sqrt(3/4pi) is the normlaized constant for hamonic x, y, z and we only want non-normalized x, y, z
-                    }
+                    int idx = ix * dimy * dimz + iy * dimz + iz;
+                    std::complex<double> phaseshift =std::pow(phase, ix + ixstart + iy + iystart + iz + izstart);
+                    betaptr[idx] *= phaseshift/vol;
+                    if(!do_stress) continue;
+                    betaptr_r[0][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
+                    betaptr_r[1][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
+                    betaptr_r[2][idx] *= phaseshift/vol / std::sqrt(3.0/fourPI);
+
+                    // sqrt(3/4pi) is the normlaized constant for hamonic x, y, z and we only want non-normalized x, y, z
                 }
             }
-
         }
 
     }  // end for
 
     delete [] IL;
 
-} /* end InitDelocalizedWeight */
+} /* end GetDelocalizedBeta */
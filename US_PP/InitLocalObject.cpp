@@ -44,6 +44,8 @@
 #include "Atomic.h"
 #include "RmgException.h"
 #include "transition.h"
+#include <array>
+#include <unordered_map>
 
 // This is used to initialize 4 types of atomic data structures that live
 // on the high density grid. Each object can have a sum representation
@@ -68,6 +70,103 @@ void InitLocalObject(double *sumobject, int object_type)
     InitLocalObject(sumobject, dum_array, object_type, false);
 }
 
+// Value of a local object of species sp at distance r from the ion.
+static double LocalObjectValue(SPECIES *sp, int object_type, double r)
+{
+    switch(object_type) 
+    {
+        case ATOMIC_LOCAL_PP:
+            return AtomicInterpolateInline (&sp->localig[0], r);
+
+        case ATOMIC_RHO:
+            return AtomicInterpolateInline (&sp->arho_lig[0], r);
+
+        case ATOMIC_RHOCOMP:
+            {
+                double rc2 = sp->rc * sp->rc;
+                double rcnorm = 1.0 / (sp->rc * sp->rc * sp->rc * pow (PI, 1.5));
+                return sp->zvalence * exp (-r * r / rc2) * rcnorm;
+            }
+
+        case ATOMIC_RHOCORE: 
+        case ATOMIC_RHOCORE_STRESS: 
+            if(sp->nlccflag) return AtomicInterpolateInline (&sp->rhocorelig[0], r);
+            return 0.0;
+
+        default:
+            throw RmgFatalException() << "Undefined local object type" << 
+                " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
+
+// Calls op(idx, r, cx) for each point of this processor's part of the fine grid that
+// lies within the local radius of species sp around crystal position xtal. idx is the
+// local grid index, r the distance from the ion and cx the cartesian displacement.
+template <typename Op> static void ForEachLocalPoint(SPECIES *sp, double *xtal, Op op)
+{
+    double hxxgrid = get_hxxgrid();
+    double hyygrid = get_hyygrid();
+    double hzzgrid = get_hzzgrid();
+    int FPY0_GRID = get_FPY0_GRID();
+    int FPZ0_GRID = get_FPZ0_GRID();
+    int FNX_GRID = get_FNX_GRID();
+    int FNY_GRID = get_FNY_GRID();
+    int FNZ_GRID = get_FNZ_GRID();
+
+    int ilow = get_FPX_OFFSET();
+    int jlow = get_FPY_OFFSET();
+    int klow = get_FPZ_OFFSET();
+    int ihi = ilow + get_FPX0_GRID();
+    int jhi = jlow + FPY0_GRID;
+    int khi = klow + FPZ0_GRID;
+
+    int dimx =  sp->lradius/(hxxgrid*get_xside());
+    int dimy =  sp->lradius/(hyygrid*get_yside());
+    int dimz =  sp->lradius/(hzzgrid*get_zside());
+
+    dimx = dimx * 2 + 1;
+    dimy = dimy * 2 + 1;
+    dimz = dimz * 2 + 1;
+
+    int xstart = xtal[0] / hxxgrid - dimx/2;
+    int xend = xstart + dimx;
+    int ystart = xtal[1] / hyygrid - dimy/2;
+    int yend = ystart + dimy;
+    int zstart = xtal[2] / hzzgrid - dimz/2;
+    int zend = zstart + dimz;
+
+    for (int ix = xstart; ix < xend; ix++)
+    {
+        // fold the grid into the unit cell
+        // maxium fold 20 times, local potential can extend to 20-1 unit cell
+        int ixx = (ix + 20 * FNX_GRID) % FNX_GRID;
+        if(ixx < ilow || ixx >= ihi) continue;
+
+        for (int iy = ystart; iy < yend; iy++)
+        {
+            int iyy = (iy + 20 * FNY_GRID) % FNY_GRID;
+            if(iyy < jlow || iyy >= jhi) continue;
+
+            for (int iz = zstart; iz < zend; iz++)
+            {
+                int izz = (iz + 20 * FNZ_GRID) % FNZ_GRID;
+                if(izz < klow || izz >= khi) continue;
+
+                int idx = (ixx-ilow) * FPY0_GRID * FPZ0_GRID + (iyy-jlow) * FPZ0_GRID + izz-klow;
+                double x[3], cx[3];
+                x[0] = ix * hxxgrid - xtal[0];
+                x[1] = iy * hyygrid - xtal[1];
+                x[2] = iz * hzzgrid - xtal[2];
+                double r = Rmg_L.metric (x);
+                if(r > sp->lradius) continue;
+                Rmg_L.to_cartesian(x, cx);
+
+                op(idx, r, cx);
+            }
+        }
+    }
+}
+
 void InitLocalObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject)
 {
 
@@ -218,136 +317,38 @@ void InitLocalObject (double *sumobject, double * &lobject, int object_type, boo
 
             /* Get species type */
             SPECIES *sp = &Species[iptr->species];
-            double Zv = sp->zvalence;
-            double rc = sp->rc;
-            double rc2 = rc * rc;
-            double rcnorm = rc * rc * rc * pow (PI, 1.5);
-            rcnorm = 1.0 / rcnorm;
-
-            int dimx =  sp->lradius/(hxxgrid*xside);
-            int dimy =  sp->lradius/(hyygrid*yside);
-            int dimz =  sp->lradius/(hzzgrid*zside);
 
-            dimx = dimx * 2 + 1;
-            dimy = dimy * 2 + 1;
-            dimz = dimz * 2 + 1;
+            ForEachLocalPoint(sp, iptr->xtal, [&](int idx, double r, double *cx) {
 
+                double t1 = LocalObjectValue(sp, object_type, r);
 
-            int xstart = iptr->xtal[0] / hxxgrid - dimx/2;
-            int xend = xstart + dimx;
-            int ystart = iptr->xtal[1] / hyygrid - dimy/2;
-            int yend = ystart + dimy;
-            int zstart = iptr->xtal[2] / hzzgrid - dimz/2;
-            int zend = zstart + dimz;
+                if( (ct.nspin == 2) && (object_type == ATOMIC_RHO) && !compute_lobject)
+                { 
+                    if (pct.spinpe == 0)
+                        sumobj_omp[idx] += t1 * (0.5 + iptr->init_spin_rho) ;
+                    else
+                        sumobj_omp[idx] += t1 * (0.5 - iptr->init_spin_rho) ;
 
-            for (int ix = xstart; ix < xend; ix++)
-            {
-                // fold the grid into the unit cell
-                // maxium fold 20 times, local potential can extend to 20-1 unit cell
-                int ixx = (ix + 20 * FNX_GRID) % FNX_GRID;
-                if(ixx >= ilow && ixx < ihi)
+                }
+                else if( (ct.nspin == 4) && (object_type == ATOMIC_RHO) && !compute_lobject)
+                { 
+                    sumobj_omp[idx] += t1;
+                    sumobj_omp[idx+FP0_BASIS] += t1 * iptr->init_spin_x   ;
+                    sumobj_omp[idx+2*FP0_BASIS] += t1 * iptr->init_spin_y ;
+                    sumobj_omp[idx+3*FP0_BASIS] += t1 * iptr->init_spin_z ;
+                }
+                else if(object_type == ATOMIC_RHOCORE_STRESS)
                 {
-
-                    for (int iy = ystart; iy < yend; iy++)
-                    {
-                        // fold the grid into the unit cell
-                        int iyy = (iy + 20 * FNY_GRID) % FNY_GRID;
-                        if(iyy >= jlow && iyy < jhi)
-                        {
-                            for (int iz = zstart; iz < zend; iz++)
-                            {
-                                // fold the grid into the unit cell
-                                int izz = (iz + 20 * FNZ_GRID) % FNZ_GRID;
-                                if(izz >= klow && izz < khi)
-                                {
-
-                                    int idx = (ixx-ilow) * FPY0_GRID * FPZ0_GRID + (iyy-jlow) * FPZ0_GRID + izz-klow;
-                                    double x[3], cx[3];
-                                    x[0] = ix * hxxgrid - iptr->xtal[0];
-                                    x[1] = iy * hyygrid - iptr->xtal[1];
-                                    x[2] = iz * hzzgrid - iptr->xtal[2];
-                                    double r = Rmg_L.metric (x);
-                                    Rmg_L.to_cartesian(x, cx);
-
-                                    if(r > sp->lradius) continue;
-                                    double t1;
-
-                                    switch(object_type) 
-                                    {
-                                        case ATOMIC_LOCAL_PP:
-                                            t1= AtomicInterpolateInline (&sp->localig[0], r);
-                                            break;
-
-                                        case ATOMIC_RHO:
-                                            t1= AtomicInterpolateInline (&sp->arho_lig[0], r);
-                                            break;
-
-                                        case ATOMIC_RHOCOMP:
-                                            t1= Zv * exp (-r * r / rc2) * rcnorm;
-                                            break;
-
-                                        case ATOMIC_RHOCORE: 
-                                            if(sp->nlccflag) 
-                                            {
-                                                t1 = AtomicInterpolateInline (&sp->rhocorelig[0], r);
-                                            }
-                                            else
-                                            {
-                                                t1 = 0.0;
-                                            }
-                                            break;
-                                        case ATOMIC_RHOCORE_STRESS: 
-                                            if(sp->nlccflag) 
-                                            {
-                                                t1 = AtomicInterpolateInline (&sp->rhocorelig[0], r);
-                                            }
-                                            else
-                                            {
-                                                t1 = 0.0;
-                                            }
-                                            break;
-
-                                        default:
-                                            throw RmgFatalException() << "Undefined local object type" << 
-                                                " in " << __FILE__ << " at line " << __LINE__ << "\n";
-
-                                    }
-
-                                    if( (ct.nspin == 2) && (object_type == ATOMIC_RHO) && !compute_lobject)
-                                    { 
-                                        if (pct.spinpe == 0)
-                                            sumobj_omp[idx] += t1 * (0.5 + iptr->init_spin_rho) ;
-                                        else
-                                            sumobj_omp[idx] += t1 * (0.5 - iptr->init_spin_rho) ;
-
-                                    }
-                                    else if( (ct.nspin == 4) && (object_type == ATOMIC_RHO) && !compute_lobject)
-                                    { 
-                                        sumobj_omp[idx] += t1;
-                                        sumobj_omp[idx+FP0_BASIS] += t1 * iptr->init_spin_x   ;
-                                        sumobj_omp[idx+2*FP0_BASIS] += t1 * iptr->init_spin_y ;
-                                        sumobj_omp[idx+3*FP0_BASIS] += t1 * iptr->init_spin_z ;
-                                    }
-                                    else if(object_type == ATOMIC_RHOCORE_STRESS)
-                                    {
-                                        sumobj_omp[0*FP0_BASIS + idx] += t1* cx[0];
-                                        sumobj_omp[1*FP0_BASIS + idx] += t1* cx[1];
-                                        sumobj_omp[2*FP0_BASIS + idx] += t1* cx[2];
-                                    }
-                                    else
-                                    {
-                                        sumobj_omp[idx] += t1;
-                                    }
-                                    if(compute_lobject) lobject[(size_t)ion1 * (size_t)FP0_BASIS + idx] += t1;
-
-                                }                           /* end for */
-
-                            }
-                        }
-                    }
+                    sumobj_omp[0*FP0_BASIS + idx] += t1* cx[0];
+                    sumobj_omp[1*FP0_BASIS + idx] += t1* cx[1];
+                    sumobj_omp[2*FP0_BASIS + idx] += t1* cx[2];
                 }
-
-            }
+                else
+                {
+                    sumobj_omp[idx] += t1;
+                }
+                if(compute_lobject) lobject[(size_t)ion1 * (size_t)FP0_BASIS + idx] += t1;
+            });
         }
 
 #pragma omp critical
@@ -410,3 +411,104 @@ void InitLocalObject (double *sumobject, double * &lobject, int object_type, boo
     if(object_type == ATOMIC_LOCAL_PP) init_efield (sumobject);
 
 }   // end InitLocalObject
+
+
+
+// Adds sign * (contribution of ion at crystal position xtal) to sumobject for each entry
+// in the lists.
+static void AccumulateLocalObject (double *sumobject, int object_type, std::vector<int> &ions,
+                                   std::vector<std::array<double, 3>> &positions, std::vector<double> &signs)
+{
+    int FP0_BASIS = get_FP0_BASIS();
+
+#pragma omp parallel 
+    {
+        double *sumobj_omp = new double[FP0_BASIS](); 
+#pragma omp for schedule(static, 1) nowait
+        for (size_t i = 0; i < ions.size(); i++)
+        {
+            SPECIES *sp = &Species[Atoms[ions[i]].species];
+            double sign = signs[i];
+            ForEachLocalPoint(sp, positions[i].data(), [&](int idx, double r, double *cx) {
+                sumobj_omp[idx] += sign * LocalObjectValue(sp, object_type, r);
+            });
+        }
+
+#pragma omp critical
+        for(int idx = 0; idx < FP0_BASIS; idx++) sumobject[idx] += sumobj_omp[idx];
+        delete [] sumobj_omp;
+    }
+}
+
+
+// Incremental version of InitLocalObject used during MD and relaxations. The unprocessed
+// sum over ions is kept between calls and only the ions listed in moved are updated by
+// subtracting their contribution at Atoms[ion].reinit_xtal and adding it at Atoms[ion].xtal.
+// The sum is built from all ions on the first call for an object type or when rebuild is
+// set, which the caller must do whenever the cell or grid has changed. Caller is
+// responsible for updating reinit_xtal afterwards.
+void UpdateLocalObject (double *sumobject, int object_type, std::vector<int> &moved, bool rebuild)
+{
+    static std::unordered_map<int, std::vector<double>> rawsums;
+    int FP0_BASIS = get_FP0_BASIS();
+
+    std::vector<double> &raw = rawsums[object_type];
+    std::vector<int> ions;
+    std::vector<std::array<double, 3>> positions;
+    std::vector<double> signs;
+
+    if(rebuild || (raw.size() != (size_t)FP0_BASIS))
+    {
+        raw.assign(FP0_BASIS, 0.0);
+        if(object_type == ATOMIC_RHOCOMP)
+        {
+            int npes = get_PE_X() * get_PE_Y() * get_PE_Z();
+            double t1 = ct.background_charge / (double)FP0_BASIS / get_vel_f() / (double)npes;
+            for (int idx = 0; idx < FP0_BASIS; idx++) raw[idx] = t1;
+        }
+        for (int ion = 0; ion < ct.num_ions; ion++)
+        {
+            ions.push_back(ion);
+            positions.push_back({Atoms[ion].xtal[0], Atoms[ion].xtal[1], Atoms[ion].xtal[2]});
+            signs.push_back(1.0);
+        }
+    }
+    else
+    {
+        for(auto ion : moved)
+        {
+            ions.push_back(ion);
+            positions.push_back({Atoms[ion].reinit_xtal[0], Atoms[ion].reinit_xtal[1], Atoms[ion].reinit_xtal[2]});
+            signs.push_back(-1.0);
+            ions.push_back(ion);
+            positions.push_back({Atoms[ion].xtal[0], Atoms[ion].xtal[1], Atoms[ion].xtal[2]});
+            signs.push_back(1.0);
+        }
+    }
+
+    AccumulateLocalObject (raw.data(), object_type, ions, positions, signs);
+
+    for(int idx = 0;idx < FP0_BASIS;idx++) sumobject[idx] = raw[idx];
+
+    // Same post processing as InitLocalObject
+    if(object_type == ATOMIC_RHOCORE) 
+    {
+        for (int idx = 0; idx < FP0_BASIS; idx++) 
+        {
+            if(sumobject[idx] < 0.0) sumobject[idx] = 0.0;
+        }
+    }
+
+    if(object_type == ATOMIC_RHOCOMP)
+    {
+        ct.crho = 0.0;
+        for (int idx = 0; idx < FP0_BASIS; idx++) ct.crho += sumobject[idx];
+        ct.crho = ct.crho * get_vel_f();
+        ct.crho = real_sum_all (ct.crho, pct.grid_comm);
+    }
+
+    if(ct.runflag == RESTART || ct.runflag == Restart_TDDFT || ct.forceflag == TDDFT) return;
+
+    if(object_type == ATOMIC_LOCAL_PP) init_efield (sumobject);
+
+}   // end UpdateLocalObject
@@ -40,10 +40,18 @@ void SPECIES::InitLocalizedWeight (void)
     
     RmgTimer *RT1= new RmgTimer("Weight: phase and set");
 
+    // With k-point batched weights only the k-independent transform is stored and
+    // the Bloch phase is applied in real space when the weights are generated.
+    int num_kw = ct.num_kpts_pe;
+    if(ct.batched_kpoint_weights) num_kw = 1;
+
     int size = this->nldim * this->nldim * this->nldim;
-    this->phase = new fftw_complex[size * ct.num_kpts_pe];
+    this->phase = new fftw_complex[size * num_kw];
     phaseptr = (std::complex<double> *)this->phase;
-    GetPhaseSpecies(this, phaseptr);
+    if(ct.batched_kpoint_weights)
+        for(int idx = 0;idx < size;idx++) phaseptr[idx] = 1.0;
+    else
+        GetPhaseSpecies(this, phaseptr);
     /*Loop over all betas to calculate num of projectors for given species */
     int prjcount = 0;
     for (int ip = 0; ip < this->nbeta; ip++)
@@ -65,7 +73,7 @@ void SPECIES::InitLocalizedWeight (void)
 
     /*This array will store forward fourier transform on the coarse grid for all betas */
     if(this->forward_beta) fftw_free(this->forward_beta);
-    this->forward_beta = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * size * ct.num_kpts_pe);
+    this->forward_beta = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * this->num_projectors * size * num_kw);
 
     if (this->forward_beta == NULL)
         throw RmgFatalException() << "cannot allocate mem "<< " at line " << __LINE__ << "\n";
@@ -94,7 +102,7 @@ void SPECIES::InitLocalizedWeight (void)
         zdim = this->nldim;
         size = xdim * ydim * zdim;
 
-        for(int kpt = 0; kpt <ct.num_kpts_pe; kpt++)
+        for(int kpt = 0; kpt < num_kw; kpt++)
         {
             phaseptr = (std::complex<double> *) &this->phase[kpt * this->nldim * this->nldim * this->nldim];
             betaptr = &this->forward_beta[kpt *this->num_projectors *size + proj.proj_index * size];
@@ -115,7 +123,7 @@ void SPECIES::InitLocalizedWeight (void)
         root = iproj % pct.grid_npes;
         size = this->nldim * this->nldim * this->nldim;
 
-        for(int kpt = 0; kpt <ct.num_kpts_pe; kpt++)
+        for(int kpt = 0; kpt < num_kw; kpt++)
         {
             betaptr = &this->forward_beta[kpt *this->num_projectors *size + proj.proj_index * size];
             MPI_Bcast(betaptr, 2*size, MPI_DOUBLE, root, pct.grid_comm);
@@ -0,0 +1,484 @@
+/*
+ *
+ * Copyright 2019 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <omp.h>
+
+#include "const.h"
+#include "Exxbase.h"
+#include "RmgTimer.h"
+#include "RmgException.h"
+#include "RmgGemm.h"
+#include "transition.h"
+#include "rmgtypedefs.h"
+#include "pe_control.h"
+#include "blas.h"
+
+// Interpolative separable density fitting (ISDF) of the orbital pair products
+// used by exact exchange. A product of orbitals from two sets a and b is written as
+//
+//   psi_a(r)psi_b(r) = sum_mu zeta_mu(r) psi_a(r_mu) psi_b(r_mu)
+//
+// where the N_mu interpolation points r_mu are chosen by weighted k-means. The
+// Coulomb operator is then applied to the N_mu functions zeta_mu instead of to
+// every pair. Apart from those ffts all of the work is done on the domain
+// decomposed grid. Only the gamma point is implemented.
+
+
+// Minimum image squared distance between two points given in crystal coordinates
+static inline double IsdfDist2(const double *x, const double *c, const double *g)
+{
+    double d[3];
+    for(int i = 0;i < 3;i++)
+    {
+        d[i] = x[i] - c[i];
+        d[i] -= std::round(d[i]);
+    }
+    return g[0]*d[0]*d[0] + g[4]*d[1]*d[1] + g[8]*d[2]*d[2] +
+           2.0*(g[1]*d[0]*d[1] + g[2]*d[0]*d[2] + g[5]*d[1]*d[2]);
+}
+
+
+// Selects up to nmu interpolation points for the products of psi_a and psi_b.
+// Grid points are weighted by the product of the two densities and clustered with
+// k-means. The point nearest the centroid of each cluster is returned as a global
+// grid index. Empty clusters are dropped so fewer than nmu points may be returned.
+template <> void Exxbase<double>::IsdfPoints(double *psi_a, int na, double *psi_b, int nb, int nmu, std::vector<int> &points)
+{
+    RmgTimer RT0("5-Functional: Exx isdf points");
+    int my_rank = G.get_rank();
+    int ny = G.get_NY_GRID(1);
+    int nz = G.get_NZ_GRID(1);
+    double hx = 1.0 / (double)G.get_NX_GRID(1);
+    double hy = 1.0 / (double)ny;
+    double hz = 1.0 / (double)nz;
+    int dimy = dimsy[my_rank];
+    int dimz = dimsz[my_rank];
+
+    // Metric tensor of the cell for distances in crystal coordinates
+    double *av[3] = {L.a0, L.a1, L.a2};
+    double g[9];
+    for(int i = 0;i < 3;i++)
+        for(int j = 0;j < 3;j++)
+            g[i*3 + j] = av[i][0]*av[j][0] + av[i][1]*av[j][1] + av[i][2]*av[j][2];
+
+    std::vector<double> w(pbasis);
+#pragma omp parallel for
+    for(int idx = 0;idx < pbasis;idx++)
+    {
+        double ra = 0.0, rb = 0.0;
+        for(int st = 0;st < na;st++) ra += psi_a[(size_t)st*pbasis + idx] * psi_a[(size_t)st*pbasis + idx];
+        for(int st = 0;st < nb;st++) rb += psi_b[(size_t)st*pbasis + idx] * psi_b[(size_t)st*pbasis + idx];
+        w[idx] = ra * rb;
+    }
+
+    // Points with negligible weight can not move a centroid so they are skipped
+    double wmax = *std::max_element(w.begin(), w.end());
+    MPI_Allreduce(MPI_IN_PLACE, &wmax, 1, MPI_DOUBLE, MPI_MAX, G.comm);
+    std::vector<int> cand;
+    for(int idx = 0;idx < pbasis;idx++) if(w[idx] > 1.0e-8 * wmax) cand.push_back(idx);
+    int ncand = cand.size();
+
+    std::vector<double> xc(3*ncand);
+    std::vector<int> gidx(ncand);
+    for(int p = 0;p < ncand;p++)
+    {
+        int ix = cand[p] / (dimy*dimz) + xoffsets[my_rank];
+        int iy = (cand[p] / dimz) % dimy + yoffsets[my_rank];
+        int iz = cand[p] % dimz + zoffsets[my_rank];
+        xc[3*p] = ix * hx;
+        xc[3*p + 1] = iy * hy;
+        xc[3*p + 2] = iz * hz;
+        gidx[p] = ix*ny*nz + iy*nz + iz;
+    }
+
+    // Initial centroids are sampled with probability proportional to the weight. The
+    // same random stream is used on all ranks and each sample is set by the rank that
+    // owns that part of the cumulative weight.
+    double wloc = 0.0, wstart = 0.0, wtot = 0.0;
+    for(int p = 0;p < ncand;p++) wloc += w[cand[p]];
+    MPI_Exscan(&wloc, &wstart, 1, MPI_DOUBLE, MPI_SUM, G.comm);
+    if(my_rank == 0) wstart = 0.0;
+    MPI_Allreduce(&wloc, &wtot, 1, MPI_DOUBLE, MPI_SUM, G.comm);
+
+    std::mt19937 gen(5489);
+    std::uniform_real_distribution<double> udist(0.0, 1.0);
+    std::vector<double> samples(nmu);
+    for(int k = 0;k < nmu;k++) samples[k] = udist(gen) * wtot;
+
+    std::vector<double> cen(3*nmu, 0.0);
+    std::vector<int> found(nmu, 0);
+    double csum = wstart;
+    std::vector<double> cum(ncand);
+    for(int p = 0;p < ncand;p++)
+    {
+        csum += w[cand[p]];
+        cum[p] = csum;
+    }
+    for(int k = 0;k < nmu;k++)
+    {
+        if(ncand == 0 || samples[k] < wstart || samples[k] >= csum) continue;
+        int p = std::upper_bound(cum.begin(), cum.end(), samples[k]) - cum.begin();
+        p = std::min(p, ncand - 1);
+        for(int i = 0;i < 3;i++) cen[3*k + i] = xc[3*p + i];
+        found[k] = 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, cen.data(), 3*nmu, MPI_DOUBLE, MPI_SUM, G.comm);
+    MPI_Allreduce(MPI_IN_PLACE, found.data(), nmu, MPI_INT, MPI_SUM, G.comm);
+    int nk = 0;
+    for(int k = 0;k < nmu;k++)
+    {
+        if(found[k] != 1) continue;
+        for(int i = 0;i < 3;i++) cen[3*nk + i] = cen[3*k + i];
+        nk++;
+    }
+    cen.resize(3*nk);
+
+    std::vector<int> owner(ncand, -1);
+    std::vector<double> sums(4*nk);
+    for(int iter = 0;iter < 30;iter++)
+    {
+        int changed = 0;
+#pragma omp parallel for reduction(+:changed)
+        for(int p = 0;p < ncand;p++)
+        {
+            int best = 0;
+            double dbest = 1.0e30;
+            for(int k = 0;k < nk;k++)
+            {
+                double d = IsdfDist2(&xc[3*p], &cen[3*k], g);
+                if(d < dbest)
+                {
+                    dbest = d;
+                    best = k;
+                }
+            }
+            if(owner[p] != best) changed++;
+            owner[p] = best;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_SUM, G.comm);
+        if(iter > 0 && changed == 0) break;
+
+        // Displacements are taken relative to the current centroid so that clusters
+        // which straddle a cell boundary are averaged correctly.
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for(int p = 0;p < ncand;p++)
+        {
+            int k = owner[p];
+            double wp = w[cand[p]];
+            for(int i = 0;i < 3;i++)
+            {
+                double d = xc[3*p + i] - cen[3*k + i];
+                sums[4*k + i] += wp * (d - std::round(d));
+            }
+            sums[4*k + 3] += wp;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, sums.data(), 4*nk, MPI_DOUBLE, MPI_SUM, G.comm);
+        for(int k = 0;k < nk;k++)
+        {
+            if(sums[4*k + 3] <= 0.0) continue;
+            for(int i = 0;i < 3;i++)
+            {
+                double c = cen[3*k + i] + sums[4*k + i] / sums[4*k + 3];
+                cen[3*k + i] = c - std::floor(c);
+            }
+        }
+    }
+
+    // Grid point of each cluster that is closest to its centroid
+    struct DoubleInt { double d; int idx; };
+    std::vector<DoubleInt> near(nk, {1.0e30, -1});
+    for(int p = 0;p < ncand;p++)
+    {
+        int k = owner[p];
+        double d = IsdfDist2(&xc[3*p], &cen[3*k], g);
+        if(d < near[k].d) near[k] = {d, gidx[p]};
+    }
+    MPI_Allreduce(MPI_IN_PLACE, near.data(), nk, MPI_DOUBLE_INT, MPI_MINLOC, G.comm);
+
+    points.clear();
+    for(int k = 0;k < nk;k++) if(near[k].idx >= 0) points.push_back(near[k].idx);
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+}
+
+template <> void Exxbase<std::complex<double>>::IsdfPoints(std::complex<double> *psi_a, int na, std::complex<double> *psi_b, int nb, int nmu, std::vector<int> &points)
+{
+    throw RmgFatalException() << "ISDF exact exchange is only implemented for the gamma point.\n";
+}
+
+
+// Fits the products of psi_a and psi_b. On return theta holds the local part of the
+// interpolation vectors zeta_mu (pbasis x nmu) and ca, cb hold the orbital values at
+// the interpolation points (nmu x na and nmu x nb). Returns nmu.
+template <> int Exxbase<double>::IsdfFit(double *psi_a, int na, double *psi_b, int nb,
+        std::vector<double> &theta, std::vector<double> &ca, std::vector<double> &cb)
+{
+    int nmu = (int)(ct.isdf_rank_factor * (double)std::max(na, nb));
+    nmu = std::min(nmu, na*nb);
+    nmu = std::min(nmu, (int)G.get_GLOBAL_BASIS(1));
+
+    std::vector<int> points;
+    IsdfPoints(psi_a, na, psi_b, nb, nmu, points);
+    nmu = points.size();
+
+    RmgTimer RT0("5-Functional: Exx isdf fit");
+    int my_rank = G.get_rank();
+    int ny = G.get_NY_GRID(1);
+    int nz = G.get_NZ_GRID(1);
+    int dimx = dimsx[my_rank], dimy = dimsy[my_rank], dimz = dimsz[my_rank];
+
+    // Orbital values at the interpolation points, filled in by the owning rank
+    ca.assign((size_t)nmu * (size_t)na, 0.0);
+    cb.assign((size_t)nmu * (size_t)nb, 0.0);
+    for(int mu = 0;mu < nmu;mu++)
+    {
+        int ix = points[mu] / (ny*nz) - xoffsets[my_rank];
+        int iy = (points[mu] / nz) % ny - yoffsets[my_rank];
+        int iz = points[mu] % nz - zoffsets[my_rank];
+        if(ix < 0 || ix >= dimx || iy < 0 || iy >= dimy || iz < 0 || iz >= dimz) continue;
+        size_t idx = (size_t)ix*dimy*dimz + (size_t)iy*dimz + (size_t)iz;
+        for(int st = 0;st < na;st++) ca[(size_t)st*nmu + mu] = psi_a[(size_t)st*pbasis + idx];
+        for(int st = 0;st < nb;st++) cb[(size_t)st*nmu + mu] = psi_b[(size_t)st*pbasis + idx];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, ca.data(), nmu*na, MPI_DOUBLE, MPI_SUM, G.comm);
+    MPI_Allreduce(MPI_IN_PLACE, cb.data(), nmu*nb, MPI_DOUBLE, MPI_SUM, G.comm);
+
+    // The least squares fit is theta = Z C^T (C C^T)^-1 with Z the pair products
+    // and C the pair products at the points. Both factor into elementwise products
+    // of single set quantities so no pair is ever formed explicitly.
+    double one = 1.0, zero = 0.0;
+    std::vector<double> pa((size_t)pbasis * nmu), pb((size_t)pbasis * nmu);
+    RmgGemm("n", "t", pbasis, nmu, na, one, psi_a, pbasis, ca.data(), nmu, zero, pa.data(), pbasis);
+    RmgGemm("n", "t", pbasis, nmu, nb, one, psi_b, pbasis, cb.data(), nmu, zero, pb.data(), pbasis);
+    for(size_t idx = 0;idx < pa.size();idx++) pa[idx] *= pb[idx];
+
+    std::vector<double> ma((size_t)nmu * nmu), mb((size_t)nmu * nmu);
+    RmgGemm("n", "t", nmu, nmu, na, one, ca.data(), nmu, ca.data(), nmu, zero, ma.data(), nmu);
+    RmgGemm("n", "t", nmu, nmu, nb, one, cb.data(), nmu, cb.data(), nmu, zero, mb.data(), nmu);
+    for(size_t idx = 0;idx < ma.size();idx++) ma[idx] *= mb[idx];
+
+    // C C^T is positive semidefinite but may be nearly singular so a pseudo inverse
+    // from its eigendecomposition is used.
+    std::vector<double> eigs(nmu);
+    int lwork = -1, info = 0;
+    double wsize;
+    dsyev("V", "U", &nmu, ma.data(), &nmu, eigs.data(), &wsize, &lwork, &info);
+    lwork = (int)wsize;
+    std::vector<double> work(lwork);
+    dsyev("V", "U", &nmu, ma.data(), &nmu, eigs.data(), work.data(), &lwork, &info);
+    if(info)
+        throw RmgFatalException() << "Error in " << __FILE__ << " at line " << __LINE__ << ". dsyev info = " << info << "\n";
+
+    double emax = eigs[nmu - 1];
+    for(int k = 0;k < nmu;k++)
+    {
+        double s = (eigs[k] > 1.0e-12 * emax) ? 1.0 / std::sqrt(eigs[k]) : 0.0;
+        for(int mu = 0;mu < nmu;mu++) ma[(size_t)k*nmu + mu] *= s;
+    }
+    RmgGemm("n", "t", nmu, nmu, nmu, one, ma.data(), nmu, ma.data(), nmu, zero, mb.data(), nmu);
+
+    theta.resize((size_t)pbasis * nmu);
+    RmgGemm("n", "n", pbasis, nmu, nmu, one, pa.data(), pbasis, mb.data(), nmu, zero, theta.data(), pbasis);
+
+    return nmu;
+}
+
+template <> int Exxbase<std::complex<double>>::IsdfFit(std::complex<double> *psi_a, int na, std::complex<double> *psi_b, int nb,
+        std::vector<std::complex<double>> &theta, std::vector<std::complex<double>> &ca, std::vector<std::complex<double>> &cb)
+{
+    throw RmgFatalException() << "ISDF exact exchange is only implemented for the gamma point.\n";
+}
+
+
+// Applies the Coulomb kernel to the interpolation vectors. Vector mu is gathered
+// onto rank mu % npes which does the fft and scatters the result back, so each rank
+// handles nmu/npes of them. The result is unnormalized in the same way as
+// fftpair_gamma.
+template <> void Exxbase<double>::IsdfCoulomb(std::vector<double> &theta, int nmu, std::vector<double> &wtheta)
+{
+    RmgTimer RT0("5-Functional: Exx isdf coulomb");
+    int npes = G.get_NPES();
+    int my_rank = G.get_rank();
+
+    wtheta.resize((size_t)pbasis * nmu);
+    std::vector<double> ones(pwave->pbasis, 1.0);
+    std::vector<double> gbuf(pwave->pbasis), zg(pwave->pbasis), sbuf(pwave->pbasis);
+    std::vector<double> workbuf(pwave->pbasis);
+    double *p = (double *)fftw_malloc(sizeof(std::complex<double>) * pwave->pbasis);
+    std::vector<MPI_Request> reqs(npes);
+
+    for(int base = 0;base < nmu;base += npes)
+    {
+        int nr = std::min(npes, nmu - base);
+        for(int r = 0;r < nr;r++)
+            MPI_Igatherv(&theta[(size_t)(base + r)*pbasis], pbasis, MPI_DOUBLE,
+                         gbuf.data(), recvcounts.data(), irecvoffsets.data(), MPI_DOUBLE, r, G.comm, &reqs[r]);
+        MPI_Waitall(nr, reqs.data(), MPI_STATUSES_IGNORE);
+
+        if(my_rank < nr)
+        {
+            Unmap(gbuf.data(), zg.data());
+            fftpair_gamma(zg.data(), ones.data(), p, workbuf.data(), gfac, NULL);
+            Remap(p, sbuf.data());
+        }
+
+        for(int r = 0;r < nr;r++)
+            MPI_Iscatterv(sbuf.data(), recvcounts.data(), irecvoffsets.data(), MPI_DOUBLE,
+                          &wtheta[(size_t)(base + r)*pbasis], pbasis, MPI_DOUBLE, r, G.comm, &reqs[r]);
+        MPI_Waitall(nr, reqs.data(), MPI_STATUSES_IGNORE);
+    }
+
+    fftw_free(p);
+}
+
+template <> void Exxbase<std::complex<double>>::IsdfCoulomb(std::vector<std::complex<double>> &theta, int nmu, std::vector<std::complex<double>> &wtheta)
+{
+    throw RmgFatalException() << "ISDF exact exchange is only implemented for the gamma point.\n";
+}
+
+
+// ISDF version of the gamma point Vexx. With the pairs (i,j) fitted for all
+// orbitals i and occupied orbitals j
+//
+//   V_x psi_i(r) = -sum_mu W_mu(r) psi_i(r_mu) sum_j psi_j(r) psi_j(r_mu)
+//
+// where W_mu is the Coulomb potential of zeta_mu. That is two gemms plus nmu ffts
+// rather than nstates*nstates_occ/2 ffts.
+template <> void Exxbase<double>::VexxIsdf(double *vexx, int nstates_occ)
+{
+    RmgTimer RT0("5-Functional: Exx isdf");
+    double scale = - 1.0 / (double)pwave->global_basis;
+
+    std::vector<double> theta, ca, cb, wtheta;
+    int nmu = IsdfFit(psi, nstates, psi, nstates_occ, theta, ca, cb);
+    IsdfCoulomb(theta, nmu, wtheta);
+
+    std::vector<double> pb((size_t)pbasis * nmu);
+    double one = 1.0, zero = 0.0;
+    RmgGemm("n", "t", pbasis, nmu, nstates_occ, one, psi, pbasis, cb.data(), nmu, zero, pb.data(), pbasis);
+    for(size_t idx = 0;idx < pb.size();idx++) pb[idx] *= wtheta[idx];
+
+    std::vector<double> vnew((size_t)nstates * pbasis);
+    RmgGemm("n", "n", pbasis, nstates, nmu, scale, pb.data(), pbasis, ca.data(), nmu, zero, vnew.data(), pbasis);
+
+    double tvexx_RMS = MixVexx(vexx, vnew.data(), 0, nstates, nstates_occ);
+
+    scale = (double)nstates_occ*(double)G.get_GLOBAL_BASIS(1);
+    MPI_Allreduce(MPI_IN_PLACE, &tvexx_RMS, 1, MPI_DOUBLE, MPI_SUM, this->G.comm);
+    MPI_Allreduce(MPI_IN_PLACE, &tvexx_RMS, 1, MPI_DOUBLE, MPI_SUM, pct.spin_comm);
+    vexx_RMS[ct.exx_steps] += sqrt(tvexx_RMS / scale);
+    ct.vexx_rms = vexx_RMS[ct.exx_steps];
+}
+
+template <> void Exxbase<std::complex<double>>::VexxIsdf(std::complex<double> *vexx, int nstates_occ)
+{
+    throw RmgFatalException() << "ISDF exact exchange is only implemented for the gamma point.\n";
+}
+
+
+// ISDF version of the Cholesky factorized integrals for AFQMC. The integrals are
+// (ij|kl) = sum_mu,nu C_mu,ij V_mu,nu C_nu,kl with V_mu,nu = (zeta_mu|zeta_nu), so
+// factoring the nmu x nmu matrix V gives the 3-index vectors directly.
+template <> void Exxbase<double>::Vexx_integrals_isdf(std::string &vfile)
+{
+    RmgTimer RT0("5-Functional: Exx integrals isdf");
+    int nb = ct.qmc_nband;
+
+    std::vector<double> theta, ca, cb, wtheta;
+    int nmu = IsdfFit(psi, nb, psi, nb, theta, ca, cb);
+    IsdfCoulomb(theta, nmu, wtheta);
+
+    // Same normalization as Vexx_integrals_block
+    double a = L.get_omega() / ((double)G.get_GLOBAL_BASIS(1) * (double)pwave->global_basis);
+    double zero = 0.0, one = 1.0;
+    std::vector<double> vmn((size_t)nmu * nmu);
+    RmgGemm("t", "n", nmu, nmu, pbasis, a, theta.data(), pbasis, wtheta.data(), pbasis, zero, vmn.data(), nmu);
+    MPI_Allreduce(MPI_IN_PLACE, vmn.data(), nmu*nmu, MPI_DOUBLE, MPI_SUM, G.comm);
+    for(int i = 0;i < nmu;i++)
+        for(int j = 0;j < i;j++)
+        {
+            double t = 0.5*(vmn[(size_t)i*nmu + j] + vmn[(size_t)j*nmu + i]);
+            vmn[(size_t)i*nmu + j] = t;
+            vmn[(size_t)j*nmu + i] = t;
+        }
+
+    std::vector<double> eigs(nmu);
+    int lwork = -1, info = 0;
+    double wsize;
+    dsyev("V", "U", &nmu, vmn.data(), &nmu, eigs.data(), &wsize, &lwork, &info);
+    lwork = (int)wsize;
+    std::vector<double> work(lwork);
+    dsyev("V", "U", &nmu, vmn.data(), &nmu, eigs.data(), work.data(), &lwork, &info);
+    if(info)
+        throw RmgFatalException() << "Error in " << __FILE__ << " at line " << __LINE__ << ". dsyev info = " << info << "\n";
+
+    // Eigenvectors scaled by sqrt(lambda) in decreasing order, using the same
+    // tolerance and maximum count as VxxIntChol.
+    double tol = 1.0e-5;
+    int cmax = ct.exxchol_max * nb;
+    std::vector<double> lvec;
+    Nchol = 0;
+    for(int k = nmu - 1;k >= 0 && Nchol < cmax;k--)
+    {
+        if(eigs[k] < tol) break;
+        double s = std::sqrt(eigs[k]);
+        for(int mu = 0;mu < nmu;mu++) lvec.push_back(s * vmn[(size_t)k*nmu + mu]);
+        Nchol++;
+    }
+
+    // Cholesky vectors L_n(ij) = sum_mu psi_i(r_mu) psi_j(r_mu) L_mu,n. The pairs
+    // are split over the grid ranks and then summed.
+    size_t nst2 = (size_t)nb * (size_t)nb;
+    size_t nst2_perpe = (nst2 + pct.grid_npes -1)/pct.grid_npes;
+    size_t ij0 = std::min(nst2, (size_t)pct.gridpe * nst2_perpe);
+    size_t ij1 = std::min(nst2, ij0 + nst2_perpe);
+    int nslice = ij1 - ij0;
+    std::vector<double> cpair((size_t)nmu * nslice);
+    for(size_t ij = ij0;ij < ij1;ij++)
+    {
+        int i = ij / nb;
+        int j = ij % nb;
+        for(int mu = 0;mu < nmu;mu++)
+            cpair[(ij - ij0)*nmu + mu] = ca[(size_t)i*nmu + mu] * ca[(size_t)j*nmu + mu];
+    }
+
+    std::vector<double> ExxCholVecGlob(Nchol * nst2, 0.0);
+    if(nslice && Nchol)
+        RmgGemm("t", "n", Nchol, nslice, nmu, one, lvec.data(), nmu, cpair.data(), nmu, zero, &ExxCholVecGlob[ij0*Nchol], Nchol);
+    MPI_Allreduce(MPI_IN_PLACE, ExxCholVecGlob.data(), Nchol * nst2, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+
+    if(ct.verbose && pct.gridpe == 0) printf("\n ISDF points %d  Cholesky vectors %d\n", nmu, Nchol);
+
+    std::vector<double> keigs(nb);
+    for(int st = 0; st < nb; st++) keigs[st] = ct.kp[0].eigs[st];
+
+    if(pct.worldrank == 0)
+        WriteForAFQMC_gamma2complex(vfile, nb, Nchol, nb, nb, keigs, ExxCholVecGlob, Hcore, Hcore_kin);
+}
+
+template <> void Exxbase<std::complex<double>>::Vexx_integrals_isdf(std::string &vfile)
+{
+    throw RmgFatalException() << "ISDF exact exchange is only implemented for the gamma point.\n";
+}
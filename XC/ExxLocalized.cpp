@@ -0,0 +1,161 @@
+/*
+ *
+ * Copyright 2019 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#include "const.h"
+#include "Exxbase.h"
+#include "RmgTimer.h"
+#include "RmgException.h"
+#include "RmgGemm.h"
+#include "transition.h"
+#include "rmgtypedefs.h"
+#include "pe_control.h"
+#include "blas.h"
+
+// The exchange operator only depends on the occupied subspace so it can be built
+// from any orthonormal rotation phi = psi_occ U of the occupied orbitals. For
+// insulators a localized choice makes most products phi_i phi_j vanish and those
+// pairs can be skipped. The localized orbitals are obtained with the selected
+// columns of the density matrix (SCDM) method. The columns are picked by a pivoted
+// QR on a random sample of grid points drawn with probability proportional to the
+// density, which is the squared norm of the corresponding column of psi^T.
+//
+// On return lpsi holds phi for the occupied orbitals followed by the unoccupied
+// orbitals unchanged, umat holds U (nocc x nocc) and pair_mask[i*nocc + j] is
+// nonzero if phi_i and phi_j overlap. Returns false if the sampled columns are
+// rank deficient, in which case the caller should use the original orbitals.
+template <> bool Exxbase<double>::LocalizeOccupied(int nocc, std::vector<double> &lpsi, std::vector<double> &umat, std::vector<char> &pair_mask)
+{
+    RmgTimer RT0("5-Functional: Exx localize");
+    int my_rank = G.get_rank();
+    size_t gbasis = G.get_GLOBAL_BASIS(1);
+    int nsamp = (int)std::min(gbasis, (size_t)(8 * nocc));
+
+    std::vector<double> rho(pbasis, 0.0);
+    for(int st = 0;st < nocc;st++)
+        for(int idx = 0;idx < pbasis;idx++) rho[idx] += psi[(size_t)st*pbasis + idx] * psi[(size_t)st*pbasis + idx];
+
+    // The same random stream is used on all ranks and each sample is taken by the
+    // rank that owns that part of the cumulative density.
+    double rloc = 0.0, rstart = 0.0, rtot = 0.0;
+    for(int idx = 0;idx < pbasis;idx++) rloc += rho[idx];
+    MPI_Exscan(&rloc, &rstart, 1, MPI_DOUBLE, MPI_SUM, G.comm);
+    if(my_rank == 0) rstart = 0.0;
+    MPI_Allreduce(&rloc, &rtot, 1, MPI_DOUBLE, MPI_SUM, G.comm);
+
+    std::vector<double> cum(pbasis);
+    double csum = rstart;
+    for(int idx = 0;idx < pbasis;idx++)
+    {
+        csum += rho[idx];
+        cum[idx] = csum;
+    }
+
+    std::mt19937 gen(5489);
+    std::uniform_real_distribution<double> udist(0.0, 1.0);
+    std::vector<double> a((size_t)nocc * nsamp, 0.0);
+    for(int s = 0;s < nsamp;s++)
+    {
+        double u = udist(gen) * rtot;
+        if(u < rstart || u >= csum) continue;
+        int idx = std::upper_bound(cum.begin(), cum.end(), u) - cum.begin();
+        idx = std::min(idx, pbasis - 1);
+        for(int st = 0;st < nocc;st++) a[(size_t)s*nocc + st] = psi[(size_t)st*pbasis + idx];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, a.data(), nocc*nsamp, MPI_DOUBLE, MPI_SUM, G.comm);
+
+    // Pivoted QR of the sampled columns. The first nocc pivots are the selected columns.
+    std::vector<double> aqr(a);
+    std::vector<int> piv(nsamp, 0);
+    std::vector<double> tau(nocc);
+    int lwork = -1, info = 0;
+    double wsize;
+    dgeqp3(&nocc, &nsamp, aqr.data(), &nocc, piv.data(), tau.data(), &wsize, &lwork, &info);
+    lwork = (int)wsize;
+    std::vector<double> work(lwork);
+    dgeqp3(&nocc, &nsamp, aqr.data(), &nocc, piv.data(), tau.data(), work.data(), &lwork, &info);
+    if(info)
+        throw RmgFatalException() << "Error in " << __FILE__ << " at line " << __LINE__ << ". dgeqp3 info = " << info << "\n";
+
+    // C(st,k) = psi_st(r_k). Lowdin orthonormalization gives U = C (C^T C)^-1/2.
+    std::vector<double> c((size_t)nocc * nocc);
+    for(int k = 0;k < nocc;k++)
+        for(int st = 0;st < nocc;st++) c[(size_t)k*nocc + st] = a[(size_t)(piv[k] - 1)*nocc + st];
+
+    double one = 1.0, zero = 0.0;
+    std::vector<double> smat((size_t)nocc * nocc), eigs(nocc);
+    RmgGemm("t", "n", nocc, nocc, nocc, one, c.data(), nocc, c.data(), nocc, zero, smat.data(), nocc);
+    lwork = -1;
+    dsyev("V", "U", &nocc, smat.data(), &nocc, eigs.data(), &wsize, &lwork, &info);
+    lwork = (int)wsize;
+    work.resize(lwork);
+    dsyev("V", "U", &nocc, smat.data(), &nocc, eigs.data(), work.data(), &lwork, &info);
+    if(info)
+        throw RmgFatalException() << "Error in " << __FILE__ << " at line " << __LINE__ << ". dsyev info = " << info << "\n";
+    if(eigs[0] <= 1.0e-10 * eigs[nocc - 1]) return false;
+
+    std::vector<double> vs(smat);
+    for(int k = 0;k < nocc;k++)
+    {
+        double s = 1.0 / std::sqrt(std::sqrt(eigs[k]));
+        for(int st = 0;st < nocc;st++) vs[(size_t)k*nocc + st] *= s;
+    }
+    std::vector<double> sinv((size_t)nocc * nocc);
+    RmgGemm("n", "t", nocc, nocc, nocc, one, vs.data(), nocc, vs.data(), nocc, zero, sinv.data(), nocc);
+    umat.resize((size_t)nocc * nocc);
+    RmgGemm("n", "n", nocc, nocc, nocc, one, c.data(), nocc, sinv.data(), nocc, zero, umat.data(), nocc);
+
+    lpsi.resize((size_t)nstates * pbasis);
+    RmgGemm("n", "n", pbasis, nocc, nocc, one, psi, pbasis, umat.data(), nocc, zero, lpsi.data(), pbasis);
+    std::copy(psi + (size_t)nocc*pbasis, psi + (size_t)nstates*pbasis, lpsi.begin() + (size_t)nocc*pbasis);
+
+    // Pairs are kept if the overlap of |phi_i| and |phi_j| relative to their norms
+    // exceeds exx_pair_threshold.
+    std::vector<double> aphi((size_t)nocc * pbasis);
+    for(size_t idx = 0;idx < aphi.size();idx++) aphi[idx] = std::abs(lpsi[idx]);
+    RmgGemm("t", "n", nocc, nocc, pbasis, one, aphi.data(), pbasis, aphi.data(), pbasis, zero, smat.data(), nocc);
+    MPI_Allreduce(MPI_IN_PLACE, smat.data(), nocc*nocc, MPI_DOUBLE, MPI_SUM, G.comm);
+
+    pair_mask.resize((size_t)nocc * nocc);
+    size_t kept = 0;
+    for(int i = 0;i < nocc;i++)
+    {
+        for(int j = 0;j < nocc;j++)
+        {
+            double sn = std::sqrt(smat[(size_t)i*nocc + i] * smat[(size_t)j*nocc + j]);
+            pair_mask[(size_t)i*nocc + j] = (smat[(size_t)i*nocc + j] > ct.exx_pair_threshold * sn);
+            kept += pair_mask[(size_t)i*nocc + j];
+        }
+    }
+    rmg_printf("\n EXX localized orbitals: %lu of %lu occupied pairs overlap\n", kept, (size_t)nocc*nocc);
+
+    return true;
+}
+
+template <> bool Exxbase<std::complex<double>>::LocalizeOccupied(int nocc, std::vector<std::complex<double>> &lpsi,
+        std::vector<std::complex<double>> &umat, std::vector<char> &pair_mask)
+{
+    throw RmgFatalException() << "Localized exact exchange is only implemented for the gamma point.\n";
+}
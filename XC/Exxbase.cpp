@@ -44,6 +44,7 @@
 #include "HdfHelpers.h"
 #include "Gpufuncs.h"
 #include "GlobalSums.h"
+#include "DensityTiles.h"
 
 using namespace hdfHelper;
 // This class implements exact exchange for delocalized orbitals.
@@ -543,6 +544,14 @@ template <class T> void Exxbase<T>::setup_gfac(double *kq)
 
     }
 
+    pack_gfac();
+}
+
+// Fills gfac_packed from gfac and copies both to the device
+template void Exxbase<double>::pack_gfac(void);
+template void Exxbase<std::complex<double>>::pack_gfac(void);
+template <class T> void Exxbase<T>::pack_gfac(void)
+{
     int xstride = pwave->global_dimy*pwave->global_dimz;
     int ystride = pwave->global_dimz;
     int ig=0;
@@ -561,17 +570,57 @@ template <class T> void Exxbase<T>::setup_gfac(double *kq)
 #endif
 }
 
+// Same as setup_gfac but keeps the kernels of previously seen k-q vectors so they
+// are not recomputed in later exx steps. New kernels are only added while the cache
+// stays within max_bytes, which the caller sets to the size of its rotated orbital
+// buffer.
+template void Exxbase<double>::setup_gfac_cached(double *kq, size_t max_bytes);
+template void Exxbase<std::complex<double>>::setup_gfac_cached(double *kq, size_t max_bytes);
+template <class T> void Exxbase<T>::setup_gfac_cached(double *kq, size_t max_bytes)
+{
+    std::array<long long, 3> key;
+    for(int i = 0;i < 3;i++) key[i] = std::llround(kq[i] * 1.0e10);
+
+    auto it = gfac_cache.find(key);
+    if(it != gfac_cache.end())
+    {
+        std::copy(it->second.begin(), it->second.end(), gfac);
+        pack_gfac();
+        return;
+    }
+
+    setup_gfac(kq);
+    size_t entry_bytes = (size_t)pwave->pbasis * sizeof(double);
+    if((gfac_cache.size() + 1) * entry_bytes <= max_bytes)
+        gfac_cache.emplace(key, std::vector<double>(gfac, gfac + pwave->pbasis));
+}
+
 // These compute the action of the exact exchange operator on all wavefunctions
 // and writes the result into vfile.
 template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
 {
     RmgTimer RT0("5-Functional: Exx potential");
+    // The previous operator applied to the current orbitals is the reference for
+    // the RMS change and the extrapolation below.
+    if(this->ace_built)
+    {
+        std::vector<double> vace((size_t)nstates * (size_t)pbasis);
+        AceExpand(vexx, vace.data());
+        std::copy(vace.begin(), vace.end(), vexx);
+        this->ace_built = false;
+    }
     double scale = - 1.0 / (double)pwave->global_basis;
 
     int nstates_occ = 0;
     for(int st=0;st < nstates;st++) if(occ[st] > 1.0e-6) nstates_occ++;
     MPI_Allreduce(MPI_IN_PLACE, &nstates_occ, 1, MPI_INT, MPI_MAX, G.comm);
 
+    if(ct.exx_isdf && mode == EXX_LOCAL_FFT)
+    {
+        VexxIsdf(vexx, nstates_occ);
+        return;
+    }
+
     std::vector<std::complex<double> *> pvec;
     std::vector<std::complex<float> *> wvec;
     pvec.resize(ct.OMP_THREADS_PER_NODE);
@@ -601,74 +650,146 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
     MPI_Alloc_mem(pwave->pbasis*sizeof(double), MPI_INFO_NULL, &atbuf);
     double *vexx_global = new double[pwave->pbasis]();
 
-    // Write serial wavefunction files. May need to do some numa optimization here at some point
-    RmgTimer *RT1 = new RmgTimer("5-Functional: Exx writewfs");
-    WriteWfsToSingleFile();
-    delete RT1;
+    // With localized occupied orbitals the pairs are built from the rotated set and
+    // pairs that do not overlap in space are skipped. The rows of V_x are rotated
+    // back to the original orbitals at the end. This has to happen before the
+    // orbitals are redistributed or written out below.
+    std::vector<double> lpsi, umat, vraw;
+    std::vector<char> pair_mask;
+    double *psi_save = psi;
+    bool localized = ct.exx_localized && (nstates_occ > 1) && LocalizeOccupied(nstates_occ, lpsi, umat, pair_mask);
+    if(localized)
+    {
+        psi = lpsi.data();
+        vraw.resize((size_t)nstates * (size_t)pbasis);
+    }
 
-    std::string filename = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt0";
-    serial_fd = open(filename.c_str(), O_RDONLY, (mode_t)0600);
-    if(serial_fd < 0)
-        throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
+    // Orbitals are either redistributed in memory or, as an out of core fallback,
+    // written to a serial wavefunction file that each rank reads.
+    bool in_memory = ct.exx_in_memory;
+    if(!in_memory)
+    {
+        // Write serial wavefunction files. May need to do some numa optimization here at some point
+        RmgTimer *RT1 = new RmgTimer("5-Functional: Exx writewfs");
+        WriteWfsToSingleFile();
+        delete RT1;
+
+        std::string filename = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt0";
+        serial_fd = open(filename.c_str(), O_RDONLY, (mode_t)0600);
+        if(serial_fd < 0)
+            throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
+    }
 
     MPI_Request req=MPI_REQUEST_NULL;
     MPI_Status mrstatus;
     double tvexx_RMS = 0.0;
     int flag=0;
 
-
-    // Compute start and stop of inner orbitals
-    int start = 0;
-    int block = nstates_occ / npes;
-    int rem = nstates_occ % npes;
-    int stop = 0;
-    for(int rank = 0;rank < npes;rank++)
+    // Compute start and stop of inner orbitals. Each occupied pair is only computed
+    // once, for the outer orbital with the lower index, so inner orbital j is paired
+    // with the j+1 occupied outer orbitals i <= j and with all unoccupied ones.
+    // Blocks are sized to balance that work rather than the number of orbitals.
+    int nstates_unocc = nstates - nstates_occ;
+    std::vector<double> jwork(nstates_occ);
+    for(int j = 0;j < nstates_occ;j++)
     {
-        stop = start + block;
-        if(rem)
+        jwork[j] = (double)(j + 1 + nstates_unocc);
+        if(localized)
         {
-            stop++;
-            rem--;
+            jwork[j] = (double)nstates_unocc;
+            for(int i = 0;i <= j;i++) jwork[j] += (double)pair_mask[(size_t)i*nstates_occ + j];
         }
-        if(rank == my_rank) break;
-        start = stop;
     }
+    double total_work = 0.0;
+    for(int j = 0;j < nstates_occ;j++) total_work += jwork[j];
+    std::vector<int> bounds(npes + 1, nstates_occ);
+    bounds[0] = 0;
+    double work = 0.0;
+    int rank = 1;
+    for(int j = 0;j < nstates_occ && rank < npes;j++)
+    {
+        work += jwork[j];
+        while(rank < npes && work >= total_work * (double)rank / (double)npes) bounds[rank++] = j + 1;
+    }
+    int start = bounds[my_rank];
+    int stop = bounds[my_rank + 1];
 
 
     // Read block of inner orbitals into array for reuse
     size_t jlength = (size_t)(stop - start) * (size_t)pwave->pbasis;
     double *jpsi = new double[jlength];
-    lseek(serial_fd, (off_t)start * (off_t)pwave->pbasis * sizeof(double), SEEK_SET);
-    size_t bytes_read = read(serial_fd, jpsi, jlength*sizeof(double));
-    if(bytes_read < 0)
+    if(in_memory)
+    {
+        RmgTimer RT1("5-Functional: Exx redistribute");
+        RedistributeOrbitals(bounds, jpsi);
+    }
+    else
     {
-        throw RmgFatalException() << "error in Vexx outer read = " << "\n";
+        lseek(serial_fd, (off_t)start * (off_t)pwave->pbasis * sizeof(double), SEEK_SET);
+        size_t bytes_read = read(serial_fd, jpsi, jlength*sizeof(double));
+        if(bytes_read < 0)
+        {
+            throw RmgFatalException() << "error in Vexx outer read = " << "\n";
+        }
     }
 
-    // Set up outer orbitals with readahead
+    // Contributions of the pairs (i,j) with i < j to row j. Added in when the outer
+    // loop reaches row j, at which point all of them have been computed.
+    double *jacc = new double[jlength]();
+
+    // Thread private accumulators for the current row
+    std::vector<double *> vthr(ct.OMP_THREADS_PER_NODE);
+    for(int tid=0;tid < ct.OMP_THREADS_PER_NODE;tid++) vthr[tid] = new double[pwave->pbasis]();
+
+    // Set up outer orbitals with readahead. In memory the next batch is gathered
+    // while the current one is processed.
     size_t rah = 8;
     size_t length = rah * (size_t)pwave->pbasis * sizeof(double);
-    readahead(serial_fd, 0, length);
-    lseek(serial_fd, 0, SEEK_SET);
     double *psi_ibuf=new double[rah*pwave->pbasis];
+    double *gbuf[2] = {NULL, NULL};
+    std::vector<MPI_Request> greqs[2];
+    if(in_memory)
+    {
+        gbuf[0] = new double[rah*pwave->pbasis];
+        gbuf[1] = new double[rah*pwave->pbasis];
+        StartOrbitalGather(0, std::min((int)rah, nstates), gbuf[0], greqs[0]);
+    }
+    else
+    {
+        readahead(serial_fd, 0, length);
+        lseek(serial_fd, 0, SEEK_SET);
+    }
 
     for(int i=0;i < nstates;i++)
     {
 
         if(!(i%rah))
         {
-            size_t bytes_read = read(serial_fd, psi_ibuf, rah*pwave->pbasis * sizeof(double));
-            if(bytes_read < 0)
+            if(in_memory)
             {
-                throw RmgFatalException() << "error in Vexx inner read." << "\n";
+                int batch = i / rah;
+                int next = i + rah;
+                FinishOrbitalGather(gbuf[batch%2], psi_ibuf, greqs[batch%2]);
+                if(next < nstates)
+                    StartOrbitalGather(next, std::min((int)rah, nstates - next), gbuf[(batch+1)%2], greqs[(batch+1)%2]);
+            }
+            else
+            {
+                size_t bytes_read = read(serial_fd, psi_ibuf, rah*pwave->pbasis * sizeof(double));
+                if(bytes_read < 0)
+                {
+                    throw RmgFatalException() << "error in Vexx inner read." << "\n";
+                }
             }
         }
-        readahead(serial_fd, (off_t)(i+rah)*pwave->pbasis*sizeof(double), length);
+        if(!in_memory) readahead(serial_fd, (off_t)(i+rah)*pwave->pbasis*sizeof(double), length);
         double *psi_i = psi_ibuf + (i%rah) * pwave->pbasis;
         RmgTimer *RT1 = new RmgTimer("5-Functional: Exx potential fft");
+        int jstart = (i < nstates_occ) ? std::max(start, i) : start;
 #pragma omp parallel for schedule(dynamic)
-        for(int j = start;j < stop;j++)
+        for(int j = jstart;j < stop;j++)
         {
+            if(localized && i < nstates_occ && !pair_mask[(size_t)i*nstates_occ + j]) continue;
 #if CUDA_ENABLED
             gpuSetDevice(ct.cu_dev);
 #endif
@@ -681,57 +802,53 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
 
             double *p = (double *)pvec[omp_tid];
             double *psi_j = &jpsi[(size_t)(j-start)*(size_t)pwave->pbasis];
+            double *vt = vthr[omp_tid];
+            // Only one thread handles a given j so the row j accumulator needs no locking
+            double *vj = &jacc[(size_t)(j-start)*(size_t)pwave->pbasis];
+            bool both = (j != i) && (i < nstates_occ);
 
             if(use_float_fft)
             {
                 float *w = (float *)wvec[omp_tid];
                 fftpair_gamma(psi_i, psi_j, p, w, gfac, vexx_global);
-#pragma omp critical(part3)
-                {
+                for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
+                    vt[idx] += scale * w[idx] * psi_j[idx];
+                if(both)
                     for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
-                        vexx_global[idx] += scale * w[idx] * psi_j[idx];
-                }
+                        vj[idx] += scale * w[idx] * psi_i[idx];
             }
             else
             {
                 double *w = (double *)wvec[omp_tid];
                 fftpair_gamma(psi_i, psi_j, p, w, gfac, vexx_global);
-#pragma omp critical(part4)
-                {
+                for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
+                    vt[idx] += scale * p[idx] * psi_j[idx];
+                if(both)
                     for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
-                        vexx_global[idx] += scale * p[idx] * psi_j[idx];
-                }
+                        vj[idx] += scale * p[idx] * psi_i[idx];
             }
         }
 
+        ReduceThreadBuffers(vthr, vexx_global, pwave->pbasis);
+        if(i >= start && i < stop)
+        {
+            double *vi = &jacc[(size_t)(i-start)*(size_t)pwave->pbasis];
+            for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) vexx_global[idx] += vi[idx];
+        }
+#pragma omp parallel for schedule(static, 1)
+        for(int tid=0;tid < ct.OMP_THREADS_PER_NODE;tid++)
+            std::fill(vthr[tid], vthr[tid] + pwave->pbasis, 0.0);
+
         delete RT1;
 
         // We wait for communication from previous row to finish and then copy it into place
         MPI_Wait(&req, &mrstatus);
         if(i)
         {
-            double cm = 0.25;
-            if(i < nstates_occ)
-            {
-                double t1 = 0.0;
-                double *old_vexx = &vexx[(size_t)(i-1) * (size_t)pbasis];
-                for(int idx=0;idx < pbasis;idx++) t1 += (atbuf[idx] - old_vexx[idx])*(atbuf[idx] - old_vexx[idx]);
-                tvexx_RMS += t1;
-            }
-            // Simple mixing/extrapolation
-            double *vptr = &vexx[(size_t)(i-1) * (size_t)pbasis];
-            if( ct.exx_steps > 0 && ct.vexx_rms >=  1.0e-8 && cm != 0.0)
-            {
-                for(int ii=0;ii < pbasis;ii++) vptr[ii] = (1.0+cm)*atbuf[ii] - cm*vptr[ii];
-            }
-            else if( ct.exx_steps > 1 && ct.vexx_rms < 1.0e-8)
-            {
-                for(int ii=0;ii < pbasis;ii++) vptr[ii] = 0.7*atbuf[ii] + 0.3*vptr[ii];
-            }
+            if(localized)
+                memcpy(&vraw[(size_t)(i-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
             else
-            {
-                memcpy(vptr, atbuf, pbasis * sizeof(double));
-            }
+                tvexx_RMS += MixVexx(vexx, atbuf, i-1, 1, nstates_occ);
         }
 
         // Remap so we can use MPI_Reduce_scatter
@@ -743,11 +860,31 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
     }
 
     delete [] psi_ibuf;
+    delete [] gbuf[0];
+    delete [] gbuf[1];
+    delete [] jacc;
     delete [] jpsi;
+    for(int tid=0;tid < ct.OMP_THREADS_PER_NODE;tid++) delete [] vthr[tid];
 
     // Wait for last transfer to finish and then copy data to correct location
     MPI_Wait(&req, &mrstatus);
-    memcpy(&vexx[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+    if(localized)
+    {
+        memcpy(&vraw[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+        psi = psi_save;
+
+        // V_x psi_i = sum_k U_ik V_x phi_k
+        std::vector<double> vocc((size_t)nstates_occ * (size_t)pbasis);
+        double one = 1.0, zero = 0.0;
+        RmgGemm("n", "t", pbasis, nstates_occ, nstates_occ, one, vraw.data(), pbasis, umat.data(), nstates_occ,
+                zero, vocc.data(), pbasis);
+        std::copy(vocc.begin(), vocc.end(), vraw.begin());
+        tvexx_RMS += MixVexx(vexx, vraw.data(), 0, nstates, nstates_occ);
+    }
+    else
+    {
+        memcpy(&vexx[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+    }
 
     scale = (double)nstates_occ*(double)G.get_GLOBAL_BASIS(1);
     MPI_Allreduce(MPI_IN_PLACE, &tvexx_RMS, 1, MPI_DOUBLE, MPI_SUM, this->G.comm);
@@ -756,7 +893,7 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
     ct.vexx_rms = vexx_RMS[ct.exx_steps];
 
     MPI_Barrier(G.comm);
-    close(serial_fd);
+    if(!in_memory) close(serial_fd);
 
     delete [] vexx_global;
     MPI_Free_mem(atbuf);
@@ -773,8 +910,48 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
 }
 
 
+// Extrapolates rows [first, first+count) of vexx towards the newly computed values
+// in vnew, which holds count rows. Returns the local sum of the squared changes of
+// the occupied rows for the RMS estimate.
+template double Exxbase<double>::MixVexx(double *vexx, double *vnew, int first, int count, int nstates_occ);
+template double Exxbase<std::complex<double>>::MixVexx(std::complex<double> *vexx, std::complex<double> *vnew, int first, int count, int nstates_occ);
+template <class T> double Exxbase<T>::MixVexx(T *vexx, T *vnew, int first, int count, int nstates_occ)
+{
+    double t1 = 0.0;
+    double cm = 0.25;
+    for(int i = first;i < first + count;i++)
+    {
+        T *vptr = &vexx[(size_t)i * (size_t)pbasis];
+        T *vn = &vnew[(size_t)(i - first) * (size_t)pbasis];
+        if(i < nstates_occ)
+            for(int idx=0;idx < pbasis;idx++) t1 += std::norm(vn[idx] - vptr[idx]);
+
+        // Simple mixing/extrapolation
+        if( ct.exx_steps > 0 && ct.vexx_rms >=  1.0e-8 && cm != 0.0)
+        {
+            for(int ii=0;ii < pbasis;ii++) vptr[ii] = (1.0+cm)*vn[ii] - cm*vptr[ii];
+        }
+        else if( ct.exx_steps > 1 && ct.vexx_rms < 1.0e-8)
+        {
+            for(int ii=0;ii < pbasis;ii++) vptr[ii] = 0.7*vn[ii] + 0.3*vptr[ii];
+        }
+        else
+        {
+            std::copy(vn, vn + pbasis, vptr);
+        }
+    }
+    return t1;
+}
+
 template <> double Exxbase<double>::Exxenergy(double *vexx)
 {
+    std::vector<double> vace;
+    if(this->ace_built)
+    {
+        vace.resize((size_t)nstates * (size_t)pbasis);
+        AceExpand(vexx, vace.data());
+        vexx = vace.data();
+    }
     double energy = 0.0;
     for(int st=0;st < nstates;st++)
     {
@@ -791,6 +968,13 @@ template <> double Exxbase<double>::Exxenergy(double *vexx)
 
 template <> double Exxbase<std::complex<double>>::Exxenergy(std::complex<double> *vexx)
 {
+    std::vector<std::complex<double>> vace;
+    if(this->ace_built)
+    {
+        vace.resize((size_t)ct.num_kpts_pe * (size_t)ct.run_states * (size_t)pbasis);
+        AceExpand(vexx, vace.data());
+        vexx = vace.data();
+    }
     double energy = 0.0;
     for(int ik = 0; ik < ct.num_kpts_pe; ik++)
     {
@@ -810,6 +994,86 @@ template <> double Exxbase<std::complex<double>>::Exxenergy(std::complex<double>
     return energy;
 }
 
+// Adaptively compressed exchange, L. Lin, J. Chem. Theory Comput. 12, 2242 (2016).
+// On entry vexx holds W = V_x|psi> for the current orbitals. With M = <psi|W> and
+// -M = L L^H the vectors xi = W L^-H satisfy V_x|psi> = -|xi><xi|psi>, so the
+// exchange operator can be applied to any set of orbitals with two GEMMs and no FFTs.
+// On exit vexx holds xi.
+template void Exxbase<double>::BuildAce(double *vexx);
+template void Exxbase<std::complex<double>>::BuildAce(std::complex<double> *vexx);
+template <class T> void Exxbase<T>::BuildAce(T *vexx)
+{
+    RmgTimer RT0("5-Functional: Exx ACE");
+    char *trans_n = "n";
+    char *trans_a = "t";
+    if(typeid(T) == typeid(std::complex<double>)) trans_a = "c";
+    char *side = "r", *uplo = "l", *diag = "n";
+    int nkpts = 1;
+    if(typeid(T) == typeid(std::complex<double>)) nkpts = ct.num_kpts_pe;
+    double vel = this->L.get_omega() / (double)this->G.get_GLOBAL_BASIS(1);
+    T alpha(-vel), beta(0.0), one(1.0);
+
+    std::vector<T> M((size_t)nstates * (size_t)nstates);
+    for(int ik = 0;ik < nkpts;ik++)
+    {
+        T *W = &vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
+        T *phi = &psi[(size_t)ik * (size_t)ct.max_states * (size_t)pbasis];
+
+        // -M and its Hermitian part
+        RmgGemm(trans_a, trans_n, nstates, nstates, pbasis, alpha, phi, pbasis, W, pbasis, beta, M.data(), nstates);
+        BlockAllreduce(M.data(), (size_t)nstates * (size_t)nstates, this->G.comm);
+        for(int i = 0;i < nstates;i++)
+        {
+            for(int j = 0;j < i;j++)
+            {
+                T t = 0.5 * (M[i + j*nstates] + MyConj(M[j + i*nstates]));
+                M[i + j*nstates] = t;
+                M[j + i*nstates] = MyConj(t);
+            }
+        }
+
+        int info = 0;
+        if(typeid(T) == typeid(double))
+            dpotrf(uplo, &nstates, (double *)M.data(), &nstates, &info);
+        else
+            zpotrf(uplo, &nstates, (double *)M.data(), &nstates, &info);
+        if(info != 0)
+            throw RmgFatalException() << "ACE exchange matrix is not negative definite in " << __FILE__ << " at line " << __LINE__ << ". Terminating.\n";
+
+        if(typeid(T) == typeid(double))
+            dtrsm(side, uplo, trans_a, diag, &pbasis, &nstates, (double *)&one, (double *)M.data(), &nstates, (double *)W, &pbasis);
+        else
+            ztrsm(side, uplo, trans_a, diag, &pbasis, &nstates, (std::complex<double> *)&one, (double *)M.data(), &nstates, (double *)W, &pbasis);
+    }
+    this->ace_built = true;
+}
+
+// Writes V_x|psi> = -|xi><xi|psi> for all orbitals into out using the ACE vectors xi
+template void Exxbase<double>::AceExpand(double *xi, double *out);
+template void Exxbase<std::complex<double>>::AceExpand(std::complex<double> *xi, std::complex<double> *out);
+template <class T> void Exxbase<T>::AceExpand(T *xi, T *out)
+{
+    char *trans_n = "n";
+    char *trans_a = "t";
+    if(typeid(T) == typeid(std::complex<double>)) trans_a = "c";
+    int nkpts = 1;
+    if(typeid(T) == typeid(std::complex<double>)) nkpts = ct.num_kpts_pe;
+    double vel = this->L.get_omega() / (double)this->G.get_GLOBAL_BASIS(1);
+    T alphavel(vel), mone(-1.0), zero(0.0);
+
+    std::vector<T> overlaps((size_t)nstates * (size_t)nstates);
+    for(int ik = 0;ik < nkpts;ik++)
+    {
+        T *x = &xi[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
+        T *phi = &psi[(size_t)ik * (size_t)ct.max_states * (size_t)pbasis];
+        T *v = &out[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
+
+        RmgGemm(trans_a, trans_n, nstates, nstates, pbasis, alphavel, x, pbasis, phi, pbasis, zero, overlaps.data(), nstates);
+        BlockAllreduce(overlaps.data(), (size_t)nstates * (size_t)nstates, this->G.comm);
+        RmgGemm(trans_n, trans_n, pbasis, nstates, nstates, mone, x, pbasis, overlaps.data(), nstates, zero, v, pbasis);
+    }
+}
+
 template <> int Exxbase<double>::VxxIntChol(std::vector<double> &mat, std::vector<double> &CholVec, int cmax, int nst_occ)
 {
 
@@ -1048,6 +1312,11 @@ template <> void Exxbase<double>::Vexx_integrals(std::string &vfile)
 
     double scale = 1.0 / (double)pwave->global_basis;
 
+    if(ct.ExxIntChol && ct.exx_isdf && mode == EXX_LOCAL_FFT)
+    {
+        Vexx_integrals_isdf(vfile);
+        return;
+    }
 
     if(ct.ExxIntChol)
     {
@@ -1958,6 +2227,13 @@ template <class T> void Exxbase<T>::WriteWfsToSingleFile()
 template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx, bool use_float_fft)
 {
     RmgTimer RT0("5-Functional: Exx potential");
+    if(this->ace_built)
+    {
+        std::vector<std::complex<double>> vace((size_t)ct.num_kpts_pe * (size_t)ct.run_states * (size_t)pbasis);
+        AceExpand(vexx, vace.data());
+        std::copy(vace.begin(), vace.end(), vexx);
+        this->ace_built = false;
+    }
     double scale = - 1.0 / (double)pwave->global_basis;
 
     if(mode == EXX_DIST_FFT)
@@ -1997,39 +2273,95 @@ template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx,
 
     std::complex<double> *vexx_global = new std::complex<double>[pwave->pbasis]();
 
+    // Mmap the wavefunction arrays of all local kpoints and save a copy of vexx in
+    // the upper part of the orbital storage.
+    std::vector<std::complex<double> *> psi_k(ct.num_kpts_pe);
+    std::vector<int> fd_k(ct.num_kpts_pe);
     for(int ik = 0; ik < ct.num_kpts_pe; ik++)
     {
         int ik_glob = ik + pct.kstart;
-        // Mmap wavefunction array
         std::string filename = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt" + std::to_string(ik_glob);
         RT1 = new RmgTimer("5-Functional: mmap");
-        serial_fd = open(filename.c_str(), O_RDONLY, (mode_t)0600);
-        if(serial_fd < 0)
+        fd_k[ik] = open(filename.c_str(), O_RDONLY, (mode_t)0600);
+        if(fd_k[ik] < 0)
             throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
         delete RT1;
 
-        psi_s = (std::complex<double> *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, serial_fd, 0);
+        psi_k[ik] = (std::complex<double> *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd_k[ik], 0);
 
-        // Save a copy of vexx in the upper part of the orbital storage
         std::complex<double> *prev_vexx = &psi[(size_t)ik * (size_t)ct.max_states * (size_t)pbasis + (size_t)nstates * (size_t)pbasis];
         size_t pstop = (size_t)nstates * (size_t)pbasis;
         std::complex<double> *cur_vexx = &vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
         for(size_t idx=0;idx < pstop;idx++)
         {
-            prev_vexx[idx] = vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis + idx];
+            prev_vexx[idx] = cur_vexx[idx];
             cur_vexx[idx] = 0.0;
         }
+    }
 
+    MPI_Barrier(G.comm);
+
+    int nx_grid = G.get_NX_GRID(1);
+    int ny_grid = G.get_NY_GRID(1);
+    int nz_grid = G.get_NZ_GRID(1);
+    size_t nbasis = (size_t)nx_grid * (size_t)ny_grid * (size_t)nz_grid;
+    std::vector<int> rot_index(nbasis);
+
+    // The q loop is outside the kpoint loop so that the orbitals at each q are read
+    // and rotated once and then reused for all local kpoints.
+    for(int iq = 0; iq < ct.klist.num_k_all; iq++)
+    {
+
+        int ikindex = ct.klist.k_map_index[iq];
+        int isym = ct.klist.k_map_symm[iq];
+        int isyma = std::abs(isym) -1;
+
+        std::string filename_q = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt" + std::to_string(ikindex);
+        RT1 = new RmgTimer("5-Functional: mmap");
+        int serial_fd_q = open(filename_q.c_str(), O_RDONLY, (mode_t)0600);
+        if(serial_fd_q < 0)
+            throw RmgFatalException() << "Error! Could not open " << filename_q << " . Terminating.\n";
+        delete RT1;
+
+        psi_q_map = (std::complex<double> *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, serial_fd_q, 0);
 
         MPI_Barrier(G.comm);
 
-        for(int iq = 0; iq < ct.klist.num_k_all; iq++)
+
+        // rotate wavefunctions for q point from symmetry-related k point.
+        // The source index of each grid point is computed once and then used
+        // for all of the occupied orbitals.
+        RT1 = new RmgTimer("5-Functional: Exx rotate");
+#pragma omp parallel for
+        for (int ix = 0; ix < nx_grid; ix++) {
+            for (int iy = 0; iy < ny_grid; iy++) {
+                for (int iz = 0; iz < nz_grid; iz++) {
+                    int ixx, iyy, izz;
+                    symm_ijk(&Rmg_Symm->sym_rotate[isyma *9], &Rmg_Symm->ftau_wave[isyma*3], ix, iy, iz, ixx, iyy, izz, nx_grid, ny_grid, nz_grid);
+                    rot_index[ix * ny_grid * nz_grid + iy * nz_grid + iz] = ixx * ny_grid * nz_grid + iyy * nz_grid + izz;
+                }
+            }
+        }
+
+#pragma omp parallel for
+        for(int st = 0; st < nstates_occ; st++)
         {
+            std::complex<double> *dst = &psi_q[st * nbasis];
+            std::complex<double> *src = &psi_q_map[st * nbasis];
+            if(isym >= 0)
+                for(size_t idx = 0; idx < nbasis; idx++) dst[idx] = src[rot_index[idx]];
+            else
+                for(size_t idx = 0; idx < nbasis; idx++) dst[idx] = std::conj(src[rot_index[idx]]);
+        }
+        delete RT1;
 
-            int ikindex = ct.klist.k_map_index[iq];
-            int isym = ct.klist.k_map_symm[iq];
-            int isyma = std::abs(isym) -1;
+        munmap(psi_q_map, length);
+        close(serial_fd_q);
 
+        for(int ik = 0; ik < ct.num_kpts_pe; ik++)
+        {
+            int ik_glob = ik + pct.kstart;
+            psi_s = psi_k[ik];
 
             kq[0] = ct.kp[ik_glob].kpt[0] - ct.klist.k_all_xtal[iq][0];
             kq[1] = ct.kp[ik_glob].kpt[1] - ct.klist.k_all_xtal[iq][1];
@@ -2045,54 +2377,7 @@ template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx,
             kq[2] = v2 * twoPI;
 
 
-            setup_gfac(kq);
-
-            std::string filename_q = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt" + std::to_string(ikindex);
-            RT1 = new RmgTimer("5-Functional: mmap");
-            int serial_fd_q = open(filename_q.c_str(), O_RDONLY, (mode_t)0600);
-            if(serial_fd_q < 0)
-                throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
-            delete RT1;
-
-            psi_q_map = (std::complex<double> *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, serial_fd_q, 0);
-
-            MPI_Barrier(G.comm);
-
-
-            // rotate wavefunctions for q point from symmetry-related k point.
-            // define exp(-i (k-q) r) 
-            int nx_grid = G.get_NX_GRID(1);
-            int ny_grid = G.get_NY_GRID(1);
-            int nz_grid = G.get_NZ_GRID(1);
-
-            int nbasis = nx_grid * ny_grid * nz_grid;
-            int ixx, iyy, izz;
-            for (int ix = 0; ix < nx_grid; ix++) {
-                for (int iy = 0; iy < ny_grid; iy++) {
-                    for (int iz = 0; iz < nz_grid; iz++) {
-
-                        symm_ijk(&Rmg_Symm->sym_rotate[isyma *9], &Rmg_Symm->ftau_wave[isyma*3], ix, iy, iz, ixx, iyy, izz, nx_grid, ny_grid, nz_grid);
-
-                        if(isym >= 0)
-                        {
-                            for(int st = 0; st < nstates_occ; st++)
-                            {
-                                psi_q[st * nbasis + ix * ny_grid * nz_grid + iy * nz_grid + iz]
-                                    = (psi_q_map[st * nbasis + ixx * ny_grid * nz_grid + iyy * nz_grid + izz]);
-                            }
-                        }
-                        else
-                        {
-                            for(int st = 0; st < nstates_occ; st++)
-                            {
-                                psi_q[st * nbasis + ix * ny_grid * nz_grid + iy * nz_grid + iz]
-                                    = std::conj(psi_q_map[st * nbasis + ixx * ny_grid * nz_grid + iyy * nz_grid + izz]);
-                            }
-                        }
-                    }
-                }
-            }
-
+            setup_gfac_cached(kq, (size_t)nstates_occ * nbasis * sizeof(std::complex<double>));
 
             MPI_Request req=MPI_REQUEST_NULL;
             MPI_Status mrstatus;
@@ -2103,8 +2388,9 @@ template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx,
             {
                 std::complex<double> *psi_i = &psi_s[i*pwave->pbasis];
                 RmgTimer *RT1 = new RmgTimer("5-Functional: Exx potential fft");
+                // Occupied orbitals are distributed round robin over the ranks
 #pragma omp parallel for schedule(dynamic)
-                for(int j=0;j < nstates_occ;j++)
+                for(int j=my_rank;j < nstates_occ;j+=npes)
                 {
 #if CUDA_ENABLED
                     gpuSetDevice(ct.cu_dev);
@@ -2115,28 +2401,25 @@ template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx,
                     int omp_tid = omp_get_thread_num();
                     std::complex<double> *p = pvec[omp_tid];
                     std::complex<float> *w = wvec[omp_tid];
-                    if(my_rank == (j % npes))
+                    std::complex<double> *psi_j = &psi_q[j*pwave->pbasis];
+                    if(use_float_fft)
                     {
-                        std::complex<double> *psi_j = &psi_q[j*pwave->pbasis];
-                        if(use_float_fft)
-                        {
-                            fftpair(psi_i, psi_j, p, w, gfac);
-                            // We can speed this up by adding more critical sections if it proves to be a bottleneck
+                        fftpair(psi_i, psi_j, p, w, gfac);
+                        // We can speed this up by adding more critical sections if it proves to be a bottleneck
 #pragma omp critical(part3)
-                            {
-                                for(size_t idx = 0;idx < pwave->pbasis;idx++) 
-                                    vexx_global[idx] += scale * (std::complex<double>)w[idx] * psi_j[idx] / (double)ct.klist.num_k_all;
-                            }
-                        }
-                        else
                         {
-                            fftpair(psi_i, psi_j, p, gfac);
-                            // We can speed this up by adding more critical sections if it proves to be a bottleneck
+                            for(size_t idx = 0;idx < pwave->pbasis;idx++) 
+                                vexx_global[idx] += scale * (std::complex<double>)w[idx] * psi_j[idx] / (double)ct.klist.num_k_all;
+                        }
+                    }
+                    else
+                    {
+                        fftpair(psi_i, psi_j, p, gfac);
+                        // We can speed this up by adding more critical sections if it proves to be a bottleneck
 #pragma omp critical(part3)
-                            {
-                                for(size_t idx = 0;idx < pwave->pbasis;idx++) 
-                                    vexx_global[idx] += scale * p[idx] * psi_j[idx] / (double)ct.klist.num_k_all;
-                            }
+                        {
+                            for(size_t idx = 0;idx < pwave->pbasis;idx++) 
+                                vexx_global[idx] += scale * p[idx] * psi_j[idx] / (double)ct.klist.num_k_all;
                         }
                     }
                     if(!omp_tid) MPI_Test(&req, &flag, &mrstatus);
@@ -2167,28 +2450,29 @@ template <> void Exxbase<std::complex<double>>::Vexx(std::complex<double> *vexx,
             {
                 vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis + (size_t)(nstates-1) * (size_t)pbasis + idx] += atbuf[idx];
             } 
+        } // end loop over k-points
+    } // end loop over q-points
 
+    MPI_Barrier(G.comm);
 
-            munmap(psi_q_map, length);
-            close(serial_fd_q);
-        }
-
-        MPI_Barrier(G.comm);
+    for(int ik = 0; ik < ct.num_kpts_pe; ik++)
+    {
+        int ik_glob = ik + pct.kstart;
 
         // munmap wavefunction array
-        munmap(psi_s, length);
-        close(serial_fd);
+        munmap(psi_k[ik], length);
+        close(fd_k[ik]);
 
         double tvexx_RMS = 0.0;
-        size_t length = (size_t)nstates_occ * (size_t)pbasis;
-        cur_vexx = &vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
-        for(size_t idx=0;idx < length;idx++) tvexx_RMS += std::real((prev_vexx[idx] - cur_vexx[idx])*std::conj(prev_vexx[idx] - cur_vexx[idx]));
+        size_t rlength = (size_t)nstates_occ * (size_t)pbasis;
+        std::complex<double> *prev_vexx = &psi[(size_t)ik * (size_t)ct.max_states * (size_t)pbasis + (size_t)nstates * (size_t)pbasis];
+        std::complex<double> *cur_vexx = &vexx[(size_t)ik * (size_t)ct.run_states * (size_t)pbasis];
+        for(size_t idx=0;idx < rlength;idx++) tvexx_RMS += std::real((prev_vexx[idx] - cur_vexx[idx])*std::conj(prev_vexx[idx] - cur_vexx[idx]));
         MPI_Allreduce(MPI_IN_PLACE, &tvexx_RMS, 1, MPI_DOUBLE, MPI_SUM, this->G.comm);
         double vscale = (double)nstates_occ*(double)G.get_GLOBAL_BASIS(1);
 
         vexx_RMS[ct.exx_steps] += sqrt(tvexx_RMS / vscale) * ct.kp[ik_glob].kweight;
-
-    } // end loop over k-points
+    }
 
     double t1 = vexx_RMS[ct.exx_steps];
     MPI_Allreduce(MPI_IN_PLACE, &t1, 1, MPI_DOUBLE, MPI_SUM, pct.kpsub_comm);
@@ -2362,6 +2646,112 @@ template <class T> void Exxbase<T>::Remap(T *inbuf, T *rbuf)
     }
 }
 
+template void Exxbase<double>::Unmap(double *, double *);
+template void Exxbase<std::complex<double>>::Unmap(std::complex<double> *, std::complex<double> *);
+template <class T> void Exxbase<T>::Unmap(T *rbuf, T *outbuf)
+{
+    // Inverse of Remap. Assembles the global array from the per rank blocks.
+    int npes = G.get_NPES();
+    int gdimy = G.get_NY_GRID(1);
+    int gdimz = G.get_NZ_GRID(1);
+
+#pragma omp parallel for
+    for(size_t rank=0;rank < (size_t)npes;rank++)
+    {
+        size_t dimx_r = (size_t)dimsx[rank]; 
+        size_t dimy_r = (size_t)dimsy[rank]; 
+        size_t dimz_r = (size_t)dimsz[rank]; 
+        size_t offset_r = recvoffsets[rank];
+        size_t xoffset_r = (size_t)xoffsets[rank];
+        size_t yoffset_r = (size_t)yoffsets[rank];
+        size_t zoffset_r = (size_t)zoffsets[rank];
+        for(size_t ix=0;ix < dimx_r;ix++)
+        {
+            for(size_t iy=0;iy < dimy_r;iy++)
+            {
+                for(size_t iz=0;iz < dimz_r;iz++)
+                {
+                    outbuf[(ix+xoffset_r)*(size_t)gdimy*(size_t)gdimz + (iy+(size_t)yoffset_r)*(size_t)gdimz + iz + (size_t)zoffset_r] =
+                        rbuf[offset_r + ix*dimy_r*dimz_r + iy*dimz_r + iz];
+                }
+            }
+        }
+    }
+}
+
+// Moves orbitals from the domain decomposition to whole orbital ownership. Rank r
+// receives the global orbitals [bounds[r], bounds[r+1]) of the first kpoint in out.
+template void Exxbase<double>::RedistributeOrbitals(std::vector<int> &bounds, double *out);
+template void Exxbase<std::complex<double>>::RedistributeOrbitals(std::vector<int> &bounds, std::complex<double> *out);
+template <class T> void Exxbase<T>::RedistributeOrbitals(std::vector<int> &bounds, T *out)
+{
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(T) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+    int npes = G.get_NPES();
+    int my_rank = G.get_rank();
+    int nj = bounds[my_rank + 1] - bounds[my_rank];
+
+    // Counts are in whole local orbitals on the send side and in units of nj elements
+    // on the receive side so they stay within int range for large orbital sets.
+    MPI_Datatype stype, rtype;
+    MPI_Type_contiguous(pbasis, wftype, &stype);
+    MPI_Type_commit(&stype);
+    MPI_Type_contiguous(nj, wftype, &rtype);
+    MPI_Type_commit(&rtype);
+
+    std::vector<int> scounts(npes), sdispls(npes);
+    for(int r = 0;r < npes;r++)
+    {
+        scounts[r] = bounds[r + 1] - bounds[r];
+        sdispls[r] = bounds[r];
+    }
+
+    // Blocks arrive ordered by source rank and then by orbital
+    std::vector<T> rbuf((size_t)nj * pwave->pbasis + 1);
+    MPI_Alltoallv(psi, scounts.data(), sdispls.data(), stype, rbuf.data(), recvcounts.data(), irecvoffsets.data(), rtype, G.comm);
+    MPI_Type_free(&rtype);
+    MPI_Type_free(&stype);
+
+    std::vector<T> tbuf(pwave->pbasis);
+    for(int j = 0;j < nj;j++)
+    {
+        for(int r = 0;r < npes;r++)
+        {
+            T *src = &rbuf[(size_t)nj * (size_t)irecvoffsets[r] + (size_t)j * (size_t)recvcounts[r]];
+            std::copy(src, src + recvcounts[r], &tbuf[recvoffsets[r]]);
+        }
+        Unmap(tbuf.data(), &out[(size_t)j * pwave->pbasis]);
+    }
+}
+
+// Starts gathering the global orbitals [first, first+count) of the first kpoint
+// into rbuf in the Remap layout. Completed by FinishOrbitalGather.
+template void Exxbase<double>::StartOrbitalGather(int first, int count, double *rbuf, std::vector<MPI_Request> &reqs);
+template void Exxbase<std::complex<double>>::StartOrbitalGather(int first, int count, std::complex<double> *rbuf, std::vector<MPI_Request> &reqs);
+template <class T> void Exxbase<T>::StartOrbitalGather(int first, int count, T *rbuf, std::vector<MPI_Request> &reqs)
+{
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(T) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+    reqs.resize(count);
+    for(int st = 0;st < count;st++)
+    {
+        MPI_Iallgatherv(&psi[(size_t)(first + st) * (size_t)pbasis], pbasis, wftype,
+                        &rbuf[(size_t)st * pwave->pbasis], recvcounts.data(), irecvoffsets.data(), wftype,
+                        G.comm, &reqs[st]);
+    }
+}
+
+template void Exxbase<double>::FinishOrbitalGather(double *rbuf, double *out, std::vector<MPI_Request> &reqs);
+template void Exxbase<std::complex<double>>::FinishOrbitalGather(std::complex<double> *rbuf, std::complex<double> *out, std::vector<MPI_Request> &reqs);
+template <class T> void Exxbase<T>::FinishOrbitalGather(T *rbuf, T *out, std::vector<MPI_Request> &reqs)
+{
+    RmgTimer RT0("5-Functional: Exx gather");
+    MPI_Waitall((int)reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+    for(size_t st = 0;st < reqs.size();st++)
+        Unmap(&rbuf[st * pwave->pbasis], &out[st * pwave->pbasis]);
+    reqs.clear();
+}
+
 template void Exxbase<double>::SetHcore(double *Hij, double *Hij_kin, int lda);
 template void Exxbase<std::complex<double>>::SetHcore(std::complex<double> *Hij, std::complex<double> *Hij_kin, int lda);
 template <class T> void Exxbase<T>::SetHcore(T *Hij, T *Hij_kin, int lda)
@@ -45,6 +45,7 @@
 #include "xc.h"
 #endif
 #include "rmg_mangling.h"
+#include "XcKernels.h"
 
 #define set_dft_from_name       RMG_FC_MODULE(funct,set_dft_from_name,mod_FUNCT,SET_DFT_FROM_NAME)
 #define get_dft_name            RMG_FC_MODULE(funct,get_dft_name,mod_FUNCT,GET_DFT_NAME)
@@ -66,6 +67,10 @@
 #define gcc_spin_more           RMG_FC_MODULE(funct,gcc_spin_more,mod_FUNCT,GCC_SPIN_MORE)
 #define gcc_spin                RMG_FC_MODULE(funct,gcc_spin,mod_FUNCT,GCC_SPIN)
 #define get_inlc                RMG_FC_MODULE(funct,get_inlc,mod_FUNCT,GET_INLC)
+#define get_iexch               RMG_FC_MODULE(funct,get_iexch,mod_FUNCT,GET_IEXCH)
+#define get_icorr               RMG_FC_MODULE(funct,get_icorr,mod_FUNCT,GET_ICORR)
+#define get_igcx                RMG_FC_MODULE(funct,get_igcx,mod_FUNCT,GET_IGCX)
+#define get_igcc                RMG_FC_MODULE(funct,get_igcc,mod_FUNCT,GET_IGCC)
 #define get_gau_parameter       RMG_FC_MODULE(funct,get_gau_parameter,mod_FUNCT,GET_GAU_PARAMETER)
 #define set_gau_parameter       RMG_FC_MODULE(funct,set_gau_parameter,mod_FUNCT,SET_GAU_PARAMETER)
 #define get_screening_parameter       RMG_FC_MODULE(funct,get_screening_parameter,mod_FUNCT,GET_SCREENING_PARAMETER)
@@ -96,6 +101,10 @@ extern "C" void gcc_spin_more( double *arho_up, double *arho_down,  double *grho
 extern "C" void gcc_spin( double *arho, double *zeta, double *grh2, double *sc, double *v1cup, double *v1cdw, double *v2c );
 
 extern "C" int get_inlc(void);
+extern "C" int get_iexch(void);
+extern "C" int get_icorr(void);
+extern "C" int get_igcx(void);
+extern "C" int get_igcc(void);
 extern "C" double get_gau_parameter(void);
 extern "C" void set_gau_parameter(double *);
 extern "C" double get_screening_parameter(void);
@@ -277,6 +286,14 @@ bool Functional::dft_has_finite_size_correction_rmg(void)
     return dft_has_finite_size_correction();
 }
 
+// True if the spin unpolarized local and gradient terms can be computed with the batched kernels
+bool Functional::use_batched_xc(void)
+{
+    if(!ct.batched_xc_kernels) return false;
+    if(this->dft_is_meta_rmg()) return false;
+    return XcBatchSupported(get_iexch(), get_icorr(), get_igcx(), get_igcc());
+}
+
 bool Functional::dft_is_nonlocc_rmg(void)
 {
     return dft_is_nonlocc();
@@ -341,7 +358,47 @@ void Functional::v_xc(double *rho_in, double *rho_core, double &etxc, double &vt
 
     // First get the local exchange and correlation
     RmgTimer *RT2 = new RmgTimer("5-Functional: vxc local");
-    if(nspin==1) {
+    if(nspin==1 && this->use_batched_xc()) {
+
+        // Same as the per point loop below but with the small charge case folded into
+        // the input density and a scale factor so each block is a single kernel call.
+        int iexch = get_iexch(), icorr = get_icorr();
+        double etxcl=0.0, vtxcl=0.0, rhonegl=0.0;
+        const double rhotem = SMALL_CHARGE * (1.0 + SMALL_CHARGE);
+#pragma omp parallel reduction(+:etxcl,vtxcl) reduction(-:rhonegl)
+        {
+            double trho[XC_BATCH_SIZE], frac[XC_BATCH_SIZE];
+            double ex[XC_BATCH_SIZE], ec[XC_BATCH_SIZE], vx[XC_BATCH_SIZE], vc[XC_BATCH_SIZE];
+#pragma omp for schedule(static)
+            for(int ib=0;ib < this->pbasis;ib+=XC_BATCH_SIZE) {
+
+                int n = std::min(XC_BATCH_SIZE, this->pbasis - ib);
+                for(int i=0;i < n;i++) {
+                    double tr = rho[ib+i] + rho_core[ib+i];
+                    double atrho = fabs(tr);
+                    bool big = atrho > SMALL_CHARGE;
+                    trho[i] = big ? tr : rhotem;
+                    frac[i] = big ? 1.0 : std::cbrt(atrho/SMALL_CHARGE);
+                }
+
+                XcLdaBatch(iexch, icorr, n, trho, ex, ec, vx, vc);
+
+                for(int i=0;i < n;i++) {
+                    int ix = ib + i;
+                    double tr = rho[ix] + rho_core[ix];
+                    v[ix] = (vx[i] + vc[i]) * frac[i];
+                    etxcl = etxcl + ( ex[i] + ec[i] ) * tr * frac[i];
+                    vtxcl = vtxcl + v[ix] * rho[ix];
+                    if(rho[ix] < 0.0) rhonegl = rhonegl - rho[ix];
+                }
+            }
+        }
+        etxc += etxcl;
+        vtxc += vtxcl;
+        rhoneg[0] += rhonegl;
+
+    }
+    else if(nspin==1) {
 
         double etxcl=0.0, vtxcl=0.0, rhonegl=0.0;
 #pragma omp parallel for reduction(+:etxcl), reduction(+:vtxcl), reduction(-:rhonegl)
@@ -520,7 +577,7 @@ void Functional::gradcorr(double *rho, double *rho_core, double &etxc, double &v
     double *rhoout = new double[this->pbasis];
     double *grho = new double[3*this->pbasis];
     double *vxc2 = this->vxc2;
-    double *d2rho = new double[this->pbasis];
+    double *divh = new double[this->pbasis];
     double *gx = grho;
     double *gy = gx + this->pbasis;
     double *gz = gy + this->pbasis;
@@ -536,43 +593,76 @@ void Functional::gradcorr(double *rho, double *rho_core, double &etxc, double &v
     delete RT2;
 
 
-    // and the Laplacian
-    RmgTimer *RT3 = new RmgTimer("5-Functional: apply laplacian");
-    //FftLaplacianFine(rhoout, d2rho);
-    ApplyLaplacian (rhoout, d2rho, fd_order, "Fine");
-
-    delete RT3;
-
-
 
     RmgTimer *RT4 = new RmgTimer("5-Functional: libxc");
 
-#pragma omp parallel for reduction(+:etxcgc,vtxcgc)
-    for(int k=0;k < this->pbasis;k++) {
-
-        double arho = fabs(rhoout[k]);
-        double grho2[2];
-        if(arho > epsr) {
-
-            grho2[0] = gx[k]*gx[k] + gy[k]*gy[k] + gz[k]*gz[k];
-
-            if(grho2[0] > epsg) {
-                double sx, sc, v1x, v2x, v1c, v2c;
-                double segno = 1.0;
-                if(rhoout[k] < 0.0)segno = -1.0; 
+    if(this->use_batched_xc())
+    {
+        int igcx = get_igcx(), igcc = get_igcc();
+#pragma omp parallel reduction(+:etxcgc,vtxcgc)
+        {
+            double arho[XC_BATCH_SIZE], pgrho2[XC_BATCH_SIZE];
+            double sx[XC_BATCH_SIZE], sc[XC_BATCH_SIZE], v1x[XC_BATCH_SIZE];
+            double v2x[XC_BATCH_SIZE], v1c[XC_BATCH_SIZE], v2c[XC_BATCH_SIZE];
+#pragma omp for schedule(static)
+            for(int ib=0;ib < this->pbasis;ib+=XC_BATCH_SIZE) {
+
+                int n = std::min(XC_BATCH_SIZE, this->pbasis - ib);
+
+                // Points that are skipped below are evaluated at a harmless dummy density
+                for(int i=0;i < n;i++) {
+                    int k = ib + i;
+                    double grho2 = gx[k]*gx[k] + gy[k]*gy[k] + gz[k]*gz[k];
+                    bool active = (fabs(rhoout[k]) > epsr) && (grho2 > epsg);
+                    arho[i] = active ? fabs(rhoout[k]) : 1.0;
+                    pgrho2[i] = active ? grho2 + epsg_guard : 1.0;
+                }
 
-                double pgrho2 = grho2[0] + epsg_guard;
-                gcxc( &arho, &pgrho2, &sx, &sc, &v1x, &v2x, &v1c, &v2c );
-                //
-                // first term of the gradient correction : D(rho*Exc)/D(rho)
-                v[k] = v[k] +( v1x + v1c );
-                //
-                //  used later for second term of the gradient correction
-                vxc2[k] = ( v2x + v2c );
-                // 
-                vtxcgc = vtxcgc+( v1x + v1c ) * ( rhoout[k] - rho_core[k] );
-                etxcgc = etxcgc+( sx + sc ) * segno;
+                XcGgaBatch(igcx, igcc, n, arho, pgrho2, sx, sc, v1x, v2x, v1c, v2c);
+
+                for(int i=0;i < n;i++) {
+                    int k = ib + i;
+                    double grho2 = gx[k]*gx[k] + gy[k]*gy[k] + gz[k]*gz[k];
+                    if((fabs(rhoout[k]) <= epsr) || (grho2 <= epsg)) continue;
+                    double segno = 1.0;
+                    if(rhoout[k] < 0.0)segno = -1.0; 
+                    v[k] = v[k] +( v1x[i] + v1c[i] );
+                    vxc2[k] = ( v2x[i] + v2c[i] );
+                    vtxcgc = vtxcgc+( v1x[i] + v1c[i] ) * ( rhoout[k] - rho_core[k] );
+                    etxcgc = etxcgc+( sx[i] + sc[i] ) * segno;
+                }
+            }
+        }
+    }
+    else
+    {
+#pragma omp parallel for reduction(+:etxcgc,vtxcgc)
+        for(int k=0;k < this->pbasis;k++) {
+
+            double arho = fabs(rhoout[k]);
+            double grho2[2];
+            if(arho > epsr) {
+
+                grho2[0] = gx[k]*gx[k] + gy[k]*gy[k] + gz[k]*gz[k];
+
+                if(grho2[0] > epsg) {
+                    double sx, sc, v1x, v2x, v1c, v2c;
+                    double segno = 1.0;
+                    if(rhoout[k] < 0.0)segno = -1.0; 
+
+                    double pgrho2 = grho2[0] + epsg_guard;
+                    gcxc( &arho, &pgrho2, &sx, &sc, &v1x, &v2x, &v1c, &v2c );
+                    //
+                    // first term of the gradient correction : D(rho*Exc)/D(rho)
+                    v[k] = v[k] +( v1x + v1c );
+                    //
+                    //  used later for second term of the gradient correction
+                    vxc2[k] = ( v2x + v2c );
+                    // 
+                    vtxcgc = vtxcgc+( v1x + v1c ) * ( rhoout[k] - rho_core[k] );
+                    etxcgc = etxcgc+( sx + sc ) * segno;
 
+                }
             }
         }
     }
@@ -583,10 +673,17 @@ void Functional::gradcorr(double *rho, double *rho_core, double &etxc, double &v
     // 
     // ... second term of the gradient correction :
     // ... \sum_alpha (D / D r_alpha) ( D(rho*Exc)/D(grad_alpha rho) )
+    // ... evaluated directly as the divergence of h = vxc2 * grad(rho)
     // 
+#pragma omp parallel for
+    for(int ix=0;ix < this->pbasis;ix++) {
+        h[ix] = vxc2[ix] * gx[ix];
+        h[ix+this->pbasis] = vxc2[ix] * gy[ix];
+        h[ix+2*this->pbasis] = vxc2[ix] * gz[ix];
+    }
 
-    RmgTimer *RT5 = new RmgTimer("5-Functional: apply gradient");
-    ApplyGradient (vxc2, h, &h[this->pbasis], &h[2*this->pbasis], fd_order, "Fine");
+    RmgTimer *RT5 = new RmgTimer("5-Functional: apply divergence");
+    ApplyDivergence (h, &h[this->pbasis], &h[2*this->pbasis], divh, fd_order, "Fine");
     delete RT5;
 
     double vtxcgc_1 = 0.0;
@@ -594,12 +691,8 @@ void Functional::gradcorr(double *rho, double *rho_core, double &etxc, double &v
     for(int ix=0;ix < this->pbasis;ix++) {
         double arho = fabs(rhoout[ix]);
         if(arho > epsr) {
-            double gdot =  ( h[ix] * gx[ix] +
-                    h[ix+this->pbasis] * gy[ix] + 
-                    h[ix+2*this->pbasis] * gz[ix] ) ;
-            v[ix] -= gdot;
-            v[ix] -= vxc2[ix] * d2rho[ix];
-            vtxcgc_1 -= rhoout[ix]*(gdot + vxc2[ix] * d2rho[ix]);
+            v[ix] -= divh[ix];
+            vtxcgc_1 -= rhoout[ix]*divh[ix];
         }
     }
 
@@ -607,7 +700,7 @@ void Functional::gradcorr(double *rho, double *rho_core, double &etxc, double &v
     etxc = etxc + etxcgc;
 
     delete [] h;
-    delete [] d2rho;
+    delete [] divh;
     delete [] grho;
     delete [] rhoout;
 
@@ -751,32 +844,15 @@ void Functional::gradcorr_spin(double *rho_up, double *rho_down, double *rho_cor
     
         
     // second term of the gradient correction
-    RmgTimer *RT5 = new RmgTimer("5-Functional: apply gradient");
-    ApplyGradient (hx_up, gx_up, gy_up, gz_up, fd_order, "Fine");
-    ApplyGradient (hx_dw, gx_down, gy_down, gz_down, fd_order, "Fine");
+    RmgTimer *RT5 = new RmgTimer("5-Functional: apply divergence");
+    ApplyDivergence (hx_up, hy_up, hz_up, gx_up, fd_order, "Fine");
+    ApplyDivergence (hx_dw, hy_dw, hz_dw, gx_down, fd_order, "Fine");
 #pragma omp parallel for 
     for(int k=0;k < this->pbasis;k++) {
         v_up[k] -= gx_up[k];
         v_down[k] -= gx_down[k];
     }
 
-
-    ApplyGradient (hy_up, gx_up, gy_up, gz_up, fd_order, "Fine");
-    ApplyGradient (hy_dw, gx_down, gy_down, gz_down, fd_order, "Fine");
-#pragma omp parallel for 
-    for(int k=0;k < this->pbasis;k++) {
-        v_up[k] -= gy_up[k];
-        v_down[k] -= gy_down[k];
-    }
-
-    ApplyGradient (hz_up, gx_up, gy_up, gz_up, fd_order, "Fine");
-    ApplyGradient (hz_dw, gx_down, gy_down, gz_down, fd_order, "Fine");
-#pragma omp parallel for 
-    for(int k=0;k < this->pbasis;k++) {
-        v_up[k] -= gz_up[k];
-        v_down[k] -= gz_down[k];
-    }
-
     delete RT5;
 
     vtxc = vtxc + vtxcgc;
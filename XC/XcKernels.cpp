@@ -0,0 +1,177 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <cmath>
+#include <algorithm>
+#include "XcKernels.h"
+#include "RmgException.h"
+
+
+// Density below which xc and gcxc in funct.f90 return zero
+static const double xc_small = 1.0e-10;
+
+// Indices follow the iexch, icorr, igcx and igcc values used in funct.f90
+bool XcBatchSupported(int iexch, int icorr, int igcx, int igcc)
+{
+    bool lda_x = (iexch == 0) || (iexch == 1);
+    bool lda_c = (icorr == 0) || (icorr == 1) || (icorr == 3) || (icorr == 4) || (icorr == 7);
+    bool gga_x = (igcx == 0) || (igcx == 1) || (igcx == 3) || (igcx == 4) || (igcx == 10);
+    bool gga_c = (igcc == 0) || (igcc == 3) || (igcc == 4) || (igcc == 8);
+    return lda_x && lda_c && gga_x && gga_c;
+}
+
+
+template <typename X, typename C>
+static void LdaBatch(int n, const double *rho, double *ex, double *ec, double *vx, double *vc)
+{
+    const double pi34 = 0.6203504908994;
+#pragma omp simd
+    for(int i = 0;i < n;i++)
+    {
+        bool valid = rho[i] > xc_small;
+        double r = valid ? rho[i] : 1.0;
+        double rs = pi34 / std::pow(r, 1.0 / 3.0);
+        double tex, tec, tvx, tvc;
+        X::eval(rs, tex, tvx);
+        C::eval(rs, tec, tvc);
+        ex[i] = valid ? tex : 0.0;
+        vx[i] = valid ? tvx : 0.0;
+        ec[i] = valid ? tec : 0.0;
+        vc[i] = valid ? tvc : 0.0;
+    }
+}
+
+template <typename X, typename C>
+static void GgaBatch(int n, const double *rho, const double *grho,
+                     double *sx, double *sc, double *v1x, double *v2x, double *v1c, double *v2c)
+{
+#pragma omp simd
+    for(int i = 0;i < n;i++)
+    {
+        bool valid = rho[i] > xc_small;
+        double r = valid ? rho[i] : 1.0;
+        double g = valid ? grho[i] : 1.0;
+        double tsx, tv1x, tv2x, tsc, tv1c, tv2c;
+        X::eval(r, g, tsx, tv1x, tv2x);
+        C::eval(r, g, tsc, tv1c, tv2c);
+        sx[i] = valid ? tsx : 0.0;
+        v1x[i] = valid ? tv1x : 0.0;
+        v2x[i] = valid ? tv2x : 0.0;
+        sc[i] = valid ? tsc : 0.0;
+        v1c[i] = valid ? tv1c : 0.0;
+        v2c[i] = valid ? tv2c : 0.0;
+    }
+}
+
+
+template <typename X>
+static void LdaDispatch(int icorr, int n, const double *rho, double *ex, double *ec, double *vx, double *vc)
+{
+    switch(icorr)
+    {
+        case 0:
+            LdaBatch<X, XcNoLda>(n, rho, ex, ec, vx, vc);
+            break;
+        case 1:
+            LdaBatch<X, XcPz<1>>(n, rho, ex, ec, vx, vc);
+            break;
+        case 3:
+            LdaBatch<X, XcLyp>(n, rho, ex, ec, vx, vc);
+            break;
+        case 4:
+            LdaBatch<X, XcPw>(n, rho, ex, ec, vx, vc);
+            break;
+        case 7:
+            LdaBatch<X, XcPz<2>>(n, rho, ex, ec, vx, vc);
+            break;
+        default:
+            throw RmgFatalException() << "Correlation type " << icorr << " not supported by batched kernels in "
+                                      << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
+
+void XcLdaBatch(int iexch, int icorr, int n, const double *rho, double *ex, double *ec, double *vx, double *vc)
+{
+    switch(iexch)
+    {
+        case 0:
+            LdaDispatch<XcNoLda>(icorr, n, rho, ex, ec, vx, vc);
+            break;
+        case 1:
+            LdaDispatch<XcSlater>(icorr, n, rho, ex, ec, vx, vc);
+            break;
+        default:
+            throw RmgFatalException() << "Exchange type " << iexch << " not supported by batched kernels in "
+                                      << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
+
+
+template <typename X>
+static void GgaDispatch(int igcc, int n, const double *rho, const double *grho,
+                        double *sx, double *sc, double *v1x, double *v2x, double *v1c, double *v2c)
+{
+    switch(igcc)
+    {
+        case 0:
+            GgaBatch<X, XcNoGga>(n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 3:
+            GgaBatch<X, XcGlyp>(n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 4:
+            GgaBatch<X, XcPbec<1>>(n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 8:
+            GgaBatch<X, XcPbec<2>>(n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        default:
+            throw RmgFatalException() << "Gradient correlation type " << igcc << " not supported by batched kernels in "
+                                      << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
+
+void XcGgaBatch(int igcx, int igcc, int n, const double *rho, const double *grho,
+                double *sx, double *sc, double *v1x, double *v2x, double *v1c, double *v2c)
+{
+    switch(igcx)
+    {
+        case 0:
+            GgaDispatch<XcNoGga>(igcc, n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 1:
+            GgaDispatch<XcBecke88>(igcc, n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 3:
+            GgaDispatch<XcPbex<1>>(igcc, n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 4:
+            GgaDispatch<XcPbex<2>>(igcc, n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        case 10:
+            GgaDispatch<XcPbex<3>>(igcc, n, rho, grho, sx, sc, v1x, v2x, v1c, v2c);
+            break;
+        default:
+            throw RmgFatalException() << "Gradient exchange type " << igcx << " not supported by batched kernels in "
+                                      << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
@@ -48,3 +48,34 @@ FUNCTION(RMG_RUN_BOND_CHECK TESTNAME TEST_DIR RMG_EXE PROCS)
     SET_TESTS_PROPERTIES( ${TESTNAME}_check_bond_length PROPERTIES PASS_REGULAR_EXPRESSION "pass")
     
 ENDFUNCTION()
+
+# Runs the comma separated INPUTS in order in one directory, each on the matching
+# entry of PROCS, and compares the total energy of each comma separated COMPARE
+# input with the one from input.ref within the matching entry of TOLERANCES.
+# Inputs that are not compared can prepare files that the others read.
+FUNCTION(RMG_RUN_COMPARE_CHECK TESTNAME TEST_DIR RMG_EXE INPUTS PROCS COMPARE TOLERANCES)
+
+    SET(CHECK_ENE "${CMAKE_SOURCE_DIR}/tests/compare_total_energy.py")
+    
+    SET(WORKDIR "${CMAKE_CURRENT_BINARY_DIR}/${TEST_DIR}" )
+    
+    ADD_TEST(NAME ${TESTNAME}
+            COMMAND ${CMAKE_COMMAND}
+    -DWORKDIR=${WORKDIR}
+    -DRMG_EXE=${RMG_EXE}
+    -DINPUTS=${INPUTS}
+    -DPROCS=${PROCS}
+    -P ${CMAKE_SOURCE_DIR}/cmake/runtest_compare.cmake)
+
+    string(REPLACE "," ";" COMPARE_LIST "${COMPARE}")
+    string(REPLACE "," ";" TOLERANCE_LIST "${TOLERANCES}")
+    list(LENGTH COMPARE_LIST NCOMPARE)
+    math(EXPR LAST "${NCOMPARE} - 1")
+    foreach(icomp RANGE ${LAST})
+        list(GET COMPARE_LIST ${icomp} INPUT)
+        list(GET TOLERANCE_LIST ${icomp} TOLERANCE)
+        ADD_TEST(NAME ${TESTNAME}_compare_total_energy_${INPUT} COMMAND ${CHECK_ENE} ${TOLERANCE} input.ref ${INPUT} WORKING_DIRECTORY ${WORKDIR})
+        SET_TESTS_PROPERTIES( ${TESTNAME}_compare_total_energy_${INPUT} PROPERTIES PASS_REGULAR_EXPRESSION "test status: pass" DEPENDS ${TESTNAME})
+    endforeach()
+    
+ENDFUNCTION()
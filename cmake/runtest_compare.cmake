@@ -0,0 +1,16 @@
+string(REPLACE "," ";" INPUT_LIST "${INPUTS}")
+string(REPLACE "," ";" PROCS_LIST "${PROCS}")
+list(LENGTH INPUT_LIST NRUNS)
+math(EXPR LAST "${NRUNS} - 1")
+
+# Later runs may restart from the files written by earlier ones so Waves is only cleared here
+file(REMOVE_RECURSE ${WORKDIR}/Waves)
+foreach(irun RANGE ${LAST})
+    list(GET INPUT_LIST ${irun} INPUT)
+    list(GET PROCS_LIST ${irun} NP)
+    file(GLOB OLD_OUTPUT ${WORKDIR}/${INPUT}.[0-9][0-9].*)
+    if(OLD_OUTPUT)
+        file(REMOVE ${OLD_OUTPUT})
+    endif()
+    execute_process(COMMAND mpirun -n ${NP} ${RMG_EXE} ${INPUT} WORKING_DIRECTORY ${WORKDIR})
+endforeach()
@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+
+# Usage: check_exx_pairs.py input
+# Checks that the last localized orbital EXX step in the log of input kept
+# fewer orbital pairs than the nocc*nocc pairs of the standard pair loop.
+
+import glob
+import sys
+
+if __name__ == '__main__':
+  logs = sorted(glob.glob(sys.argv[1] + '.[0-9][0-9].log'))
+  kept = None
+  if logs:
+    for line in open(logs[-1]):
+      if "occupied pairs overlap" in line:
+        words = line.split(":")[1].split()
+        kept = int(words[0])
+        total = int(words[2])
+
+  if kept is None:
+    print("no localized EXX pair count found for %s" % sys.argv[1])
+    print("test status: fail")
+  else:
+    print("pairs kept            : %d of %d" % (kept, total))
+    if kept < total:
+      print("test status: pass")
+    else:
+      print("test status: fail")
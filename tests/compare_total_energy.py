@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+
+# Usage: compare_total_energy.py tolerance reference_input test_input [test_input ...]
+# Compares the final total energy in the log of each test input with the one
+# from the reference input. All energies are in Ha.
+
+import glob
+import sys
+
+def final_energy(input_name):
+  logs = sorted(glob.glob(input_name + '.[0-9][0-9].log'))
+  if not logs:
+    return None
+  energy = None
+  for line in open(logs[-1]):
+    if "final total energy from eig sum" in line:
+      energy = float(line.split("=")[1].split()[0])
+  return energy
+
+if __name__ == '__main__':
+  tol = float(sys.argv[1])
+  Eref = final_energy(sys.argv[2])
+  status = Eref is not None
+  if status:
+    print("reference total energy: %15.8f Ha  (%s)" % (Eref, sys.argv[2]))
+
+  for name in sys.argv[3:]:
+    Etot = final_energy(name)
+    if Etot is None or Eref is None:
+      print("no total energy found for %s" % name)
+      status = False
+      continue
+    eps = abs(Etot - Eref)
+    print("current   total energy: %15.8f Ha  (%s)" % (Etot, name))
+    print("deviation             : %15.8f Ha" % eps)
+    if eps >= tol:
+      status = False
+
+  print("tolerance             : %15.8f Ha" % tol)
+  if status:
+    print("test status: pass")
+  else:
+    print("test status: fail")